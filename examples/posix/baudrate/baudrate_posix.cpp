@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <cstring>
+
+#include "umodem.h"
+#include "umodem_sock.h"
+#include "port/umodem_port.h"
+
+/* Socket echo throughput and loss at several UART rates.
+ *
+ * Negotiates each rate with umodem_set_baudrate(), uploads the same data to
+ * an echo server and checks what comes back. Rates that fail verification
+ * fall back to the previous one and are reported as such. Against the
+ * simulator (examples/posix/sim), pacing its output at the negotiated rate
+ * and garbling it above 460800 baud:
+ *
+ *   ./m65_sim -b 115200 -m 460800 -L /tmp/m65 &
+ *   UMODEM_SERIAL_DEV=/tmp/m65 ./baudrate_posix
+ */
+
+#define ECHO_HOST "echo.m65-sim.local"
+#define ECHO_PORT 7
+#define UPLOAD_SIZE 16384
+#define CHUNK_SIZE 1024
+#define ECHO_TIMEOUT_MS 30000
+
+umodem_apn_t apn_config = {
+    .apn = "internet",
+    .user = "",
+    .pass = "",
+};
+
+static const uint32_t rates[] = {115200, 230400, 460800, 921600};
+
+static uint8_t upload_byte(uint32_t pos)
+{
+  return (uint8_t)('a' + pos % 26);
+}
+
+struct transfer_t
+{
+  uint32_t sent;
+  uint32_t received;
+  uint32_t corrupt;
+};
+
+// Upload UPLOAD_SIZE bytes over a fresh socket, reading the echo as it comes
+static int echo_transfer(transfer_t *t, uint32_t *elapsed_ms)
+{
+  int sockfd = umodem_sock_create(UMODEM_SOCK_TCP);
+  if (sockfd <= 0 || umodem_sock_connect(sockfd, ECHO_HOST, strlen(ECHO_HOST), ECHO_PORT, 10000) != UMODEM_OK)
+  {
+    umodem_sock_close(sockfd);
+    return -1;
+  }
+
+  uint8_t buf[CHUNK_SIZE];
+  uint32_t start = umodem_hal_millis();
+  while (t->received < UPLOAD_SIZE && umodem_hal_millis() - start < ECHO_TIMEOUT_MS)
+  {
+    if (t->sent < UPLOAD_SIZE)
+    {
+      size_t len = UPLOAD_SIZE - t->sent < sizeof(buf) ? UPLOAD_SIZE - t->sent : sizeof(buf);
+      for (size_t i = 0; i < len; i++)
+        buf[i] = upload_byte(t->sent + (uint32_t)i);
+      if (umodem_sock_send(sockfd, buf, len) != (int)len)
+        break;
+      t->sent += (uint32_t)len;
+    }
+
+    int len = umodem_sock_recv(sockfd, buf, sizeof(buf));
+    if (len < 0)
+      break;
+    for (int i = 0; i < len; i++)
+    {
+      if (buf[i] != upload_byte(t->received + (uint32_t)i))
+        t->corrupt++;
+    }
+    t->received += (uint32_t)len;
+  }
+  *elapsed_ms = umodem_hal_millis() - start;
+
+  umodem_sock_close(sockfd);
+  return 0;
+}
+
+int main()
+{
+  if (umodem_init(&apn_config) != UMODEM_OK || umodem_sock_init() != UMODEM_OK)
+  {
+    printf("Failed to initialize uModem\n");
+    return -1;
+  }
+
+  umodem_result_t flow = umodem_set_flow_control(1);
+  printf("RTS/CTS flow control: %s\n", flow == UMODEM_OK ? "on" : "not available");
+
+  int result = 0;
+  printf("%-8s %-10s %10s %8s\n", "rate", "status", "B/s", "lost");
+  for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+  {
+    umodem_result_t set = umodem_set_baudrate(rates[i]);
+    if (set == UMODEM_TIMEOUT)
+    {
+      printf("%-8u link lost\n", rates[i]);
+      result = -1;
+      break;
+    }
+    if (set != UMODEM_OK)
+    {
+      printf("%-8u fallback   (running at %u)\n", rates[i], umodem_get_baudrate());
+      continue;
+    }
+
+    transfer_t t = {0, 0, 0};
+    uint32_t elapsed = 0;
+    if (echo_transfer(&t, &elapsed) != 0)
+    {
+      printf("%-8u no socket\n", rates[i]);
+      result = -1;
+      continue;
+    }
+
+    // Bytes that never came back or came back wrong
+    uint32_t lost = UPLOAD_SIZE - t.received + t.corrupt;
+    printf("%-8u %-10s %10u %8u\n", rates[i], "ok",
+           elapsed ? t.received * 1000 / elapsed : 0, lost);
+    if (lost)
+      result = -1;
+  }
+
+  // Still talking to the modem at whatever rate is in effect
+  int rssi = 0, ber = 0;
+  if (umodem_get_signal_quality(&rssi, &ber) != UMODEM_OK)
+    result = -1;
+
+  printf("%s\n", result == 0 ? "Done" : "Failed");
+  umodem_sock_deinit();
+  umodem_deinit(); // back to the default rate
+  return result;
+}
@@ -0,0 +1,50 @@
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "umodem_at.h"
+
+/* umodem_at_send() round trip against the in-process simulator HAL.
+ * The modem answers synchronously, so the latency is the cost of sending
+ * the command, searching the RX buffer for the final result code and
+ * extracting the response payload.
+ */
+
+using namespace std::chrono;
+
+#define AT_BENCH_SAMPLES 20000
+
+static const char* const commands[] = {"AT\r", "AT+CSQ\r", "AT+CGSN\r"};
+
+void bench_at(BenchReport& report) {
+  char response[128];
+  std::vector<double> samples;
+  samples.reserve(AT_BENCH_SAMPLES);
+
+  for (const char* cmd : commands) {
+    samples.clear();
+    for (int i = 0; i < AT_BENCH_SAMPLES; i++) {
+      auto start = steady_clock::now();
+      umodem_result_t result =
+          umodem_at_send(cmd, response, sizeof(response), 1000);
+      auto end = steady_clock::now();
+      if (result != UMODEM_OK) {
+        fprintf(stderr, "at_send failed for %.*s\n", (int)strcspn(cmd, "\r"),
+            cmd);
+        return;
+      }
+      samples.push_back(duration<double, std::micro>(end - start).count());
+    }
+
+    double total = 0;
+    for (double s : samples) total += s;
+
+    std::string name(cmd, strcspn(cmd, "\r"));
+    report.add("at", name + "_mean", {}, total / samples.size(), "us");
+    report.add("at", name + "_p50", {}, bench_percentile(samples, 50), "us");
+    report.add("at", name + "_p99", {}, bench_percentile(samples, 99), "us");
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef UMODEM_BENCH_HPP_
+#define UMODEM_BENCH_HPP_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Shared helpers for the umodem_bench suites.
+ *
+ * Every suite appends its measurements to a BenchReport, which is written
+ * as JSON (one record per measurement) for regression tracking:
+ *
+ *   {"suite": "buffer", "name": "push_pop",
+ *    "params": {"rx_buf_size": 256, "chunk": 64},
+ *    "value": 1.2e9, "unit": "bytes/s"}
+ */
+
+struct BenchRecord {
+  std::string suite;
+  std::string name;
+  std::vector<std::pair<std::string, double>> params;
+  double value;
+  std::string unit;
+};
+
+class BenchReport {
+public:
+  using Params = std::vector<std::pair<std::string, double>>;
+
+  void add(const std::string& suite, const std::string& name,
+      const Params& params, double value, const std::string& unit) {
+    records_.push_back({suite, name, params, value, unit});
+  }
+
+  void write_json(FILE* f) const {
+    fprintf(f, "{\n  \"benchmark\": \"umodem_bench\",\n  \"results\": [");
+    for (size_t i = 0; i < records_.size(); i++) {
+      const BenchRecord& r = records_[i];
+      fprintf(f, "%s\n    {\"suite\": \"%s\", \"name\": \"%s\", \"params\": {",
+          i ? "," : "", r.suite.c_str(), r.name.c_str());
+      for (size_t p = 0; p < r.params.size(); p++)
+        fprintf(f, "%s\"%s\": %.17g", p ? ", " : "", r.params[p].first.c_str(),
+            r.params[p].second);
+      fprintf(f, "}, \"value\": %.6g, \"unit\": \"%s\"}", r.value,
+          r.unit.c_str());
+    }
+    fprintf(f, "\n  ]\n}\n");
+  }
+
+  void write_text(FILE* f) const {
+    for (const BenchRecord& r : records_) {
+      std::string params;
+      for (const auto& p : r.params) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), " %s=%g", p.first.c_str(), p.second);
+        params += buf;
+      }
+      fprintf(f, "%-8s %-24s%-28s %14.1f %s\n", r.suite.c_str(),
+          r.name.c_str(), params.c_str(), r.value, r.unit.c_str());
+    }
+  }
+
+private:
+  std::vector<BenchRecord> records_;
+};
+
+/* Minimum wall time of a single rate measurement, set from the command
+ * line (-d). */
+extern uint32_t g_bench_min_duration_ms;
+
+/* Bytes that crossed the simulated link so far, in both directions. */
+extern uint64_t g_bench_wire_bytes;
+
+/* Call fn() repeatedly for at least g_bench_min_duration_ms. fn returns the
+ * amount of work it did (bytes, lines, ...); the result is work per second.
+ */
+template <typename F> double bench_rate(F&& fn) {
+  using namespace std::chrono;
+  uint64_t work = 0;
+  auto start = steady_clock::now();
+  auto elapsed = steady_clock::duration::zero();
+  do {
+    for (int i = 0; i < 64; i++) work += fn();
+    elapsed = steady_clock::now() - start;
+  } while (duration_cast<milliseconds>(elapsed).count() <
+           g_bench_min_duration_ms);
+  return work / duration<double>(elapsed).count();
+}
+
+/* Percentile (0..100) of a sample set, sorts the samples in place. */
+static inline double bench_percentile(std::vector<double>& samples, double p) {
+  if (samples.empty()) return 0;
+  std::sort(samples.begin(), samples.end());
+  size_t idx = (size_t)(p / 100.0 * (samples.size() - 1) + 0.5);
+  return samples[idx];
+}
+
+void bench_buffer(BenchReport& report);
+void bench_urc(BenchReport& report, const char* trace_path);
+void bench_cmd(BenchReport& report);
+void bench_at(BenchReport& report);
+void bench_mqtt(BenchReport& report);
+void bench_sock(BenchReport& report);
+
+#endif
@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include "m65_sim.hpp"
+#include "port/umodem_port.h"
+#include "umodem_buffer.h"
+
+/* In-process HAL for benchmarks: the "serial port" is a virtual M65
+ * (examples/posix/sim) answering synchronously. Everything the library sends
+ * is fed to the simulator, whose responses are pushed straight into the RX
+ * buffer, so AT round trips measure the library itself rather than a UART.
+ */
+
+uint64_t g_bench_wire_bytes = 0;
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static M65Sim& sim(void) {
+  static M65Sim instance;
+  static bool wired = false;
+  if (!wired) {
+    instance.set_output([](const char* data, size_t len) {
+      g_bench_wire_bytes += len;
+      umodem_buffer_push((const uint8_t*)data, len);
+    });
+    wired = true;
+  }
+  return instance;
+}
+
+void umodem_hal_init() { sim(); }
+
+void umodem_hal_deinit() {}
+
+int umodem_hal_send(const uint8_t* buf, size_t len) {
+  uint64_t now = now_ms();
+  g_bench_wire_bytes += len;
+  sim().input(buf, len, now);
+  sim().poll(now);
+  return (int)len;
+}
+
+int umodem_hal_read(uint8_t* buf, size_t len) { return 0; }
+
+uint32_t umodem_hal_millis(void) { return (uint32_t)now_ms(); }
+
+void umodem_hal_delay_ms(uint32_t ms) {}
+
+void umodem_hal_wait_rx(uint32_t timeout_ms) {}
+
+void umodem_hal_lock(void) {}
+
+void umodem_hal_unlock(void) {}
+
+void* umodem_hal_alloc(size_t size) { return malloc(size); }
+
+void umodem_hal_free(void* ptr) { free(ptr); }
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.hpp"
+#include "umodem.h"
+
+/* umodem_bench: buffer, URC parser, command builder, AT engine, MQTT and
+ * socket benchmarks.
+ *
+ * Usage: umodem_bench [-d min_ms] [-t trace] [-o results.json]
+ *
+ * A human readable table goes to stderr, JSON results to stdout (or to the
+ * file given with -o).
+ */
+
+uint32_t g_bench_min_duration_ms = 500;
+
+#if UMODEM_METRICS_ENABLE
+// Per-command view of the AT and MQTT runs, as collected by the library
+static void print_metrics(FILE* f) {
+  static umodem_metrics_t m;
+  umodem_metrics_snapshot(&m);
+
+  fprintf(f, "metrics: rx=%llu tx=%llu ring_drops=%llu event_drops=%u\n",
+      (unsigned long long)m.rx_bytes, (unsigned long long)m.tx_bytes,
+      (unsigned long long)m.ring_drops, m.event_drops);
+  for (size_t i = 0; i < m.cmd_count; i++) {
+    const umodem_metrics_cmd_t* c = &m.cmds[i];
+    fprintf(f, "  %-16s n=%-9u err=%-4u tmo=%-4u p50=%ums p99=%ums max=%ums\n",
+        c->prefix, c->count, c->errors, c->timeouts,
+        umodem_metrics_percentile_ms(c, 50), umodem_metrics_percentile_ms(c, 99),
+        c->latency_max_ms);
+  }
+}
+#endif
+
+int main(int argc, char** argv) {
+  const char* trace = UMODEM_BENCH_TRACE_DIR "/quectel_m65_urc.log";
+  const char* output = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:t:o:")) != -1) {
+    switch (opt) {
+    case 'd': g_bench_min_duration_ms = (uint32_t)atol(optarg); break;
+    case 't': trace = optarg; break;
+    case 'o': output = optarg; break;
+    default:
+      fprintf(stderr, "usage: %s [-d min_ms] [-t trace] [-o results.json]\n",
+          argv[0]);
+      return 1;
+    }
+  }
+
+  BenchReport report;
+  bench_buffer(report);
+  bench_urc(report, trace);
+  bench_cmd(report);
+
+  // The AT, MQTT and socket suites talk to the simulator through the full
+  // stack
+  umodem_apn_t apn = {.apn = "internet", .user = "", .pass = ""};
+  if (umodem_init(&apn) == UMODEM_OK) {
+    bench_at(report);
+    bench_mqtt(report);
+    bench_sock(report);
+    umodem_deinit();
+  } else {
+    fprintf(stderr,
+        "umodem_init failed, skipping AT, MQTT and socket benchmarks\n");
+  }
+
+  report.write_text(stderr);
+#if UMODEM_METRICS_ENABLE
+  print_metrics(stderr);
+#endif
+
+  FILE* f = output ? fopen(output, "w") : stdout;
+  if (!f) {
+    perror("Failed to open output");
+    return 1;
+  }
+  report.write_json(f);
+  if (f != stdout) fclose(f);
+  return 0;
+}
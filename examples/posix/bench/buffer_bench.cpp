@@ -0,0 +1,60 @@
+#include <string.h>
+
+#include <vector>
+
+#include "bench.hpp"
+#include "umodem_buffer.h"
+
+/* Ring buffer throughput at several ring sizes, from the 256 byte default
+ * to storage an application would hand over with
+ * umodem_buffer_set_storage().
+ */
+
+static const size_t ring_sizes[] = {256, 4096, 65536, 262144};
+static const size_t chunk_sizes[] = {16, 64, 1024};
+
+void bench_buffer(BenchReport& report) {
+  static uint8_t data[1024];
+  static uint8_t out[1024];
+  memset(data, 'x', sizeof(data));
+
+  for (size_t size : ring_sizes) {
+    std::vector<uint8_t> storage(size);
+    umodem_ring_t ring;
+    umodem_ring_init(&ring, storage.data(), size, NULL);
+
+    // Push a chunk, pop it back
+    for (size_t chunk : chunk_sizes) {
+      if (chunk >= size) continue;
+      umodem_ring_flush(&ring);
+      double rate = bench_rate([&] {
+        size_t n = umodem_ring_push(&ring, data, chunk);
+        umodem_ring_pop(&ring, out, n);
+        return n;
+      });
+      report.add("buffer", "push_pop",
+          {{"rx_buf_size", (double)size}, {"chunk", (double)chunk}}, rate,
+          "bytes/s");
+    }
+
+    // Search for a final result code at the end of a full buffer, the worst
+    // case for umodem_at_send() waiting on a long response
+    umodem_ring_flush(&ring);
+    size_t fill = size - 1 - 6;
+    for (size_t off = 0; off < fill; off += sizeof(data))
+      umodem_ring_push(&ring, data,
+          fill - off < sizeof(data) ? fill - off : sizeof(data));
+    umodem_ring_push(&ring, (const uint8_t*)"\r\nOK\r\n", 6);
+
+    volatile size_t sink = 0;
+    double rate = bench_rate([&] {
+      sink = umodem_ring_find_from(&ring, (const uint8_t*)"\r\nOK\r\n", 6, 0);
+      return (size_t)1;
+    });
+    report.add("buffer", "find_from_full", {{"rx_buf_size", (double)size}},
+        rate, "calls/s");
+    report.add("buffer", "find_from_full_scan",
+        {{"rx_buf_size", (double)size}}, rate * (size - 1), "bytes/s");
+    (void)sink;
+  }
+}
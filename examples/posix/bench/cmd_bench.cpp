@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.hpp"
+#include "umodem_at.h"
+
+/* Command line formatting: snprintf() versus the umodem_at_cmd_* builder
+ * the driver uses, on the commands of the socket and MQTT hot paths.
+ */
+
+static const char topic[] = "devices/sensor-42/telemetry";
+static const char host[] = "broker.example.com";
+
+static size_t format_snprintf(char* buf, size_t size, int which, int n) {
+  switch (which) {
+  case 0:
+    return (size_t)snprintf(
+        buf, size, "AT+QISEND=%d,%u\r", n & 5, 1024u + (unsigned)n);
+  case 1:
+    return (size_t)snprintf(buf, size, "AT+QMTPUB=%d,%d,%d,%d,\"%.*s\"\r", 0,
+        n & 0xFFFF, 1, 0, (int)(sizeof(topic) - 1), topic);
+  default:
+    return (size_t)snprintf(buf, size, "AT+QIOPEN=%d,\"%s\",\"%.*s\",%d\r",
+        n & 5, "TCP", (int)(sizeof(host) - 1), host, 1883);
+  }
+}
+
+static size_t format_builder(char* buf, size_t size, int which, int n) {
+  umodem_at_cmd_t at;
+  umodem_at_cmd_init(&at, buf, size);
+  switch (which) {
+  case 0:
+    umodem_at_cmd_str(&at, "AT+QISEND=");
+    umodem_at_cmd_int(&at, n & 5);
+    umodem_at_cmd_str(&at, ",");
+    umodem_at_cmd_int(&at, 1024 + n);
+    break;
+  case 1:
+    umodem_at_cmd_str(&at, "AT+QMTPUB=0,");
+    umodem_at_cmd_int(&at, n & 0xFFFF);
+    umodem_at_cmd_str(&at, ",1,0,");
+    umodem_at_cmd_quoted(&at, topic, sizeof(topic) - 1);
+    break;
+  default:
+    umodem_at_cmd_str(&at, "AT+QIOPEN=");
+    umodem_at_cmd_int(&at, n & 5);
+    umodem_at_cmd_str(&at, ",\"TCP\",");
+    umodem_at_cmd_quoted(&at, host, sizeof(host) - 1);
+    umodem_at_cmd_str(&at, ",1883");
+    break;
+  }
+  const char* cmd = umodem_at_cmd_cr(&at);
+  return cmd ? strlen(cmd) : 0;
+}
+
+void bench_cmd(BenchReport& report) {
+  static const char* const names[] = {"qisend", "qmtpub", "qiopen"};
+  char a[128], b[128];
+
+  for (int which = 0; which < 3; which++) {
+    // Both must produce the same line
+    size_t len = format_snprintf(a, sizeof(a), which, 7);
+    if (format_builder(b, sizeof(b), which, 7) != len || memcmp(a, b, len)) {
+      fprintf(stderr, "cmd builder mismatch: %.*s\n", (int)len - 1, a);
+      return;
+    }
+
+    int n = 0;
+    volatile size_t sink = 0;
+    double snprintf_rate = bench_rate([&] {
+      sink = format_snprintf(a, sizeof(a), which, n++);
+      return (size_t)1;
+    });
+    double builder_rate = bench_rate([&] {
+      sink = format_builder(b, sizeof(b), which, n++);
+      return (size_t)1;
+    });
+    (void)sink;
+
+    report.add("cmd", std::string("snprintf_") + names[which], {},
+        snprintf_rate, "cmds/s");
+    report.add("cmd", std::string("builder_") + names[which], {},
+        builder_rate, "cmds/s");
+  }
+}
@@ -0,0 +1,86 @@
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "bench.hpp"
+#include "umodem.h"
+#include "umodem_mqtt.h"
+
+/* End-to-end MQTT publish throughput through the M65 driver against the
+ * in-process simulator HAL: AT+QMTPUB, prompt, payload, Ctrl-Z, OK and the
+ * +QMTPUB URC for every message.
+ *
+ * Also times the broker connect, the first one on a connection index and
+ * reconnects with the same options, which skip the AT+QMTCFG lines.
+ */
+
+using namespace std::chrono;
+
+#define MQTT_BENCH_RECONNECTS 200
+
+static const size_t payload_sizes[] = {16, 256, 1024};
+
+void bench_mqtt(BenchReport& report) {
+  if (umodem_mqtt_init() != UMODEM_OK) {
+    fprintf(stderr, "mqtt_init failed\n");
+    return;
+  }
+
+  umodem_mqtt_connect_opts_t opts = {
+      .client_id = "umodem_bench",
+      .keepalive = 120,
+      .delivery_timeout_in_seconds = 5,
+  };
+  auto connect_start = steady_clock::now();
+  int sockfd = umodem_mqtt_connect("localhost", 1883, &opts);
+  double connect_us =
+      duration<double, std::micro>(steady_clock::now() - connect_start).count();
+  if (sockfd <= 0) {
+    fprintf(stderr, "mqtt_connect failed\n");
+    umodem_mqtt_deinit();
+    return;
+  }
+
+  static const char topic[] = "bench/umodem";
+  for (size_t size : payload_sizes) {
+    std::vector<uint8_t> payload(size, 'p');
+    bool failed = false;
+    double rate = bench_rate([&] {
+      if (umodem_mqtt_publish(sockfd, topic, sizeof(topic), payload.data(),
+              payload.size(), UMODEM_MQTT_QOS_1, 0) != UMODEM_OK)
+        failed = true;
+      umodem_poll();
+      return (size_t)1;
+    });
+    if (failed) {
+      fprintf(stderr, "mqtt_publish failed\n");
+      break;
+    }
+
+    BenchReport::Params params = {{"payload", (double)size}};
+    report.add("mqtt", "publish", params, rate, "msgs/s");
+    report.add("mqtt", "publish_payload", params, rate * size, "bytes/s");
+  }
+
+  umodem_mqtt_disconnect(sockfd);
+  report.add("mqtt", "connect_first", {}, connect_us, "us");
+
+  std::vector<double> samples;
+  for (int i = 0; i < MQTT_BENCH_RECONNECTS; i++) {
+    auto start = steady_clock::now();
+    sockfd = umodem_mqtt_connect("localhost", 1883, &opts);
+    auto end = steady_clock::now();
+    if (sockfd <= 0) {
+      fprintf(stderr, "mqtt reconnect failed\n");
+      break;
+    }
+    samples.push_back(duration<double, std::micro>(end - start).count());
+    umodem_mqtt_disconnect(sockfd);
+  }
+  if (!samples.empty())
+    report.add("mqtt", "reconnect_p50", {}, bench_percentile(samples, 50),
+        "us");
+
+  umodem_mqtt_deinit();
+}
@@ -0,0 +1,146 @@
+#include <string.h>
+
+#include <vector>
+
+#include "bench.hpp"
+#include "umodem.h"
+#include "umodem_sock.h"
+
+/* TCP echo throughput through the M65 driver against the in-process
+ * simulator HAL, on the AT+QISEND / AT+QIRD path and in transparent mode.
+ *
+ * Besides the rate, the bytes crossing the link per payload byte are
+ * reported: on a real UART they bound the throughput, at 115200 baud to
+ * 11520 B/s divided by that ratio. Chunks stay below the default 256 byte
+ * RX ring, which holds a whole echo.
+ *
+ * The records suite sends bursts of small records one umodem_sock_send()
+ * at a time, each in its own AT+QISEND and coalesced into one.
+ */
+
+static const size_t chunk_sizes[] = {16, 64, 200};
+
+#define BENCH_SOCK_HOST "10.0.0.1"
+#define BENCH_SOCK_PORT 7
+#define BENCH_RECORD_SIZE 40
+#define BENCH_RECORD_BURST 5
+
+// Send a chunk and read its echo back with the given functions
+template <typename Send, typename Recv>
+static void bench_echo(BenchReport& report, const char* name, Send send,
+    Recv recv) {
+  for (size_t size : chunk_sizes) {
+    std::vector<uint8_t> payload(size, 's');
+    std::vector<uint8_t> echo(size);
+    bool failed = false;
+    uint64_t payload_bytes = 0;
+    uint64_t wire_start = g_bench_wire_bytes;
+
+    double rate = bench_rate([&] {
+      if (failed || send(payload.data(), size) != (int)size) {
+        failed = true;
+        return (size_t)0;
+      }
+      for (size_t got = 0; got < size;) {
+        int n = recv(echo.data() + got, size - got);
+        if (n <= 0) {
+          failed = true;
+          return (size_t)0;
+        }
+        got += (size_t)n;
+      }
+      payload_bytes += 2 * size;
+      return size;
+    });
+    if (failed) {
+      fprintf(stderr, "%s echo failed\n", name);
+      return;
+    }
+
+    BenchReport::Params params = {{"chunk", (double)size}};
+    report.add("sock", name, params, rate, "bytes/s");
+    report.add("sock", std::string(name) + "_wire", params,
+        (double)(g_bench_wire_bytes - wire_start) / payload_bytes,
+        "bytes/byte");
+  }
+}
+
+// Send a burst of records and read their echo back, coalesce = 0 sends
+// every record at once
+static void bench_records(BenchReport& report, int sockfd, size_t coalesce) {
+  const size_t burst = BENCH_RECORD_SIZE * BENCH_RECORD_BURST;
+  if (umodem_sock_set_coalesce(sockfd, coalesce, 50) != UMODEM_OK ||
+      umodem_sock_set_nodelay(sockfd, coalesce == 0) != UMODEM_OK) {
+    fprintf(stderr, "records setup failed\n");
+    return;
+  }
+
+  std::vector<uint8_t> record(BENCH_RECORD_SIZE, 'r');
+  std::vector<uint8_t> echo(burst);
+  bool failed = false;
+  uint64_t payload_bytes = 0;
+  uint64_t wire_start = g_bench_wire_bytes;
+
+  double rate = bench_rate([&] {
+    for (int i = 0; i < BENCH_RECORD_BURST && !failed; i++) {
+      if (umodem_sock_send(sockfd, record.data(), record.size()) !=
+          (int)record.size())
+        failed = true;
+    }
+    for (size_t got = 0; got < burst && !failed;) {
+      int n = umodem_sock_recv(sockfd, echo.data() + got, burst - got);
+      if (n <= 0) failed = true;
+      got += (size_t)n;
+    }
+    if (failed) return (size_t)0;
+    payload_bytes += 2 * burst;
+    return (size_t)BENCH_RECORD_BURST;
+  });
+  if (failed) {
+    fprintf(stderr, "records echo failed\n");
+    return;
+  }
+
+  BenchReport::Params params = {
+      {"record", BENCH_RECORD_SIZE}, {"coalesce", (double)coalesce}};
+  report.add("sock", "records", params, rate, "records/s");
+  report.add("sock", "records_wire", params,
+      (double)(g_bench_wire_bytes - wire_start) / payload_bytes, "bytes/byte");
+}
+
+void bench_sock(BenchReport& report) {
+  if (umodem_sock_init() != UMODEM_OK) {
+    fprintf(stderr, "sock_init failed\n");
+    return;
+  }
+
+  int sockfd = umodem_sock_create(UMODEM_SOCK_TCP);
+  if (sockfd <= 0 || umodem_sock_connect(sockfd, BENCH_SOCK_HOST,
+                         strlen(BENCH_SOCK_HOST), BENCH_SOCK_PORT,
+                         1000) != UMODEM_OK) {
+    fprintf(stderr, "sock_connect failed\n");
+  } else {
+    bench_echo(
+        report, "qisend",
+        [&](const uint8_t* data, size_t len) {
+          return umodem_sock_send(sockfd, data, len);
+        },
+        [&](uint8_t* buf, size_t len) {
+          return umodem_sock_recv(sockfd, buf, len);
+        });
+    bench_records(report, sockfd, 0);
+    bench_records(report, sockfd, BENCH_RECORD_SIZE * BENCH_RECORD_BURST);
+  }
+  umodem_sock_close(sockfd);
+
+  if (umodem_sock_transparent_open(BENCH_SOCK_HOST, strlen(BENCH_SOCK_HOST),
+          BENCH_SOCK_PORT, 1000) != UMODEM_OK) {
+    fprintf(stderr, "sock_transparent_open failed\n");
+  } else {
+    bench_echo(report, "transparent", umodem_sock_transparent_send,
+        umodem_sock_transparent_recv);
+    umodem_sock_transparent_close();
+  }
+
+  umodem_sock_deinit();
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "umodem.h"
+#include "umodem_driver.h"
+
+/* Measures URC parser throughput (lines per second) on a recorded
+ * Quectel M65 trace. Every CR LF terminated line of the trace is fed through
+ * umodem_urc_dispatch() exactly as umodem_poll() would.
+ *
+ * For reference, the previous substring-search dispatch is replayed too
+ * (classification only, handlers are not called).
+ */
+
+static std::vector<std::string> load_trace_lines(const char* path) {
+  std::vector<std::string> lines;
+  FILE* f = fopen(path, "rb");
+  if (!f) return lines;
+
+  std::string data;
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.append(chunk, n);
+  fclose(f);
+
+  size_t offset = 0, pos;
+  while ((pos = data.find("\r\n", offset)) != std::string::npos) {
+    lines.push_back(data.substr(offset, pos - offset + 2));
+    offset = pos + 2;
+  }
+  return lines;
+}
+
+static int legacy_classify(const char* buf, size_t len) {
+  static const char* const keys[] = {"+PDP DEACT", "+CREG:", "CONNECT OK",
+      "CONNECT FAIL", "CLOSED", "+QIRDI:", "+QMTOPEN:", "+QMTCONN:",
+      "+QMTPUB:", "+QMTRECV:"};
+  for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+    if (UMODEM_MEMMEM(buf, len, keys[i], strlen(keys[i]))) return (int)i;
+  return -1;
+}
+
+void bench_urc(BenchReport& report, const char* path) {
+  std::vector<std::string> lines = load_trace_lines(path);
+  if (lines.empty()) {
+    fprintf(stderr, "Failed to load trace %s\n", path);
+    return;
+  }
+
+  volatile int sink = 0;
+  double table = bench_rate([&] {
+    for (const std::string& line : lines) {
+      umodem_event_t event = umodem_urc_dispatch(line.data(), line.size());
+      sink += event.event_flag;
+    }
+    return lines.size();
+  });
+  double legacy = bench_rate([&] {
+    for (const std::string& line : lines)
+      sink += legacy_classify(line.data(), line.size());
+    return lines.size();
+  });
+
+  BenchReport::Params params = {{"trace_lines", (double)lines.size()}};
+  report.add("urc", "dispatch_table", params, table, "lines/s");
+  report.add("urc", "classify_memmem", params, legacy, "lines/s");
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "umodem.h"
+#include "umodem_sock.h"
+
+using namespace std::chrono;
+
+/* Signal polling while a bulk transfer runs.
+ *
+ * A worker thread echoes data through a TCP socket on the CMUX data channel
+ * while the main thread keeps querying the signal quality on the control
+ * channel, then reports the query latency seen under load. Against the
+ * simulator (examples/posix/sim), the peer echoes everything back:
+ *
+ *   ./m65_sim -l 20 -b 115200 -L /tmp/m65 &
+ *   UMODEM_SERIAL_DEV=/tmp/m65 ./cmux_posix
+ */
+
+#define TRANSFER_ROUNDS 20
+#define TRANSFER_CHUNK 1024
+
+umodem_apn_t apn_config = {
+    .apn = "internet",
+    .user = "",
+    .pass = "",
+};
+
+static std::atomic<bool> transfer_done{false};
+static std::atomic<size_t> transferred{0};
+
+static void transfer(int sockfd)
+{
+  static uint8_t out[TRANSFER_CHUNK];
+  static uint8_t in[TRANSFER_CHUNK];
+  memset(out, 'x', sizeof(out));
+
+  for (int round = 0; round < TRANSFER_ROUNDS; round++)
+  {
+    if (umodem_sock_send(sockfd, out, sizeof(out)) <= 0)
+    {
+      printf("Send failed\n");
+      break;
+    }
+    transferred += sizeof(out);
+
+    // Read the echo back
+    size_t received = 0;
+    for (int tries = 0; received < sizeof(out) && tries < 50; tries++)
+    {
+      int len = umodem_sock_recv(sockfd, in, sizeof(in) - received);
+      if (len > 0)
+        received += (size_t)len;
+      else
+        umodem_wait(10);
+    }
+    transferred += received;
+  }
+
+  transfer_done = true;
+}
+
+int main()
+{
+  if (umodem_init(&apn_config) != UMODEM_OK)
+  {
+    printf("Failed to initialize uModem\n");
+    return -1;
+  }
+
+  if (umodem_cmux_start() != UMODEM_OK)
+  {
+    printf("Failed to start CMUX\n");
+    umodem_deinit();
+    return -1;
+  }
+  printf("CMUX started\n");
+
+  int sockfd = -1;
+  const char host[] = "tcpbin.com";
+  if (umodem_sock_init() != UMODEM_OK ||
+      (sockfd = umodem_sock_create(UMODEM_SOCK_TCP)) < 0 ||
+      umodem_sock_connect(sockfd, host, sizeof(host) - 1, 4242, 10000) !=
+          UMODEM_OK)
+  {
+    printf("Failed to open socket\n");
+    umodem_sock_deinit();
+    umodem_deinit();
+    return -1;
+  }
+
+  auto start = steady_clock::now();
+  std::thread worker(transfer, sockfd);
+
+  // Signal polling on the control channel meanwhile
+  std::vector<double> latencies;
+  while (!transfer_done)
+  {
+    int rssi = 0, ber = 0;
+    auto t0 = steady_clock::now();
+    if (umodem_get_signal_quality(&rssi, &ber) != UMODEM_OK)
+      printf("Signal query failed\n");
+    latencies.push_back(
+        duration<double, std::milli>(steady_clock::now() - t0).count());
+    umodem_wait(50);
+  }
+  worker.join();
+
+  double elapsed = duration<double>(steady_clock::now() - start).count();
+  printf("Transferred %zu bytes in %.2f s\n", transferred.load(), elapsed);
+
+  if (!latencies.empty())
+  {
+    std::sort(latencies.begin(), latencies.end());
+    printf("Signal queries: %zu, median %.1f ms, max %.1f ms\n",
+           latencies.size(), latencies[latencies.size() / 2],
+           latencies.back());
+  }
+
+  umodem_sock_close(sockfd);
+  umodem_sock_deinit();
+  umodem_deinit();
+  return 0;
+}
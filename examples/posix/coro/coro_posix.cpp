@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <array>
+#include <string_view>
+
+#include "umodem_coro.hpp"
+
+/* Concurrent modem operations as C++20 coroutines (umodem_coro.hpp).
+ *
+ * Signal quality queries, a socket echo and MQTT publishes run as separate
+ * tasks on one executor, each written as straight-line code. Against the
+ * simulator (examples/posix/sim):
+ *
+ *   ./m65_sim -L /tmp/m65 &
+ *   UMODEM_SERIAL_DEV=/tmp/m65 ./coro_posix
+ */
+
+#define QUERY_TASKS 50
+#define PUBLISHES 10
+
+using namespace std::literals;
+
+umodem_apn_t apn_config = {
+    .apn = "internet",
+    .user = "",
+    .pass = "",
+};
+
+struct Stats
+{
+  int queries_ok = 0;
+  int echoes_ok = 0;
+  int published = 0;
+  int ticks = 0;
+};
+
+static umodem::co::Task<> query_signal(umodem::co::Modem &modem, Stats &stats)
+{
+  std::array<char, 32> csq;
+  if (co_await modem.at("AT+CSQ"sv, csq) == UMODEM_OK)
+    stats.queries_ok++;
+}
+
+static umodem::co::Task<> socket_echo(umodem::co::Executor &exec, Stats &stats)
+{
+  umodem::co::Socket sock(exec, umodem::Socket::create(UMODEM_SOCK_TCP));
+  if (!sock || co_await sock.connect("echo.m65-sim.local"sv, 7, 10000) != UMODEM_OK)
+  {
+    printf("Socket connect failed\n");
+    co_return;
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    if (co_await sock.send(umodem::as_bytes("Hello from a coroutine"sv)) < 0)
+      break;
+
+    std::array<uint8_t, 64> buf;
+    int len = co_await sock.recv(buf, 5000);
+    if (len <= 0)
+      break;
+    printf("Echo: %.*s\n", len, (const char *)buf.data());
+    stats.echoes_ok++;
+  }
+  co_await sock.close();
+}
+
+static umodem::co::Task<> publish(umodem::co::MqttSession &session, Stats &stats)
+{
+  for (int i = 0; i < PUBLISHES; i++)
+  {
+    if (co_await session.publish("umodem/coro"sv, umodem::as_bytes("tick"sv)) == UMODEM_OK)
+      stats.published++;
+  }
+}
+
+// Runs alongside the others without blocking them
+static umodem::co::Task<> ticker(umodem::co::Executor &exec, Stats &stats)
+{
+  for (int i = 0; i < 5; i++)
+  {
+    co_await exec.sleep(100);
+    stats.ticks++;
+  }
+}
+
+int main()
+{
+  umodem::Modem modem(apn_config);
+  if (!modem || modem.open_data() != UMODEM_OK || modem.open_mqtt() != UMODEM_OK)
+  {
+    printf("Failed to initialize uModem (%d)\n", modem.result());
+    return -1;
+  }
+
+  umodem_mqtt_connect_opts_t opts = {
+      .client_id = "umodem-coro",
+      .username = NULL,
+      .password = NULL,
+      .keepalive = 60,
+      .will = NULL,
+      .delivery_timeout_in_seconds = 5,
+      .disable_clean_session = 0,
+      .ssl_enable = 0,
+  };
+
+  umodem::co::Executor exec;
+  umodem::co::Modem at(exec);
+  umodem::co::MqttSession session(
+      exec, umodem::MqttSession::connect("m65-sim.local", 1883, opts));
+  if (!session)
+  {
+    printf("MQTT connect failed\n");
+    return -1;
+  }
+
+  Stats stats;
+  uint32_t start = umodem_hal_millis();
+
+  for (int i = 0; i < QUERY_TASKS; i++)
+    exec.spawn(query_signal(at, stats));
+  exec.spawn(socket_echo(exec, stats));
+  exec.spawn(publish(session, stats));
+  exec.spawn(ticker(exec, stats));
+  exec.run();
+
+  printf("%d/%d queries, %d echoes, %d/%d publishes, %d ticks in %lu ms\n",
+         stats.queries_ok, QUERY_TASKS, stats.echoes_ok, stats.published,
+         PUBLISHES, stats.ticks, (unsigned long)(umodem_hal_millis() - start));
+
+  int ok = stats.queries_ok == QUERY_TASKS && stats.echoes_ok == 3 &&
+           stats.published == PUBLISHES;
+  printf("%s\n", ok ? "Done" : "Failed");
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <array>
+#include <string_view>
+
+#include "umodem.hpp"
+
+/* Socket echo and MQTT loopback with the C++ wrapper (umodem.hpp).
+ *
+ * Every handle is released by its destructor, including on the early
+ * returns. Against the simulator (examples/posix/sim), which echoes sockets
+ * and routes MQTT publishes to matching subscriptions:
+ *
+ *   ./m65_sim -L /tmp/m65 &
+ *   UMODEM_SERIAL_DEV=/tmp/m65 ./cpp_posix
+ */
+
+using namespace std::literals;
+
+umodem_apn_t apn_config = {
+    .apn = "internet",
+    .user = "",
+    .pass = "",
+};
+
+// Event sink, bound to the subscription by reference
+struct Listener
+{
+  int socket_data = 0;
+  int messages = 0;
+
+  void operator()(const umodem::Event &event)
+  {
+    umodem::MqttMessage msg;
+    if (event.flag() == UMODEM_EVENT_SOCK_DATA_RECEIVED)
+      socket_data = event.socket();
+    else if (event.flag() == UMODEM_EVENT_MQTT_DATA_RECEIVED && event.mqtt(msg))
+    {
+      printf("MQTT %.*s: %.*s\n", (int)msg.topic.size(), msg.topic.data(),
+             (int)msg.payload.size(), (const char *)msg.payload.data());
+      messages++;
+    }
+  }
+};
+
+template <class Done>
+static void poll_until(umodem::Modem &modem, Done done, uint32_t timeout_ms)
+{
+  for (uint32_t waited = 0; !done() && waited < timeout_ms; waited += 10)
+  {
+    uint32_t next = modem.poll();
+    modem.wait(next < 10 ? next : 10);
+  }
+}
+
+static int socket_echo(umodem::Modem &modem, Listener &listener)
+{
+  auto sock = umodem::Socket::create(UMODEM_SOCK_TCP);
+  if (!sock || sock.connect("echo.m65-sim.local"sv, 7, 10000) != UMODEM_OK)
+  {
+    printf("Socket connect failed\n");
+    return -1;
+  }
+
+  if (sock.send("Hello from umodem.hpp"sv) < 0)
+    return -1;
+
+  poll_until(modem, [&] { return listener.socket_data == sock.fd(); }, 5000);
+
+  std::array<uint8_t, 64> buf;
+  int len = sock.recv(buf);
+  if (len <= 0)
+    return -1;
+  printf("Echo: %.*s\n", len, (const char *)buf.data());
+  return 0;
+}
+
+static int mqtt_loopback(umodem::Modem &modem, Listener &listener)
+{
+  if (modem.open_mqtt() != UMODEM_OK)
+    return -1;
+
+  umodem_mqtt_connect_opts_t opts = {
+      .client_id = "umodem-cpp",
+      .username = NULL,
+      .password = NULL,
+      .keepalive = 60,
+      .will = NULL,
+      .delivery_timeout_in_seconds = 5,
+      .disable_clean_session = 0,
+      .ssl_enable = 0,
+  };
+  // Received messages are matched to subscriptions by exact topic
+  auto session = umodem::MqttSession::connect("m65-sim.local", 1883, opts);
+  if (!session || session.subscribe("umodem/cpp/text"sv) != UMODEM_OK ||
+      session.subscribe("umodem/cpp/raw"sv) != UMODEM_OK)
+  {
+    printf("MQTT connect failed\n");
+    return -1;
+  }
+
+  const std::array<uint8_t, 4> raw = {'r', 'a', 'w', '!'};
+  session.publish("umodem/cpp/text"sv, "Hello"sv);
+  session.publish("umodem/cpp/raw"sv, raw, UMODEM_MQTT_QOS_1);
+
+  poll_until(modem, [&] { return listener.messages >= 2; }, 5000);
+  return listener.messages >= 2 ? 0 : -1;
+}
+
+int main()
+{
+  umodem::Modem modem(apn_config);
+  if (!modem || modem.open_data() != UMODEM_OK)
+  {
+    printf("Failed to initialize uModem (%d)\n", modem.result());
+    return -1;
+  }
+
+  std::array<char, 32> imei;
+  if (modem.imei(imei) == UMODEM_OK)
+    printf("IMEI: %s\n", imei.data());
+
+  Listener listener;
+  uint32_t mask = UMODEM_EVENT_MASK(UMODEM_EVENT_SOCK_DATA_RECEIVED) |
+                  UMODEM_EVENT_MASK(UMODEM_EVENT_MQTT_DATA_RECEIVED);
+  umodem::Subscription events(mask, listener);
+
+  int result = socket_echo(modem, listener);
+  if (result == 0)
+    result = mqtt_loopback(modem, listener);
+
+  printf("%s\n", result == 0 ? "Done" : "Failed");
+  return result;
+}
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <cstring>
+
+#include "umodem.h"
+#include "umodem_sock.h"
+
+/* HTTP downloads and uploads.
+ *
+ * Downloads a resource on the modem's HTTP stack, interrupts a second
+ * download halfway and resumes it with a range request over a socket, then
+ * streams an upload from a source callback. Against the simulator
+ * (examples/posix/sim), whose HTTP server serves "abc...z" patterns:
+ *
+ *   ./m65_sim -b 115200 -L /tmp/m65 &
+ *   UMODEM_SERIAL_DEV=/tmp/m65 ./http_posix
+ */
+
+#define DOWNLOAD_URL "http://m65-sim.local/bytes/40000"
+#define CHUNKED_URL "http://m65-sim.local/chunked/40000"
+#define UPLOAD_URL "http://m65-sim.local/echo"
+#define UPLOAD_SIZE 8192
+#define ABORT_AFTER 15000
+
+umodem_apn_t apn_config = {
+    .apn = "internet",
+    .user = "",
+    .pass = "",
+};
+
+// Download sink checking the content against the expected pattern
+struct download_t
+{
+  uint32_t offset;  // Resource offset of the next byte
+  uint32_t limit;   // Abort once this many bytes arrived, 0 for none
+  int corrupt;
+};
+
+static int on_download(const uint8_t *data, size_t len, void *ctx)
+{
+  download_t *dl = (download_t *)ctx;
+  for (size_t i = 0; i < len; i++)
+  {
+    if (data[i] != 'a' + (dl->offset + i) % 26)
+      dl->corrupt = 1;
+  }
+  dl->offset += (uint32_t)len;
+  return dl->limit && dl->offset >= dl->limit;
+}
+
+// Upload generated on the fly, then checked against the echo
+struct upload_t
+{
+  uint32_t produced;
+  uint32_t checked;
+};
+
+static uint8_t upload_byte(uint32_t pos)
+{
+  return (uint8_t)(pos * 7);
+}
+
+static int upload_source(uint8_t *buf, size_t len, void *ctx)
+{
+  upload_t *up = (upload_t *)ctx;
+  for (size_t i = 0; i < len; i++)
+    buf[i] = upload_byte(up->produced + (uint32_t)i);
+  up->produced += (uint32_t)len;
+  return (int)len;
+}
+
+static int on_upload_echo(const uint8_t *data, size_t len, void *ctx)
+{
+  upload_t *up = (upload_t *)ctx;
+  for (size_t i = 0; i < len; i++)
+  {
+    if (data[i] != upload_byte(up->checked + (uint32_t)i))
+      return 1;
+  }
+  up->checked += (uint32_t)len;
+  return 0;
+}
+
+static void report(const char *name, umodem_result_t result,
+                   const umodem_http_response_t *resp)
+{
+  printf("%-10s result %d, status %d, %u bytes in %u ms (%u B/s)%s\n", name,
+         result, resp->status, resp->body_bytes, resp->elapsed_ms,
+         resp->bytes_per_s, resp->via_socket ? " [socket]" : " [modem]");
+}
+
+int main()
+{
+  if (umodem_init(&apn_config) != UMODEM_OK || umodem_sock_init() != UMODEM_OK)
+  {
+    printf("Failed to initialize uModem\n");
+    return -1;
+  }
+
+  umodem_http_response_t resp;
+
+  // Whole resource on the modem's HTTP stack
+  download_t full = {0, 0, 0};
+  umodem_http_request_t get = {};
+  get.method = UMODEM_HTTP_GET;
+  get.url = DOWNLOAD_URL;
+  get.on_body = on_download;
+  get.ctx = &full;
+  get.timeout_ms = 60000;
+  umodem_result_t result = umodem_http_request(&get, &resp);
+  report("download", result, &resp);
+  if (full.corrupt)
+    printf("Download corrupted\n");
+
+  // Interrupted download, resumed with a range request
+  download_t resumed = {0, ABORT_AFTER, 0};
+  get.ctx = &resumed;
+  result = umodem_http_request(&get, &resp);
+  report("partial", result, &resp);
+
+  resumed.limit = 0;
+  get.url = CHUNKED_URL;
+  get.range_start = resumed.offset;
+  result = umodem_http_request(&get, &resp);
+  report("resume", result, &resp);
+  printf("Resumed at %lu, total %lu of %lu bytes%s\n",
+         (unsigned long)get.range_start, (unsigned long)resumed.offset,
+         (unsigned long)resp.total_length,
+         resumed.corrupt ? ", corrupted" : "");
+
+  // Streamed upload, echoed back by the server
+  upload_t upload = {0, 0};
+  umodem_http_request_t post = {};
+  post.method = UMODEM_HTTP_POST;
+  post.url = UPLOAD_URL;
+  post.body_len = UPLOAD_SIZE;
+  post.body_source = upload_source;
+  post.on_body = on_upload_echo;
+  post.ctx = &upload;
+  post.timeout_ms = 60000;
+  result = umodem_http_request(&post, &resp);
+  report("upload", result, &resp);
+  printf("Uploaded %lu bytes, %lu echoed back intact\n",
+         (unsigned long)upload.produced, (unsigned long)upload.checked);
+
+  umodem_sock_deinit();
+  umodem_deinit();
+  return 0;
+}
@@ -155,8 +155,10 @@ int main() {
               sizeof(payload), UMODEM_MQTT_QOS_2, 0))
         printf("Failed to publish MQTT message.\n");
     }
-    umodem_poll();
-    usleep(1000);
+    uint32_t next = umodem_poll();
+    uint64_t elapsed = current_millis() - start;
+    uint64_t until_publish = elapsed < 5000 ? 5000 - elapsed : 0;
+    umodem_wait(next < until_publish ? next : (uint32_t)until_publish);
   }
 
   sleep(5);
@@ -190,10 +190,7 @@ int main() {
   }
 
   // Wait for 3 messages
-  while (received_data < 3) {
-    umodem_poll();
-    usleep(1000);
-  }
+  while (received_data < 3) umodem_wait(umodem_poll());
 
   umodem_mqtt_unsubscribe(sockfd, subs_topic, sizeof(subs_topic));
   umodem_mqtt_deinit();
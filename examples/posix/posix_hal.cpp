@@ -1,141 +1,436 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <termios.h>
-#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <time.h>
 #include <pthread.h>
 #include <stdio.h>
-#include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
 #include "port/umodem_port.h"
 #include "umodem_buffer.h"
+#include "umodem_core.h"
+#include "umodem_trace.h"
+
+/* Set to 1 to print every RX/TX chunk to stderr. */
+#ifndef UMODEM_POSIX_HAL_TRACE
+#define UMODEM_POSIX_HAL_TRACE 0
+#endif
+
+/* Size of a single read() from the serial device. */
+#ifndef UMODEM_POSIX_HAL_READ_SIZE
+#define UMODEM_POSIX_HAL_READ_SIZE 4096
+#endif
+
+/* Maximum number of segments accepted by umodem_hal_sendv(). */
+#ifndef UMODEM_POSIX_HAL_MAX_IOV
+#define UMODEM_POSIX_HAL_MAX_IOV 8
+#endif
+
+#if UMODEM_POSIX_HAL_TRACE
+#define HAL_TRACE(prefix, buf, len)                                            \
+  fprintf(stderr, "%s%.*s\n", (prefix), (int)(len), (const char*)(buf))
+#else
+#define HAL_TRACE(prefix, buf, len) ((void)0)
+#endif
 
 static int serial_fd = -1;
-static pthread_mutex_t hal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int epoll_fd = -1;
+static int shutdown_fd = -1;
 static pthread_t reader_thread;
-static volatile int reader_running = 0;
+static int reader_started = 0;
 
-// Default serial device path, can be changed
+static pthread_mutex_t hal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t rx_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rx_cond;
+static int rx_pending = 0;
+
+// Default serial device path, overridden by the UMODEM_SERIAL_DEV variable
 static const char* serial_dev = "/dev/ttyUSB0";
 
-/* --- Reader thread: continuously read from serial and push to buffer --- */
+#if UMODEM_TRACE_ENABLE
+// Binary trace streamed to the file named by UMODEM_TRACE_FILE, drained by
+// the reader thread (the single trace consumer) and on deinit
+static FILE* trace_file = nullptr;
+
+static int trace_write(const uint8_t* data, size_t len, void* ctx) {
+  return fwrite(data, 1, len, (FILE*)ctx) == len ? 0 : -1;
+}
+
+static void trace_flush(void) {
+  if (trace_file) umodem_trace_drain(trace_write, trace_file);
+}
+#else
+static void trace_flush(void) {}
+#endif
+
+static void notify_rx(void) {
+  pthread_mutex_lock(&rx_mutex);
+  rx_pending = 1;
+  pthread_cond_signal(&rx_cond);
+  pthread_mutex_unlock(&rx_mutex);
+}
+
+/* --- RX backpressure: the RX ring rejects what does not fit and its
+ *     watermark callback stops the reader from reading the port while the
+ *     parser catches up. Unread data waits in the kernel buffer (and holds
+ *     RTS with flow control) instead of being dropped --- */
+static int resume_fd = -1;
+static int rx_paused = 0; // Guarded by hal_mutex
+
+// Bytes read from the port but not yet accepted by the ring
+static uint8_t rx_held[UMODEM_POSIX_HAL_READ_SIZE];
+static size_t rx_held_len = 0;
+static size_t rx_held_off = 0;
+
+static void rx_watermark(umodem_ring_t* ring, int above, void* ctx) {
+  (void)ring;
+  (void)ctx;
+  rx_paused = above;
+
+  // Stop watching the port while paused, epoll is level triggered
+  struct epoll_event ev = {};
+  ev.events = above ? 0u : (uint32_t)EPOLLIN;
+  ev.data.fd = serial_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_MOD, serial_fd, &ev);
+
+  uint64_t one = 1;
+  if (!above && write(resume_fd, &one, sizeof(one)) < 0)
+    perror("eventfd write");
+}
+
+// Hand held bytes to the ring, returns 0 once they were all taken
+static int push_held(void) {
+  if (rx_held_off == rx_held_len) return 0;
+
+  pthread_mutex_lock(&hal_mutex);
+  rx_held_off += umodem_buffer_push(
+      rx_held + rx_held_off, rx_held_len - rx_held_off);
+  pthread_mutex_unlock(&hal_mutex);
+  notify_rx();
+  return rx_held_off < rx_held_len ? -1 : 0;
+}
+
+static int reader_paused(void) {
+  pthread_mutex_lock(&hal_mutex);
+  int paused = rx_paused;
+  pthread_mutex_unlock(&hal_mutex);
+  return paused;
+}
+
+/* --- Reader thread: sleep in epoll until the serial port, the resume or
+ *     the shutdown eventfd becomes readable, then drain the port into the
+ *     buffer --- */
 static void* serial_reader(void* arg) {
   (void)arg;
-  uint8_t buf[256];
-
-  while (reader_running) {
-    ssize_t n = read(serial_fd, buf, sizeof(buf));
-    if (n > 0) {
-      printf("%.*s", (int)n, buf); // debug print
-      pthread_mutex_lock(&hal_mutex);
-      umodem_buffer_push(buf, (size_t)n);
-      pthread_mutex_unlock(&hal_mutex);
-    } else if (n < 0) {
-      if (errno != EAGAIN && errno != EINTR) {
-        perror("serial read failed");
-        usleep(1000);
+
+  for (;;) {
+    struct epoll_event events[3];
+    int n = epoll_wait(epoll_fd, events, 3, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror("epoll_wait failed");
+      break;
+    }
+
+    int stop = 0;
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.fd == shutdown_fd) stop = 1;
+      if (events[i].data.fd == resume_fd) {
+        uint64_t count;
+        if (read(resume_fd, &count, sizeof(count)) < 0) perror("eventfd read");
       }
-    } else {
-      // no data, yield CPU
-      usleep(1000);
+      if (events[i].data.fd == serial_fd &&
+          (events[i].events & (EPOLLHUP | EPOLLERR))) {
+        fprintf(stderr, "serial device hung up\n");
+        stop = 1;
+      }
+    }
+    if (stop) break;
+
+    // Held bytes go first; read more only while the ring keeps up
+    ssize_t len = 0;
+    while (push_held() == 0 && !reader_paused()) {
+      len = read(serial_fd, rx_held, sizeof(rx_held));
+      if (len <= 0) break;
+      HAL_TRACE("<- ", rx_held, len);
+      rx_held_len = (size_t)len;
+      rx_held_off = 0;
+    }
+    trace_flush();
+    if (len < 0 && errno != EAGAIN && errno != EINTR) {
+      perror("serial read failed");
+      break;
     }
   }
 
   return nullptr;
 }
 
+static speed_t to_speed(uint32_t baudrate) {
+  switch (baudrate) {
+  case 9600: return B9600;
+  case 19200: return B19200;
+  case 38400: return B38400;
+  case 57600: return B57600;
+  case 115200: return B115200;
+  case 230400: return B230400;
+  case 460800: return B460800;
+  case 921600: return B921600;
+  default: return B0;
+  }
+}
+
+static void set_speed(struct termios* tty, uint32_t baudrate) {
+  cfsetospeed(tty, to_speed(baudrate));
+  cfsetispeed(tty, to_speed(baudrate));
+}
+
+static void set_crtscts(struct termios* tty, uint32_t enable) {
+  if (enable)
+    tty->c_cflag |= CRTSCTS;
+  else
+    tty->c_cflag &= ~CRTSCTS;
+}
+
 static void umodem_hal_cleanup() {
-  if (serial_fd != -1) {
-    reader_running = 0;                   // signal thread to exit
-    pthread_join(reader_thread, nullptr); // wait for thread
-    close(serial_fd);                     // close serial
-    serial_fd = -1;
+  if (reader_started) {
+    uint64_t one = 1;
+    if (write(shutdown_fd, &one, sizeof(one)) < 0) perror("eventfd write");
+    pthread_join(reader_thread, nullptr);
+    reader_started = 0;
   }
+  if (epoll_fd != -1) close(epoll_fd);
+  if (shutdown_fd != -1) close(shutdown_fd);
+  if (resume_fd != -1) close(resume_fd);
+  if (serial_fd != -1) close(serial_fd);
+  epoll_fd = shutdown_fd = resume_fd = serial_fd = -1;
+  rx_held_len = rx_held_off = 0;
+  rx_paused = 0;
+
+#if UMODEM_TRACE_ENABLE
+  if (trace_file) {
+    trace_flush();
+    if (umodem_trace_dropped())
+      fprintf(stderr, "trace: %u records dropped\n", umodem_trace_dropped());
+    fclose(trace_file);
+    trace_file = nullptr;
+  }
+#endif
 }
 
 void umodem_hal_deinit() { umodem_hal_cleanup(); }
 
 void umodem_hal_init() {
-  if (serial_fd != -1) { umodem_hal_cleanup(); }
+  umodem_hal_cleanup();
+
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&rx_cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
 
-  serial_fd = open(serial_dev, O_RDWR | O_NOCTTY | O_SYNC);
+  const char* dev = getenv("UMODEM_SERIAL_DEV");
+  if (dev && dev[0]) serial_dev = dev;
+
+#if UMODEM_TRACE_ENABLE
+  const char* trace_path = getenv("UMODEM_TRACE_FILE");
+  if (trace_path && trace_path[0]) {
+    trace_file = fopen(trace_path, "wb");
+    if (!trace_file || umodem_trace_dump(trace_write, trace_file) < 0)
+      perror("Failed to open trace file");
+  }
+#endif
+
+  serial_fd = open(serial_dev, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
   if (serial_fd < 0) {
     perror("Failed to open serial device");
     return;
   }
 
-  int flags = fcntl(serial_fd, F_GETFL, 0);
-  fcntl(serial_fd, F_SETFL, flags | O_NONBLOCK);
-
   struct termios tty;
   if (tcgetattr(serial_fd, &tty) != 0) {
     perror("tcgetattr failed");
-    close(serial_fd);
-    serial_fd = -1;
+    umodem_hal_cleanup();
     return;
   }
 
-  // Configure baudrate
-  speed_t speed = B115200;
-  cfsetospeed(&tty, speed);
-  cfsetispeed(&tty, speed);
-
-  // Raw mode
-  tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8; // 8-bit chars
-  tty.c_iflag &= ~IGNBRK;                     // disable break processing
-  tty.c_lflag = 0;                            // no signaling chars, no echo
-  tty.c_oflag = 0;                            // no remapping, no delays
-  tty.c_cc[VMIN] = 0;  // read block if available, if not dont block
-  tty.c_cc[VTIME] = 1; // 0.1s read timeout
+  // Configure baudrate, umodem_hal_set_baudrate() changes it later
+  set_speed(&tty, UMODEM_BAUDRATE);
 
-  tty.c_iflag &= ~(IXON | IXOFF | IXANY); // no SW flow control
-  tty.c_cflag |= (CLOCAL | CREAD);        // enable receiver
-  tty.c_cflag &= ~(PARENB | PARODD);      // no parity
-  tty.c_cflag &= ~CSTOPB;                 // 1 stop bit
-  tty.c_cflag &= ~CRTSCTS;                // no HW flow control
+  // Raw mode, reads never block (readiness comes from epoll)
+  cfmakeraw(&tty);
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 0;
+  tty.c_cflag |= (CLOCAL | CREAD); // enable receiver
+  tty.c_cflag &= ~CSTOPB;          // 1 stop bit
+  tty.c_cflag &= ~CRTSCTS;         // no HW flow control
 
   if (tcsetattr(serial_fd, TCSANOW, &tty) != 0) {
     perror("tcsetattr failed");
-    close(serial_fd);
-    serial_fd = -1;
+    umodem_hal_cleanup();
+    return;
+  }
+
+  shutdown_fd = eventfd(0, EFD_CLOEXEC);
+  resume_fd = eventfd(0, EFD_CLOEXEC);
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (shutdown_fd < 0 || resume_fd < 0 || epoll_fd < 0) {
+    perror("eventfd/epoll_create1 failed");
+    umodem_hal_cleanup();
+    return;
+  }
+
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.fd = serial_fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, serial_fd, &ev) != 0) {
+    perror("epoll_ctl failed");
+    umodem_hal_cleanup();
+    return;
+  }
+  ev.data.fd = shutdown_fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, shutdown_fd, &ev) != 0) {
+    perror("epoll_ctl failed");
+    umodem_hal_cleanup();
     return;
   }
+  ev.data.fd = resume_fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, resume_fd, &ev) != 0) {
+    perror("epoll_ctl failed");
+    umodem_hal_cleanup();
+    return;
+  }
+
+  // Pause reading at 3/4 full, resume at 1/4
+  size_t capacity;
+  umodem_buffer_get_storage(&capacity);
+  umodem_ring_t* ring = umodem_buffer_ring();
+  umodem_ring_set_overflow_policy(ring, UMODEM_OVERFLOW_BACKPRESSURE);
+  umodem_ring_set_watermarks(
+      ring, capacity * 3 / 4, capacity / 4, rx_watermark, nullptr);
 
   // Start reader thread
-  reader_running = 1;
   if (pthread_create(&reader_thread, nullptr, serial_reader, nullptr) != 0) {
     perror("pthread_create failed");
-    reader_running = 0;
+    umodem_hal_cleanup();
+    return;
   }
+  reader_started = 1;
 }
 
-int umodem_hal_send(const uint8_t* buf, size_t len) {
-  if (serial_fd < 0) return -1;
-  ssize_t written = write(serial_fd, buf, len);
-  if (written < 0) {
-    perror("write failed");
+// Apply a termios change once pending output has left at the old settings
+static int update_termios(void (*update)(struct termios*, uint32_t),
+    uint32_t arg) {
+  struct termios tty;
+  if (serial_fd < 0 || tcgetattr(serial_fd, &tty) != 0) return -1;
+  update(&tty, arg);
+  if (tcsetattr(serial_fd, TCSADRAIN, &tty) != 0) {
+    perror("tcsetattr failed");
     return -1;
   }
-  printf("-> %.*s\n", (int)len, buf); // debug print
-  return (int)written;
+  return 0;
+}
+
+int umodem_hal_set_baudrate(uint32_t baudrate) {
+  if (to_speed(baudrate) == B0) return -1;
+  return update_termios(set_speed, baudrate);
+}
+
+int umodem_hal_set_flow_control(int enable) {
+  return update_termios(set_crtscts, enable != 0);
+}
+
+// Block until the serial port accepts more output
+static int wait_writable(void) {
+  struct pollfd pfd = {serial_fd, POLLOUT, 0};
+  return poll(&pfd, 1, -1) < 0 ? -1 : 0;
+}
+
+int umodem_hal_sendv(const umodem_iovec_t* iov, size_t iovcnt) {
+  if (serial_fd < 0 || iovcnt > UMODEM_POSIX_HAL_MAX_IOV) return -1;
+
+  struct iovec vec[UMODEM_POSIX_HAL_MAX_IOV];
+  size_t total = 0;
+  for (size_t i = 0; i < iovcnt; i++) {
+    vec[i].iov_base = (void*)iov[i].base;
+    vec[i].iov_len = iov[i].len;
+    total += iov[i].len;
+    HAL_TRACE("-> ", iov[i].base, iov[i].len);
+  }
+
+  // Write everything, resuming after partial writes
+  struct iovec* cur = vec;
+  size_t remaining = iovcnt;
+  while (remaining > 0) {
+    ssize_t written = writev(serial_fd, cur, (int)remaining);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN && wait_writable() == 0) continue;
+      perror("write failed");
+      return -1;
+    }
+
+    while (remaining > 0 && (size_t)written >= cur->iov_len) {
+      written -= (ssize_t)cur->iov_len;
+      cur++;
+      remaining--;
+    }
+    if (remaining > 0) {
+      cur->iov_base = (uint8_t*)cur->iov_base + written;
+      cur->iov_len -= (size_t)written;
+    }
+  }
+
+  return (int)total;
+}
+
+int umodem_hal_send(const uint8_t* buf, size_t len) {
+  umodem_iovec_t iov = {buf, len};
+  return umodem_hal_sendv(&iov, 1);
 }
 
 int umodem_hal_read(uint8_t* buf, size_t len) { return 0; }
 
 uint32_t umodem_hal_millis(void) {
-  struct timeval tv;
-  gettimeofday(&tv, nullptr);
-  return (uint32_t)(tv.tv_sec * 1000 + tv.tv_usec / 1000);
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
 void umodem_hal_delay_ms(uint32_t ms) { usleep(ms * 1000); }
 
+void umodem_hal_wait_rx(uint32_t timeout_ms) {
+  pthread_mutex_lock(&rx_mutex);
+  if (timeout_ms == UMODEM_POLL_INFINITE) {
+    while (!rx_pending) pthread_cond_wait(&rx_cond, &rx_mutex);
+  } else {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    while (!rx_pending) {
+      if (pthread_cond_timedwait(&rx_cond, &rx_mutex, &deadline) == ETIMEDOUT)
+        break;
+    }
+  }
+  rx_pending = 0;
+  pthread_mutex_unlock(&rx_mutex);
+}
+
 void umodem_hal_lock(void) { pthread_mutex_lock(&hal_mutex); }
 
 void umodem_hal_unlock(void) { pthread_mutex_unlock(&hal_mutex); }
 
 void* umodem_hal_alloc(size_t size) { return malloc(size); }
 
-void umodem_hal_free(void* ptr) { free(ptr); }
\ No newline at end of file
+void umodem_hal_free(void* ptr) { free(ptr); }
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "port/umodem_port.h"
+#include "replay_hal.h"
+#include "umodem_buffer.h"
+#include "umodem_core.h"
+#include "umodem_trace.h"
+
+static std::vector<uint8_t> trace_data;
+static std::vector<umodem_trace_record_t> records;
+static std::vector<size_t> tx_before; // TX records preceding each record
+static bool follow_tx = false;
+static size_t next_rx = 0; // Next record to push
+static size_t next_tx = 0; // Next record to compare a write against
+static ReplayStats stats;
+
+static double speed = 1.0;
+static uint64_t virtual_ms = 0; // Replayed clock, in trace time
+static uint64_t real_base_ms = 0;
+static uint64_t virtual_base_ms = 0;
+
+static uint64_t real_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint64_t now_ms(void) {
+  if (speed > 0)
+    virtual_ms =
+        virtual_base_ms + (uint64_t)((real_ms() - real_base_ms) * speed);
+  return virtual_ms;
+}
+
+// Skip TX records, they are only used for comparison
+static void skip_tx(void) {
+  while (next_rx < records.size() && records[next_rx].dir != UMODEM_TRACE_RX)
+    next_rx++;
+}
+
+// Time of the next RX record, or UINT64_MAX if none can be released yet
+static uint64_t next_rx_ms(void) {
+  skip_tx();
+  if (next_rx >= records.size()) return UINT64_MAX;
+  if (follow_tx && stats.tx_checked < tx_before[next_rx]) return UINT64_MAX;
+  return records[next_rx].time_ms;
+}
+
+// Push every RX record that is due
+static void pump(void) {
+  uint64_t now = now_ms();
+  while (next_rx_ms() <= now) {
+    const umodem_trace_record_t& rec = records[next_rx++];
+    umodem_hal_lock();
+    umodem_buffer_push(rec.data, rec.len);
+    umodem_hal_unlock();
+    stats.rx_records++;
+    stats.rx_bytes += rec.len;
+  }
+}
+
+// Advance the clock by up to ms, stopping early at the next RX record
+static void advance(uint32_t ms) {
+  uint64_t now = now_ms();
+  uint64_t target = ms == UMODEM_POLL_INFINITE ? UINT64_MAX : now + ms;
+  if (next_rx_ms() < target) target = next_rx_ms();
+  if (target == UINT64_MAX) return; // Nothing left to wait for
+  if (target < now) target = now;
+
+  if (speed > 0)
+    usleep((useconds_t)((target - now) * 1000 / speed));
+  else
+    virtual_ms = target;
+  pump();
+}
+
+bool replay_hal_load(const char* path, double replay_speed, bool follow) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    perror("Failed to open trace");
+    return false;
+  }
+
+  trace_data.clear();
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    trace_data.insert(trace_data.end(), chunk, chunk + n);
+  fclose(f);
+
+  size_t off = umodem_trace_parse_header(trace_data.data(), trace_data.size());
+  if (off == 0) {
+    fprintf(stderr, "%s is not a uModem trace\n", path);
+    return false;
+  }
+
+  records.clear();
+  tx_before.clear();
+  size_t tx_count = 0;
+  umodem_trace_record_t rec;
+  while ((n = umodem_trace_parse_record(
+              trace_data.data() + off, trace_data.size() - off, &rec)) > 0) {
+    records.push_back(rec);
+    tx_before.push_back(tx_count);
+    if (rec.dir == UMODEM_TRACE_TX) tx_count++;
+    off += n;
+  }
+  if (off != trace_data.size())
+    fprintf(stderr, "trace: ignoring %zu trailing bytes\n",
+        trace_data.size() - off);
+
+  stats = ReplayStats();
+  stats.records = records.size();
+  next_rx = next_tx = 0;
+
+  speed = replay_speed;
+  follow_tx = follow;
+  virtual_ms = virtual_base_ms = records.empty() ? 0 : records[0].time_ms;
+  real_base_ms = real_ms();
+  return true;
+}
+
+bool replay_hal_done(void) {
+  skip_tx();
+  return next_rx >= records.size();
+}
+
+ReplayStats replay_hal_stats(void) { return stats; }
+
+void umodem_hal_init() {
+  if (!records.empty() || !trace_data.empty()) return;
+
+  const char* path = getenv("UMODEM_REPLAY_FILE");
+  const char* env_speed = getenv("UMODEM_REPLAY_SPEED");
+  if (!path ||
+      !replay_hal_load(path, env_speed ? atof(env_speed) : 1.0, true))
+    fprintf(stderr, "replay: set UMODEM_REPLAY_FILE to a trace dump\n");
+}
+
+void umodem_hal_deinit() {}
+
+int umodem_hal_send(const uint8_t* buf, size_t len) {
+  while (next_tx < records.size() && records[next_tx].dir != UMODEM_TRACE_TX)
+    next_tx++;
+  if (next_tx < records.size()) {
+    const umodem_trace_record_t& rec = records[next_tx++];
+    stats.tx_checked++;
+    if (rec.len != len || memcmp(rec.data, buf, len) != 0) {
+      stats.tx_mismatches++;
+      fprintf(stderr, "replay: TX differs from trace at %u ms: %.*s\n",
+          rec.time_ms, (int)len, (const char*)buf);
+    }
+  }
+  return (int)len;
+}
+
+int umodem_hal_read(uint8_t* buf, size_t len) {
+  pump();
+  return 0;
+}
+
+uint32_t umodem_hal_millis(void) { return (uint32_t)now_ms(); }
+
+void umodem_hal_delay_ms(uint32_t ms) {
+  uint64_t end = now_ms() + ms;
+  while (now_ms() < end) advance((uint32_t)(end - now_ms()));
+}
+
+void umodem_hal_wait_rx(uint32_t timeout_ms) { advance(timeout_ms); }
+
+void umodem_hal_lock(void) {}
+
+void umodem_hal_unlock(void) {}
+
+void* umodem_hal_alloc(size_t size) { return malloc(size); }
+
+void umodem_hal_free(void* ptr) { free(ptr); }
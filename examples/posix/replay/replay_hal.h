@@ -0,0 +1,43 @@
+#ifndef REPLAY_HAL_H_
+#define REPLAY_HAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* HAL that plays a umodem_trace dump back instead of talking to a modem.
+ *
+ * RX records are pushed into the RX buffer with umodem_buffer_push() once
+ * their recorded time is reached. speed scales the recorded timing
+ * (1 = original, 10 = ten times faster); 0 replays as fast as possible by
+ * jumping the clock to the next record whenever the library waits.
+ * umodem_hal_millis() follows the replayed clock, so library timeouts see
+ * the original timing at any speed.
+ *
+ * TX writes are compared against the recorded TX records and mismatches
+ * counted, showing where a run diverges from the recorded session. With
+ * follow_tx, an RX record is also held back until every TX record before it
+ * has been written, so responses never overtake the command that caused
+ * them; use it when replaying the application that recorded the trace.
+ *
+ * When replay_hal_load() is not called, umodem_hal_init() loads the file
+ * named by UMODEM_REPLAY_FILE at the speed in UMODEM_REPLAY_SPEED with
+ * follow_tx set, so the POSIX examples can be linked against this HAL
+ * unchanged.
+ */
+
+struct ReplayStats {
+  size_t records;
+  size_t rx_records;
+  size_t rx_bytes;
+  size_t tx_checked;
+  size_t tx_mismatches;
+};
+
+bool replay_hal_load(const char* path, double speed, bool follow_tx);
+
+/* True once every RX record has been pushed. */
+bool replay_hal_done(void);
+
+ReplayStats replay_hal_stats(void);
+
+#endif
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "replay_hal.h"
+#include "umodem.h"
+#include "umodem_trace.h"
+
+/* Replays a uModem trace dump through the RX path (ring buffer, URC
+ * parser, event dispatch) and reports what the parser made of it.
+ *
+ * Usage: umodem_replay [-s speed] [-p] trace.bin
+ *   -s  replay speed, 1 = recorded timing, 0 = as fast as possible (default)
+ *   -p  print the records instead of replaying them
+ */
+
+using namespace std::chrono;
+
+static const char* const event_names[UMODEM_EVENT_COUNT] = {"none",
+    "data_down", "sms_received", "sock_connected", "sock_closed",
+    "sock_data_received", "mqtt_data_published", "mqtt_data_received",
+    "sock_accepted"};
+
+static unsigned long event_counts[UMODEM_EVENT_COUNT];
+
+static void on_event(umodem_event_t* event, void* user_ctx) {
+  event_counts[umodem_event_get_flag(event)]++;
+}
+
+static int print_records(const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    perror("Failed to open trace");
+    return 1;
+  }
+  static uint8_t buf[1 << 20];
+  size_t len = fread(buf, 1, sizeof(buf), f);
+  fclose(f);
+
+  size_t off = umodem_trace_parse_header(buf, len);
+  if (off == 0) {
+    fprintf(stderr, "%s is not a uModem trace\n", path);
+    return 1;
+  }
+
+  umodem_trace_record_t rec;
+  size_t n;
+  while ((n = umodem_trace_parse_record(buf + off, len - off, &rec)) > 0) {
+    printf("%10u %s ", rec.time_ms, rec.dir == UMODEM_TRACE_RX ? "<-" : "->");
+    for (uint16_t i = 0; i < rec.len; i++) {
+      uint8_t c = rec.data[i];
+      if (c == '\r')
+        printf("\\r");
+      else if (c == '\n')
+        printf("\\n");
+      else if (c < 0x20 || c >= 0x7f)
+        printf("\\x%02x", c);
+      else
+        putchar(c);
+    }
+    putchar('\n');
+    off += n;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  double speed = 0;
+  bool print = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:p")) != -1) {
+    switch (opt) {
+    case 's': speed = atof(optarg); break;
+    case 'p': print = true; break;
+    default: optind = argc; break;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "usage: %s [-s speed] [-p] trace.bin\n", argv[0]);
+    return 1;
+  }
+
+  const char* path = argv[optind];
+  if (print) return print_records(path);
+  if (!replay_hal_load(path, speed, false)) return 1;
+
+  umodem_apn_t apn = {};
+  umodem_attach(&apn);
+  umodem_event_subscribe(UMODEM_EVENT_MASK_ALL, on_event, NULL);
+
+  auto start = steady_clock::now();
+  while (!replay_hal_done()) umodem_wait(umodem_poll());
+  umodem_poll();
+  double elapsed = duration<double>(steady_clock::now() - start).count();
+
+  ReplayStats stats = replay_hal_stats();
+  printf("records: %zu (%zu rx, %zu bytes)\n", stats.records,
+      stats.rx_records, stats.rx_bytes);
+  printf("elapsed: %.3f s (%.1f MB/s)\n", elapsed,
+      stats.rx_bytes / elapsed / 1e6);
+  for (int i = 1; i < UMODEM_EVENT_COUNT; i++)
+    if (event_counts[i]) printf("event %-20s %lu\n", event_names[i], event_counts[i]);
+
+  umodem_deinit();
+  return 0;
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <cstring>
+
+#include "umodem.h"
+#include "umodem_event.h"
+#include "umodem_sock.h"
+#include "port/umodem_port.h"
+
+/* Remote diagnostics over an inbound TCP connection.
+ *
+ * Listens on DIAG_PORT and answers one-line requests from whoever connects:
+ * "status" reports the modem status cache, "quit" closes the connection and
+ * stops the server. Against the simulator (examples/posix/sim), whose
+ * "dial" command plays the remote client and prints the replies:
+ *
+ *   (sleep 8; echo "dial status"; sleep 2; echo "hangup 0"; echo "dial quit";
+ *    sleep 2; echo quit) | ./m65_sim -L /tmp/m65 &
+ *   UMODEM_SERIAL_DEV=/tmp/m65 ./server_posix
+ */
+
+#define DIAG_PORT 9000
+#define MAX_CLIENTS 2
+#define SERVE_TIMEOUT_MS 60000
+
+umodem_apn_t apn_config = {
+    .apn = "internet",
+    .user = "",
+    .pass = "",
+};
+
+static uint32_t readable; // Bit per sockfd with data waiting
+
+static void on_data(umodem_event_t *event, void *user_ctx)
+{
+  int sockfd = *(int *)umodem_get_event_data(event);
+  if (sockfd > 0 && sockfd < 32)
+    readable |= 1UL << sockfd;
+}
+
+// Answer one request, returns 0 once the client asked to quit
+static int serve(int sockfd, const char *request)
+{
+  char reply[128];
+  if (strcmp(request, "status") == 0)
+  {
+    umodem_status_t status;
+    umodem_get_status(&status);
+    snprintf(reply, sizeof(reply), "imei %s rssi %d reg %d\n", status.imei, status.rssi, status.reg_stat);
+  }
+  else if (strcmp(request, "quit") == 0)
+    snprintf(reply, sizeof(reply), "bye\n");
+  else
+    snprintf(reply, sizeof(reply), "unknown request '%s'\n", request);
+
+  umodem_sock_send(sockfd, reply, strlen(reply));
+  return strcmp(request, "quit") != 0;
+}
+
+int main()
+{
+  if (umodem_init(&apn_config) != UMODEM_OK || umodem_sock_init() != UMODEM_OK)
+  {
+    printf("Failed to initialize uModem\n");
+    return -1;
+  }
+
+  umodem_event_subscribe(UMODEM_EVENT_MASK(UMODEM_EVENT_SOCK_DATA_RECEIVED), on_data, NULL);
+
+  if (umodem_sock_listen(UMODEM_SOCK_TCP, DIAG_PORT, MAX_CLIENTS) != UMODEM_OK)
+  {
+    printf("Failed to listen on port %d\n", DIAG_PORT);
+    return -1;
+  }
+  printf("Listening on port %d\n", DIAG_PORT);
+
+  int running = 1, served = 0;
+  uint32_t start = umodem_hal_millis();
+  while (running && umodem_hal_millis() - start < SERVE_TIMEOUT_MS)
+  {
+    uint32_t next = umodem_poll();
+
+    int client;
+    while ((client = umodem_sock_accept()) > 0)
+      printf("Client connected on fd %d\n", client);
+
+    for (uint32_t pending = readable; pending; pending &= pending - 1)
+    {
+      int sockfd = __builtin_ctz(pending);
+      readable &= ~(1UL << sockfd);
+
+      char request[64];
+      int len = umodem_sock_recv(sockfd, request, sizeof(request) - 1);
+      if (len <= 0)
+        continue;
+      request[len] = '\0';
+      request[strcspn(request, "\r\n")] = '\0';
+      printf("fd %d: %s\n", sockfd, request);
+      served++;
+      if (!serve(sockfd, request))
+      {
+        umodem_sock_close(sockfd);
+        running = 0;
+      }
+    }
+    umodem_wait(next < 100 ? next : 100);
+  }
+
+  printf("%s (%d requests)\n", running ? "Timed out" : "Done", served);
+  umodem_sock_unlisten();
+  umodem_sock_deinit();
+  umodem_deinit();
+  return running ? -1 : 0;
+}
@@ -0,0 +1,774 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <string.h>
+
+#include "m65_sim.hpp"
+
+#define CTRL_Z 0x1A
+
+static const char* const SIM_IMEI = "866425030000000";
+static const char* const SIM_ICCID = "89620000000000000000";
+static const char* const SIM_PEER_IP = "127.0.0.1";
+static const char* const SIM_REMOTE_IP = "10.0.0.2"; // Inbound clients
+
+/* Split "a,\"b,c\",d" into {"a", "b,c", "d"} (quotes removed). */
+static std::vector<std::string> split_args(const std::string& s) {
+  std::vector<std::string> args;
+  std::string cur;
+  bool quoted = false;
+  for (char c : s) {
+    if (c == '"')
+      quoted = !quoted;
+    else if (c == ',' && !quoted) {
+      args.push_back(cur);
+      cur.clear();
+    } else
+      cur += c;
+  }
+  if (!s.empty()) args.push_back(cur);
+  return args;
+}
+
+/* Split concatenated extended commands "+A=1;+B=\"x;y\"". */
+static std::vector<std::string> split_commands(const std::string& s) {
+  std::vector<std::string> cmds;
+  std::string cur;
+  bool quoted = false;
+  for (char c : s) {
+    if (c == '"') quoted = !quoted;
+    if (c == ';' && !quoted) {
+      cmds.push_back(cur);
+      cur.clear();
+    } else
+      cur += c;
+  }
+  cmds.push_back(cur);
+  return cmds;
+}
+
+static int to_int(const std::string& s) { return atoi(s.c_str()); }
+
+/* Path of "scheme://host[:port]/path", "/" when there is none. */
+static std::string url_path(const std::string& url) {
+  size_t host = url.find("://");
+  size_t slash = url.find('/', host == std::string::npos ? 0 : host + 3);
+  return slash == std::string::npos ? "/" : url.substr(slash);
+}
+
+// GSM 07.10 basic option framing
+enum : uint8_t {
+  MUX_FLAG = 0xF9,
+  MUX_EA = 0x01,
+  MUX_CR = 0x02,
+  MUX_PF = 0x10,
+  MUX_SABM = 0x2F,
+  MUX_UA = 0x63,
+  MUX_DISC = 0x43,
+  MUX_UIH = 0xEF,
+  MUX_MSG_NSC = 0x11,
+  MUX_MSG_CLD = 0xC1,
+  MUX_MSG_MSC = 0xE1,
+};
+
+enum { RX_HUNT, RX_ADDR, RX_CTRL, RX_LEN, RX_INFO, RX_FCS, RX_END };
+
+static const size_t MUX_N1 = 127;
+
+static uint8_t mux_fcs(uint8_t fcs, const uint8_t* data, size_t len) {
+  static const auto table = [] {
+    std::vector<uint8_t> t(256);
+    for (unsigned i = 0; i < 256; i++) {
+      uint8_t crc = (uint8_t)i;
+      for (int bit = 0; bit < 8; bit++)
+        crc = (crc & 1) ? (uint8_t)((crc >> 1) ^ 0xE0) : (uint8_t)(crc >> 1);
+      t[i] = crc;
+    }
+    return t;
+  }();
+  while (len--) fcs = table[fcs ^ *data++];
+  return fcs;
+}
+
+/* MQTT topic filter match with '+' and '#' wildcards. */
+static bool topic_matches(const std::string& filter, const std::string& topic) {
+  size_t f = 0, t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') t++;
+      f++;
+      continue;
+    }
+    if (t >= topic.size() || filter[f] != topic[t]) return false;
+    f++;
+    t++;
+  }
+  return t == topic.size();
+}
+
+M65Sim::M65Sim(const M65SimConfig& config)
+    : config_(config), rng_(config.seed), echo_(config.echo) {}
+
+bool M65Sim::fault(double rate) {
+  if (rate <= 0.0) return false;
+  return std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < rate;
+}
+
+void M65Sim::queue(const std::string& bytes, uint64_t now_ms) {
+  // Keep output ordered even if the latency is changed on the fly
+  uint64_t due = now_ms + config_.latency_ms;
+  if (due < last_due_ms_) due = last_due_ms_;
+  last_due_ms_ = due;
+  pending_.push_back({due, bytes});
+}
+
+void M65Sim::send(int dlci, const std::string& data, uint64_t now_ms) {
+  if (!mux_) {
+    queue(data, now_ms);
+    return;
+  }
+  for (size_t off = 0; off < data.size(); off += MUX_N1)
+    send_frame(dlci, MUX_UIH, false, data.substr(off, MUX_N1), now_ms);
+}
+
+void M65Sim::send_frame(int dlci, uint8_t ctrl, bool cr,
+    const std::string& info, uint64_t now_ms) {
+  std::string frame;
+  frame += (char)MUX_FLAG;
+  frame += (char)((dlci << 2) | (cr ? MUX_CR : 0) | MUX_EA);
+  frame += (char)ctrl;
+  frame += (char)((info.size() << 1) | MUX_EA);
+
+  uint8_t fcs = mux_fcs(0xFF, (const uint8_t*)frame.data() + 1, 3);
+  if ((ctrl & ~MUX_PF) != MUX_UIH)
+    fcs = mux_fcs(fcs, (const uint8_t*)info.data(), info.size());
+
+  frame += info;
+  frame += (char)(0xFF - fcs);
+  frame += (char)MUX_FLAG;
+  queue(frame, now_ms);
+}
+
+void M65Sim::inject_urc(const std::string& line, uint64_t now_ms) {
+  emit_urc("\r\n" + line + "\r\n", now_ms);
+  poll(now_ms);
+}
+
+int M65Sim::dial(const std::string& data, uint64_t now_ms) {
+  if (listen_max_ == 0) return -1;
+  size_t inbound = 0;
+  for (const auto& it : sockets_) inbound += it.second.server ? 1 : 0;
+  if (inbound >= listen_max_) return -1;
+
+  // Inbound connections take the lowest free index, like outbound ones
+  int id = 0;
+  while (id < 6 && sockets_.count(id)) id++;
+  if (id == 6) return -1;
+
+  Socket& s = sockets_[id];
+  s.open = true;
+  s.server = true;
+  s.proto = "TCP";
+  s.host = SIM_REMOTE_IP;
+  s.port = listen_port_;
+  s.rx = data;
+  emit_urc("\r\n" + std::to_string(id) + ", REMOTE IP: " + SIM_REMOTE_IP +
+               "\r\n",
+      now_ms);
+  if (!data.empty())
+    emit_urc("\r\n+QIRDI: 0,2," + std::to_string(id) + "\r\n", now_ms);
+  poll(now_ms);
+  return id;
+}
+
+void M65Sim::hangup(int id, uint64_t now_ms) {
+  auto it = sockets_.find(id);
+  if (it == sockets_.end() || !it->second.server) return;
+  sockets_.erase(it);
+  emit_urc("\r\n" + std::to_string(id) + ", CLOSED\r\n", now_ms);
+  poll(now_ms);
+}
+
+uint64_t M65Sim::poll(uint64_t now_ms) {
+  while (!pending_.empty() && pending_.front().due_ms <= now_ms) {
+    Pending p = std::move(pending_.front());
+    pending_.pop_front();
+    if (p.set_baudrate)
+      baudrate_ = p.baudrate;
+    else if (output_)
+      output_(p.data.data(), p.data.size());
+  }
+  if (pending_.empty()) return UINT64_MAX;
+  return pending_.front().due_ms - now_ms;
+}
+
+void M65Sim::input(const uint8_t* data, size_t len, uint64_t now_ms) {
+  if (!mux_ && channels_[0].mode == Mode::TRANSPARENT) {
+    transparent_input(0, std::string((const char*)data, len), now_ms);
+    poll(now_ms);
+    return;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (mux_)
+      mux_byte(data[i], now_ms);
+    else
+      channel_byte(0, (char)data[i], now_ms);
+  }
+  poll(now_ms);
+}
+
+void M65Sim::channel_byte(int dlci, char c, uint64_t now_ms) {
+  ch_ = dlci;
+  Channel& ch = chan();
+  switch (ch.mode) {
+  case Mode::SEND_FIXED:
+    ch.data += c;
+    if (ch.data.size() == ch.data_expected) finish_send(now_ms);
+    break;
+
+  case Mode::SEND_CTRL_Z:
+    if (c == CTRL_Z)
+      finish_publish(now_ms);
+    else
+      ch.data += c;
+    break;
+
+  case Mode::PPP:
+    ppp_byte((uint8_t)c, now_ms);
+    break;
+
+  case Mode::TRANSPARENT:
+    break; // Whole chunks go to transparent_input()
+
+  case Mode::COMMAND:
+    if (c == '\r') {
+      std::string line;
+      line.swap(ch.line);
+      if (!line.empty()) handle_line(line, now_ms);
+    } else if (c != '\n')
+      ch.line += c;
+    break;
+  }
+}
+
+void M65Sim::mux_byte(uint8_t b, uint64_t now_ms) {
+  MuxRx& rx = mux_rx_;
+  switch (rx.state) {
+  case RX_HUNT:
+    if (b == MUX_FLAG) rx.state = RX_ADDR;
+    break;
+  case RX_ADDR:
+    if (b == MUX_FLAG) break;
+    rx.addr = b;
+    rx.fcs = mux_fcs(0xFF, &b, 1);
+    rx.state = (b & MUX_EA) ? RX_CTRL : RX_HUNT;
+    break;
+  case RX_CTRL:
+    rx.ctrl = b;
+    rx.fcs = mux_fcs(rx.fcs, &b, 1);
+    rx.state = RX_LEN;
+    break;
+  case RX_LEN:
+    // Only the one-octet length form, N1 is 127
+    rx.fcs = mux_fcs(rx.fcs, &b, 1);
+    rx.len = b >> 1;
+    rx.info.clear();
+    rx.state = !(b & MUX_EA) ? RX_HUNT : rx.len ? RX_INFO : RX_FCS;
+    break;
+  case RX_INFO:
+    rx.info += (char)b;
+    if (rx.info.size() == rx.len) rx.state = RX_FCS;
+    break;
+  case RX_FCS:
+    if ((rx.ctrl & ~MUX_PF) != MUX_UIH)
+      rx.fcs = mux_fcs(rx.fcs, (const uint8_t*)rx.info.data(), rx.len);
+    rx.state = mux_fcs(rx.fcs, &b, 1) == 0xCF ? RX_END : RX_HUNT;
+    break;
+  case RX_END:
+    rx.state = b == MUX_FLAG ? RX_ADDR : RX_HUNT;
+    if (b == MUX_FLAG) mux_frame(now_ms);
+    break;
+  }
+}
+
+void M65Sim::mux_frame(uint64_t now_ms) {
+  int dlci = mux_rx_.addr >> 2;
+  switch (mux_rx_.ctrl & ~MUX_PF) {
+  case MUX_SABM:
+    channels_[dlci] = Channel();
+    send_frame(dlci, MUX_UA | MUX_PF, true, "", now_ms);
+    if (dlci != 0) {
+      // Report the V.24 signals of the new DLC, like the real modem does
+      std::string msc = {(char)(MUX_MSG_MSC | MUX_CR), (char)((2 << 1) | MUX_EA),
+          (char)((dlci << 2) | MUX_CR | MUX_EA), (char)0x8D};
+      send_frame(0, MUX_UIH, false, msc, now_ms);
+    }
+    break;
+
+  case MUX_DISC:
+    channels_.erase(dlci);
+    send_frame(dlci, MUX_UA | MUX_PF, true, "", now_ms);
+    if (dlci == 0) mux_ = false;
+    break;
+
+  case MUX_UIH:
+    if (dlci == 0)
+      mux_control(now_ms);
+    else if (channels_.count(dlci) &&
+             channels_[dlci].mode == Mode::TRANSPARENT)
+      transparent_input(dlci, mux_rx_.info, now_ms);
+    else if (channels_.count(dlci))
+      for (char c : mux_rx_.info) channel_byte(dlci, c, now_ms);
+    break;
+  }
+}
+
+void M65Sim::mux_control(uint64_t now_ms) {
+  const std::string& info = mux_rx_.info;
+  if (info.size() < 2 || !(info[0] & MUX_CR)) return; // Responses are ignored
+
+  uint8_t type = (uint8_t)info[0] & ~MUX_CR;
+  std::string response = info;
+  response[0] = (char)type;
+
+  if (type == MUX_MSG_MSC) {
+    send_frame(0, MUX_UIH, false, response, now_ms);
+  } else if (type == MUX_MSG_CLD) {
+    send_frame(0, MUX_UIH, false, response, now_ms);
+    channels_.clear();
+    mux_ = false;
+  } else {
+    std::string nsc = {(char)MUX_MSG_NSC, (char)((1 << 1) | MUX_EA), info[0]};
+    send_frame(0, MUX_UIH, false, nsc, now_ms);
+  }
+}
+
+void M65Sim::handle_line(const std::string& raw, uint64_t now_ms) {
+  if (echo_) emit(raw + "\r", now_ms);
+
+  // Like the real parser, hunt for the "AT" prefix (a stray "+++" escape
+  // sent in command mode ends up in front of the next command)
+  std::string line = raw;
+  for (size_t i = 0; i + 1 < raw.size(); i++) {
+    if ((raw[i] == 'A' || raw[i] == 'a') &&
+        (raw[i + 1] == 'T' || raw[i + 1] == 't')) {
+      line = raw.substr(i);
+      break;
+    }
+  }
+
+  if (line.size() < 2 || (line[0] != 'A' && line[0] != 'a') ||
+      (line[1] != 'T' && line[1] != 't')) {
+    emit("\r\nERROR\r\n", now_ms);
+    return;
+  }
+
+  if (fault(config_.drop_rate)) return;
+  if (fault(config_.error_rate)) {
+    emit("\r\nERROR\r\n", now_ms);
+    return;
+  }
+
+  body_.clear();
+  final_.clear();
+  after_.clear();
+  prompt_ = false;
+  ipr_pending_ = false;
+
+  std::string rest = line.substr(2);
+  if (!rest.empty()) {
+    for (const std::string& cmd : split_commands(rest)) {
+      if (!handle_command(cmd)) {
+        emit("\r\n+CME ERROR: 3\r\n", now_ms);
+        return;
+      }
+    }
+  }
+
+  if (prompt_)
+    emit(body_ + "\r\n> ", now_ms);
+  else
+    emit(body_ + (final_.empty() ? "\r\nOK\r\n" : final_), now_ms);
+
+  // Framing changes once the final result is out
+  if (enter_mux_) {
+    enter_mux_ = false;
+    mux_ = true;
+    mux_rx_ = MuxRx();
+  } else if (leave_mux_) {
+    leave_mux_ = false;
+    mux_ = false;
+    channels_.clear();
+  } else if (enter_ppp_) {
+    enter_ppp_ = false;
+    ppp_start(now_ms);
+  } else if (enter_transparent_) {
+    enter_transparent_ = false;
+    chan().mode = Mode::TRANSPARENT;
+    chan().data_target = 0;
+  }
+
+  // The OK still goes out at the old rate
+  if (ipr_pending_) {
+    ipr_pending_ = false;
+    Pending rate = {last_due_ms_, std::string(), true, ipr_baudrate_};
+    pending_.push_back(rate);
+  }
+
+  for (const std::string& urc : after_)
+    emit_urc("\r\n" + urc + "\r\n", now_ms);
+}
+
+bool M65Sim::handle_command(const std::string& cmd) {
+  std::string name = cmd, value;
+  bool query = false;
+  size_t eq = cmd.find('=');
+  if (eq != std::string::npos) {
+    name = cmd.substr(0, eq);
+    value = cmd.substr(eq + 1);
+  } else if (!cmd.empty() && cmd.back() == '?') {
+    name = cmd.substr(0, cmd.size() - 1);
+    query = true;
+  }
+  std::vector<std::string> args = split_args(value);
+
+  if (name == "E0" || name == "E1") {
+    echo_ = name == "E1";
+  } else if (name == "+CFUN") {
+    if (!args.empty() && args.size() > 1 && to_int(args[1]) == 1) {
+      // Reset: the host must wait for the modem to come back
+      echo_ = config_.echo;
+      qimux_ = false;
+      qimode_ = false;
+      leave_mux_ = mux_;
+      sockets_.clear();
+      listen_max_ = 0;
+      srvc_ = 1;
+      mqtt_.clear();
+      after_ = {"RDY", "+CFUN: 1", "+CPIN: READY", "Call Ready", "SMS Ready"};
+    }
+  } else if (name == "+CMEE" || name == "+QINDI" || name == "+QIREGAPP" ||
+             name == "+QIACT" || name == "+QIDNSIP" ||
+             name == "+CGDCONT" || name == "H" || name == "H0") {
+    // Accepted, no state to keep
+  } else if (name == "+CPIN" && query) {
+    body_ += "\r\n+CPIN: READY\r\n";
+  } else if (name == "+CREG") {
+    if (query)
+      body_ += "\r\n+CREG: 1,1\r\n";
+    else if (!args.empty() && to_int(args[0]) == 1)
+      after_.push_back("+CREG: 1");
+  } else if (name == "+CGSN") {
+    body_ += std::string("\r\n") + SIM_IMEI + "\r\n";
+  } else if (name == "+QCCID") {
+    body_ += std::string("\r\n") + SIM_ICCID + "\r\n";
+  } else if (name == "+CSQ") {
+    body_ += "\r\n+CSQ: 21,0\r\n";
+  } else if (name == "+IPR") {
+    if (query)
+      body_ += "\r\n+IPR: " + std::to_string(baudrate_) + "\r\n";
+    else if (!args.empty()) {
+      ipr_pending_ = true;
+      ipr_baudrate_ = (uint32_t)to_int(args[0]);
+    }
+  } else if (name == "+IFC") {
+    if (query)
+      body_ += "\r\n+IFC: " + std::to_string(ifc_) + "," +
+               std::to_string(ifc_) + "\r\n";
+    else if (!args.empty())
+      ifc_ = to_int(args[0]) == 2 ? 2 : 0;
+  } else if (name == "+CMUX") {
+    // Only the basic option is supported
+    if (query)
+      body_ += "\r\n+CMUX: 0,0,5,127,10,3,30,10,2\r\n";
+    else if (args.empty() || to_int(args[0]) != 0 || mux_)
+      return false;
+    else
+      enter_mux_ = true;
+  } else if (name == "D*99#" || name == "D*99***1#") {
+    // Packet data call: PPP starts right after CONNECT
+    final_ = "\r\nCONNECT 115200\r\n";
+    enter_ppp_ = true;
+  } else if (name == "+QIMUX") {
+    if (!args.empty()) qimux_ = to_int(args[0]) == 1;
+  } else if (name == "+QIMODE") {
+    if (query)
+      body_ += "\r\n+QIMODE: " + std::to_string(qimode_ ? 1 : 0) + "\r\n";
+    else if (!args.empty())
+      qimode_ = to_int(args[0]) == 1;
+  } else if (name == "+QIDEACT") {
+    sockets_.clear();
+    listen_max_ = 0;
+    final_ = "\r\nDEACT OK\r\n";
+  } else if (name == "+QIOPEN") {
+    // AT+QIOPEN=<id>,"<proto>","<host>",<port>, without <id> if QIMUX=0
+    size_t first = qimux_ ? 1 : 0;
+    if (args.size() < first + 3) return false;
+    int id = qimux_ ? to_int(args[0]) : 0;
+    Socket& s = sockets_[id];
+    if (s.open) {
+      after_.push_back(qimux_ ? std::to_string(id) + ", ALREADY CONNECT"
+                              : std::string("ALREADY CONNECT"));
+      return true;
+    }
+    if (config_.refuse_connect) {
+      after_.push_back(qimux_ ? std::to_string(id) + ", CONNECT FAIL"
+                              : std::string("CONNECT FAIL"));
+      return true;
+    }
+    s.open = true;
+    s.proto = args[first];
+    s.host = args[first + 1];
+    s.port = to_int(args[first + 2]);
+    s.rx.clear();
+    s.datagrams.clear();
+    if (qimode_ && !qimux_) {
+      // CONNECT follows on the command's own channel
+      final_ = "\r\nOK\r\n\r\nCONNECT\r\n";
+      enter_transparent_ = true;
+    } else {
+      after_.push_back(qimux_ ? std::to_string(id) + ", CONNECT OK"
+                              : std::string("CONNECT OK"));
+    }
+  } else if (name == "+QIDNSGIP") {
+    // Answered after OK; names under .invalid do not resolve
+    if (args.empty()) return false;
+    const std::string& host = args[0];
+    bool invalid = host.size() >= 8 &&
+                   host.compare(host.size() - 8, 8, ".invalid") == 0;
+    after_.push_back(invalid ? std::string("ERROR") : SIM_PEER_IP);
+  } else if (name == "+QILPORT") {
+    // AT+QILPORT="TCP",<port>
+    if (args.size() < 2 || args[0] != "TCP") return false;
+    listen_port_ = (uint16_t)to_int(args[1]);
+  } else if (name == "+QISERVER") {
+    // AT+QISERVER=0,<max>: answered with SERVER OK once listening
+    if (!qimux_ || listen_port_ == 0 || listen_max_ > 0) return false;
+    int max = args.size() < 2 ? 1 : to_int(args[1]);
+    if (max < 1) return false;
+    listen_max_ = (size_t)max;
+    after_.push_back("SERVER OK");
+  } else if (name == "+QISRVC") {
+    if (query)
+      body_ += "\r\n+QISRVC: " + std::to_string(srvc_) + "\r\n";
+    else if (args.empty() || (to_int(args[0]) != 1 && to_int(args[0]) != 2))
+      return false;
+    else
+      srvc_ = to_int(args[0]);
+  } else if (name == "+QICLOSE" && args.empty() && srvc_ == 2) {
+    // Server context without an index: stop listening, drop inbound peers
+    if (listen_max_ == 0) return false;
+    listen_max_ = 0;
+    for (auto it = sockets_.begin(); it != sockets_.end();) {
+      if (it->second.server)
+        it = sockets_.erase(it);
+      else
+        ++it;
+    }
+    final_ = "\r\nCLOSE OK\r\n";
+  } else if (name == "+QICLOSE") {
+    int id = args.empty() ? 0 : to_int(args[0]);
+    auto it = sockets_.find(id);
+    if (it != sockets_.end() && it->second.server != (srvc_ == 2))
+      return false;
+    sockets_.erase(id);
+    final_ = qimux_ ? "\r\n" + std::to_string(id) + ", CLOSE OK\r\n"
+                    : std::string("\r\nCLOSE OK\r\n");
+  } else if (name == "+QISEND") {
+    // AT+QISEND=<id>,<len>
+    if (args.size() < 2) return false;
+    int id = to_int(args[0]);
+    auto it = sockets_.find(id);
+    if (it == sockets_.end() || !it->second.open) return false;
+    if (it->second.server != (srvc_ == 2)) return false;
+    Channel& ch = chan();
+    ch.mode = Mode::SEND_FIXED;
+    ch.payload = Payload::SOCKET;
+    ch.data.clear();
+    ch.data_expected = (size_t)to_int(args[1]);
+    ch.data_target = id;
+    prompt_ = true;
+  } else if (name == "+QIRD") {
+    // AT+QIRD=0,<1 = client, 2 = server>,<id>,<len>
+    if (args.size() < 4) return false;
+    int id = to_int(args[2]);
+    auto it = sockets_.find(id);
+    if (it == sockets_.end()) return false;
+    if (it->second.server != (to_int(args[1]) == 2)) return false;
+    Socket& s = it->second;
+    size_t n = std::min(s.rx.size(), (size_t)to_int(args[3]));
+    if (!s.datagrams.empty()) {
+      // The rest of a datagram longer than <len> comes with the next read
+      n = std::min(n, s.datagrams.front());
+      if (n == s.datagrams.front())
+        s.datagrams.pop_front();
+      else
+        s.datagrams.front() -= n;
+    }
+    if (n > 0) {
+      body_ += "\r\n+QIRD: " + std::string(SIM_PEER_IP) + ":" +
+               std::to_string(s.port) + "," + s.proto + "," +
+               std::to_string(n) + "\r\n" + s.rx.substr(0, n);
+      s.rx.erase(0, n);
+    }
+  } else if (name == "+QHTTPURL" || name == "+QHTTPPOST") {
+    // AT+QHTTPURL=<len>,<time> / AT+QHTTPPOST=<len>,<time>,<time>
+    if (args.empty() || to_int(args[0]) <= 0) return false;
+    if (name == "+QHTTPPOST" && http_url_.empty()) return false;
+    Channel& ch = chan();
+    ch.mode = Mode::SEND_FIXED;
+    ch.payload = name == "+QHTTPURL" ? Payload::HTTP_URL : Payload::HTTP_POST;
+    ch.data.clear();
+    ch.data_expected = (size_t)to_int(args[0]);
+    final_ = "\r\nCONNECT\r\n";
+  } else if (name == "+QHTTPGET") {
+    if (http_url_.empty()) return false;
+    int status = 0;
+    http_body_ = http_resource("GET", url_path(http_url_), "", status);
+    if (status != 200) final_ = "\r\n+CME ERROR: 3822\r\n";
+  } else if (name == "+QHTTPREAD") {
+    body_ += "\r\nCONNECT\r\n" + http_body_;
+  } else if (name == "+QHTTPCFG") {
+    // Accepted, no state to keep
+  } else if (name == "+QMTCFG") {
+    // Accepted, no state to keep
+  } else if (name == "+QMTOPEN") {
+    if (args.size() < 3) return false;
+    int id = to_int(args[0]);
+    mqtt_[id].open = true;
+    after_.push_back("+QMTOPEN: " + std::to_string(id) + ",0");
+  } else if (name == "+QMTCONN") {
+    if (args.empty()) return false;
+    int id = to_int(args[0]);
+    if (!mqtt_[id].open) return false;
+    mqtt_[id].connected = true;
+    after_.push_back("+QMTCONN: " + std::to_string(id) + ",0,0");
+  } else if (name == "+QMTSUB") {
+    // AT+QMTSUB=<id>,<msgid>,"<topic>",<qos>
+    if (args.size() < 4) return false;
+    int id = to_int(args[0]);
+    if (!mqtt_[id].connected) return false;
+    mqtt_[id].topics.push_back(args[2]);
+    after_.push_back("+QMTSUB: " + args[0] + "," + args[1] + ",0," + args[3]);
+  } else if (name == "+QMTUNS") {
+    if (args.size() < 3) return false;
+    auto& topics = mqtt_[to_int(args[0])].topics;
+    for (auto it = topics.begin(); it != topics.end(); ++it) {
+      if (*it == args[2]) {
+        topics.erase(it);
+        break;
+      }
+    }
+    after_.push_back("+QMTUNS: " + args[0] + "," + args[1] + ",0");
+  } else if (name == "+QMTPUB") {
+    // AT+QMTPUB=<id>,<msgid>,<qos>,<retain>,"<topic>"
+    if (args.size() < 5) return false;
+    int id = to_int(args[0]);
+    if (!mqtt_[id].connected) return false;
+    Channel& ch = chan();
+    ch.mode = Mode::SEND_CTRL_Z;
+    ch.data.clear();
+    ch.data_target = id;
+    ch.publish_msg_id = to_int(args[1]);
+    ch.publish_topic = args[4];
+    prompt_ = true;
+  } else if (name == "+QMTDISC") {
+    if (args.empty()) return false;
+    mqtt_.erase(to_int(args[0]));
+    after_.push_back("+QMTDISC: " + args[0] + ",0");
+  } else if (name == "+QMTCLOSE") {
+    if (args.empty()) return false;
+    mqtt_.erase(to_int(args[0]));
+    after_.push_back("+QMTCLOSE: " + args[0] + ",0");
+  } else if (!name.empty()) {
+    return false;
+  }
+
+  return true;
+}
+
+void M65Sim::finish_send(uint64_t now_ms) {
+  Channel& ch = chan();
+  ch.mode = Mode::COMMAND;
+
+  if (ch.payload == Payload::HTTP_URL) {
+    http_url_ = ch.data;
+    emit("\r\nOK\r\n", now_ms);
+    return;
+  }
+  if (ch.payload == Payload::HTTP_POST) {
+    int status = 0;
+    http_body_ = http_resource("POST", url_path(http_url_), ch.data, status);
+    emit(status == 200 ? "\r\nOK\r\n" : "\r\n+CME ERROR: 3822\r\n",
+        now_ms);
+    return;
+  }
+
+  emit("\r\nSEND OK\r\n", now_ms);
+
+  // Local echo: the peer sends everything straight back, except on port 80
+  // where an HTTP server answers complete requests
+  auto it = sockets_.find(ch.data_target);
+  if (it == sockets_.end()) return;
+  Socket& s = it->second;
+  if (s.server) {
+    if (inbound_output_) inbound_output_(ch.data_target, ch.data);
+    return;
+  }
+  bool was_empty = s.rx.empty();
+  if (s.port == 80) {
+    s.request += ch.data;
+    std::string response;
+    while (http_serve(s.request, response)) s.rx += response;
+  } else {
+    s.rx += ch.data;
+    if (s.proto == "UDP") s.datagrams.push_back(ch.data.size());
+  }
+  if (was_empty && !s.rx.empty())
+    emit_urc(
+        "\r\n+QIRDI: 0,1," + std::to_string(ch.data_target) + "\r\n", now_ms);
+}
+
+void M65Sim::transparent_input(
+    int dlci, const std::string& data, uint64_t now_ms) {
+  ch_ = dlci;
+  Channel& ch = chan();
+
+  // The host guards the escape with silence, so it arrives on its own
+  if (data == "+++") {
+    ch.mode = Mode::COMMAND;
+    ch.line.clear();
+    emit("\r\nOK\r\n", now_ms);
+    return;
+  }
+
+  // Same peers as AT+QISEND, without the framing
+  Socket& s = sockets_[ch.data_target];
+  if (s.port == 80) {
+    s.request += data;
+    std::string response;
+    while (http_serve(s.request, response)) emit(response, now_ms);
+  } else {
+    emit(data, now_ms);
+  }
+}
+
+void M65Sim::finish_publish(uint64_t now_ms) {
+  Channel& ch = chan();
+  ch.mode = Mode::COMMAND;
+  std::string id = std::to_string(ch.data_target);
+  std::string msg_id = std::to_string(ch.publish_msg_id);
+  emit("\r\nOK\r\n", now_ms);
+  emit_urc("\r\n+QMTPUB: " + id + "," + msg_id + ",0\r\n", now_ms);
+
+  // Local broker: deliver back to matching subscriptions
+  for (const std::string& filter : mqtt_[ch.data_target].topics) {
+    if (topic_matches(filter, ch.publish_topic)) {
+      // Unquoted topic and payload, as parsed by the driver
+      emit_urc("\r\n+QMTRECV: " + id + "," + msg_id + "," +
+                   ch.publish_topic + "," + ch.data + "\r\n",
+          now_ms);
+      break;
+    }
+  }
+}
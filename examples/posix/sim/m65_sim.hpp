@@ -0,0 +1,235 @@
+#ifndef M65_SIM_HPP_
+#define M65_SIM_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Virtual Quectel M65.
+ *
+ * Answers the AT command subset used by drivers/quectel_m65.c.in. TCP/UDP
+ * sockets and MQTT connections are backed by a local echo: data sent on a
+ * socket is read back with AT+QIRD (one datagram per read on UDP), and MQTT
+ * publishes are delivered back as +QMTRECV to matching subscriptions on the
+ * same connection.
+ *
+ * AT+CMUX=0 switches to GSM 07.10 basic framing: every DLC the host opens
+ * gets its own command parser, responses go back on the DLC the command
+ * came from and URCs on DLC 1.
+ *
+ * Sockets to port 80 and the AT+QHTTP* commands are served by a small
+ * HTTP server instead (see m65_sim_http.cpp).
+ *
+ * ATD*99# answers CONNECT and turns the channel into a PPP peer (see
+ * m65_sim_ppp.cpp): it negotiates LCP and IPCP, assigns the host an address
+ * and reflects every IPv4 packet back to its sender. "+++" or an LCP
+ * Terminate-Request returns the channel to command mode.
+ *
+ * AT+QILPORT and AT+QISERVER start a TCP listener: dial() has a remote
+ * client connect to it and send a request, reported as "<id>, REMOTE IP".
+ * Such inbound connections do not echo; what the host sends on them goes
+ * to the inbound output callback. AT+QISRVC selects which kind of
+ * connection AT+QISEND and AT+QICLOSE act on.
+ *
+ * With AT+QIMODE=1 and AT+QIMUX=0, AT+QIOPEN answers CONNECT and the
+ * channel becomes a transparent pipe to the socket's echo (or HTTP server).
+ * A "+++" written on its own returns it to command mode.
+ *
+ * The engine is transport agnostic: bytes from the host go in through
+ * input(), bytes for the host leave through the output callback once their
+ * latency has elapsed (see poll()).
+ */
+
+struct M65SimConfig {
+  uint32_t latency_ms = 0;     // Delay before every response / URC
+  double error_rate = 0.0;     // Probability a command answers ERROR
+  double drop_rate = 0.0;      // Probability a command gets no answer at all
+  uint32_t seed = 1;           // Seed for fault injection
+  bool echo = true;            // Initial ATE state
+  bool refuse_connect = false; // Answer AT+QIOPEN with CONNECT FAIL
+};
+
+class M65Sim {
+public:
+  using Output = std::function<void(const char* data, size_t len)>;
+  using InboundOutput = std::function<void(int id, const std::string& data)>;
+
+  explicit M65Sim(const M65SimConfig& config = M65SimConfig());
+
+  void set_output(Output output) { output_ = std::move(output); }
+  void set_inbound_output(InboundOutput output) {
+    inbound_output_ = std::move(output);
+  }
+  M65SimConfig& config() { return config_; }
+
+  /* Feed bytes written by the host. */
+  void input(const uint8_t* data, size_t len, uint64_t now_ms);
+
+  /* Queue an unsolicited line ("\r\n<line>\r\n"). */
+  void inject_urc(const std::string& line, uint64_t now_ms);
+
+  /* Have a remote client connect to the AT+QISERVER listener and send
+   * data (may be empty). Returns the connection index, or -1 if nothing
+   * listens or every index is taken. */
+  int dial(const std::string& data, uint64_t now_ms);
+
+  /* Have the remote client of an inbound connection hang up. */
+  void hangup(int id, uint64_t now_ms);
+
+  /* Flush due output. Returns ms until the next pending output, or
+   * UINT64_MAX if nothing is pending. */
+  uint64_t poll(uint64_t now_ms);
+
+  /* Current UART rate set with AT+IPR (0 = autobaud). A new rate takes
+   * effect once the OK answering AT+IPR has been output. */
+  uint32_t baudrate() const { return baudrate_; }
+
+  /* Whether the link is in CMUX framing. */
+  bool muxed() const { return mux_; }
+
+private:
+  enum class Mode { COMMAND, SEND_FIXED, SEND_CTRL_Z, PPP, TRANSPARENT };
+
+  // PPP peer state of a channel in data mode
+  struct Ppp {
+    std::string frame;
+    bool in_frame = false;
+    bool escape = false;
+    size_t plus = 0;            // '+' seen between frames
+    uint8_t id = 0;
+    uint32_t host_accm = 0xFFFFFFFF;
+    bool lcp_acked = false;     // The host acked our LCP request
+    bool lcp_host_acked = false;
+    bool ipcp_sent = false;
+  };
+
+  // Destination of a fixed-length payload
+  enum class Payload { SOCKET, HTTP_URL, HTTP_POST };
+
+  // Command parser state of one channel (the plain link or a DLC)
+  struct Channel {
+    Mode mode = Mode::COMMAND;
+    Payload payload = Payload::SOCKET;
+    std::string line;
+    std::string data;
+    size_t data_expected = 0;
+    int data_target = -1;
+    int publish_msg_id = 0;
+    std::string publish_topic;
+    Ppp ppp;
+  };
+
+  // CMUX frame being decoded
+  struct MuxRx {
+    int state = 0;
+    uint8_t addr = 0;
+    uint8_t ctrl = 0;
+    uint8_t fcs = 0;
+    size_t len = 0;
+    std::string info;
+  };
+
+  struct Socket {
+    bool open = false;
+    std::string proto;
+    std::string host;
+    int port = 0;
+    std::string rx;
+    std::deque<size_t> datagrams; // UDP: length of each datagram in rx
+    std::string request; // HTTP request being received (port 80)
+    bool server = false;  // Inbound connection accepted by the listener
+  };
+
+  struct MqttConn {
+    bool open = false;
+    bool connected = false;
+    std::vector<std::string> topics;
+  };
+
+  struct Pending {
+    uint64_t due_ms;
+    std::string data;
+    bool set_baudrate = false; // Switch to baudrate once data is out
+    uint32_t baudrate = 0;
+  };
+
+  void queue(const std::string& bytes, uint64_t now_ms);
+  void send(int dlci, const std::string& data, uint64_t now_ms);
+  void send_frame(int dlci, uint8_t ctrl, bool cr, const std::string& info,
+      uint64_t now_ms);
+  void emit(const std::string& data, uint64_t now_ms) {
+    send(ch_, data, now_ms);
+  }
+  void emit_urc(const std::string& data, uint64_t now_ms) {
+    send(mux_ ? 1 : 0, data, now_ms);
+  }
+  Channel& chan() { return channels_[ch_]; }
+  void channel_byte(int dlci, char c, uint64_t now_ms);
+  void mux_byte(uint8_t b, uint64_t now_ms);
+  void mux_frame(uint64_t now_ms);
+  void mux_control(uint64_t now_ms);
+  void handle_line(const std::string& line, uint64_t now_ms);
+  bool handle_command(const std::string& cmd);
+  void finish_send(uint64_t now_ms);
+  void finish_publish(uint64_t now_ms);
+  void transparent_input(int dlci, const std::string& data, uint64_t now_ms);
+  bool http_serve(std::string& request, std::string& response);
+  std::string http_resource(const std::string& method, const std::string& path,
+      const std::string& body, int& status);
+  void ppp_start(uint64_t now_ms);
+  void ppp_byte(uint8_t b, uint64_t now_ms);
+  void ppp_frame(const std::string& frame, uint64_t now_ms);
+  void ppp_lcp(const std::string& packet, uint64_t now_ms);
+  void ppp_ipcp(const std::string& packet, uint64_t now_ms);
+  void ppp_ip(std::string packet, uint64_t now_ms);
+  void ppp_send(uint16_t proto, const std::string& info, uint64_t now_ms);
+  void ppp_leave(const char* result, uint64_t now_ms);
+  bool fault(double rate);
+
+  M65SimConfig config_;
+  Output output_;
+  InboundOutput inbound_output_;
+  std::mt19937 rng_;
+  std::deque<Pending> pending_;
+  uint64_t last_due_ms_ = 0;
+
+  // Channel 0 is the plain link, DLCs use their own number
+  std::map<int, Channel> channels_;
+  int ch_ = 0;
+
+  bool mux_ = false;
+  bool enter_mux_ = false;
+  bool leave_mux_ = false;
+  bool enter_ppp_ = false;
+  bool enter_transparent_ = false;
+  MuxRx mux_rx_;
+
+  // Response being assembled for the current command line
+  std::string body_;
+  std::string final_;
+  std::vector<std::string> after_;
+  bool prompt_ = false;
+
+  bool echo_;
+  bool qimux_ = false;
+  bool qimode_ = false;
+  uint32_t baudrate_ = 115200;
+  bool ipr_pending_ = false;
+  uint32_t ipr_baudrate_ = 0;
+  int ifc_ = 0; // AT+IFC: 0 = none, 2 = RTS/CTS
+  std::map<int, Socket> sockets_;
+  uint16_t listen_port_ = 0; // AT+QILPORT
+  size_t listen_max_ = 0;    // Listening while non-zero (AT+QISERVER)
+  int srvc_ = 1;             // AT+QISRVC: 1 = client, 2 = server
+  std::map<int, MqttConn> mqtt_;
+  std::string http_url_;
+  std::string http_body_; // Response body for AT+QHTTPREAD
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "m65_sim.hpp"
+
+/* HTTP server behind sockets to port 80 and AT+QHTTP*.
+ *
+ *   GET /bytes/<n>     n bytes of "abc...z" repeated, honours Range
+ *   GET /chunked/<n>   same content, chunked transfer encoding on sockets
+ *                      (also for ranges)
+ *   POST <any>         echoes the request body
+ *   GET /              a short greeting
+ *
+ * Anything else is a 404.
+ */
+
+static const size_t HTTP_MAX_RESOURCE = 4 * 1024 * 1024;
+static const size_t HTTP_CHUNK = 1000;
+
+static std::string header_value(const std::string& head, const char* name) {
+  std::string lower;
+  for (char c : head) lower += (char)tolower((unsigned char)c);
+  size_t pos = lower.find(std::string("\r\n") + name + ":");
+  if (pos == std::string::npos) return "";
+  pos += 3 + strlen(name);
+  size_t end = head.find("\r\n", pos);
+  std::string value = head.substr(pos, end - pos);
+  while (!value.empty() && value[0] == ' ') value.erase(0, 1);
+  return value;
+}
+
+static const char* reason(int status) {
+  switch (status) {
+  case 200: return "OK";
+  case 206: return "Partial Content";
+  case 416: return "Range Not Satisfiable";
+  default: return "Not Found";
+  }
+}
+
+std::string M65Sim::http_resource(const std::string& method,
+    const std::string& path, const std::string& body, int& status) {
+  status = 200;
+  if (method == "POST") return body;
+
+  size_t size = 0;
+  if (path.compare(0, 7, "/bytes/") == 0)
+    size = strtoul(path.c_str() + 7, nullptr, 10);
+  else if (path.compare(0, 9, "/chunked/") == 0)
+    size = strtoul(path.c_str() + 9, nullptr, 10);
+  else if (path == "/")
+    return "Hello from m65_sim\n";
+  else
+    size = HTTP_MAX_RESOURCE + 1;
+
+  if (size > HTTP_MAX_RESOURCE) {
+    status = 404;
+    return "Not Found\n";
+  }
+
+  std::string content(size, 'a');
+  for (size_t i = 0; i < size; i++) content[i] = (char)('a' + i % 26);
+  return content;
+}
+
+bool M65Sim::http_serve(std::string& request, std::string& response) {
+  size_t head_end = request.find("\r\n\r\n");
+  if (head_end == std::string::npos) return false;
+
+  std::string head = request.substr(0, head_end + 2);
+  size_t body_len = strtoul(header_value(head, "content-length").c_str(),
+      nullptr, 10);
+  if (request.size() < head_end + 4 + body_len) return false;
+
+  std::string body = request.substr(head_end + 4, body_len);
+  request.erase(0, head_end + 4 + body_len);
+
+  // Request line: METHOD SP PATH SP VERSION
+  size_t sp1 = head.find(' ');
+  size_t sp2 = head.find(' ', sp1 + 1);
+  std::string method = head.substr(0, sp1);
+  std::string path = head.substr(sp1 + 1, sp2 - sp1 - 1);
+
+  int status = 0;
+  std::string content = http_resource(method, path, body, status);
+  std::string extra;
+
+  // Single range "bytes=<first>-[<last>]"
+  std::string range = header_value(head, "range");
+  if (status == 200 && method == "GET" &&
+      range.compare(0, 6, "bytes=") == 0) {
+    size_t dash = range.find('-');
+    size_t first = strtoul(range.c_str() + 6, nullptr, 10);
+    size_t last = dash + 1 < range.size()
+                      ? strtoul(range.c_str() + dash + 1, nullptr, 10)
+                      : content.size() - 1;
+    if (last >= content.size()) last = content.size() - 1;
+    size_t total = content.size();
+    if (first >= total || first > last) {
+      status = 416;
+      extra = "Content-Range: bytes */" + std::to_string(total) + "\r\n";
+      content.clear();
+    } else {
+      status = 206;
+      extra = "Content-Range: bytes " + std::to_string(first) + "-" +
+              std::to_string(last) + "/" + std::to_string(total) + "\r\n";
+      content = content.substr(first, last - first + 1);
+    }
+  }
+
+  response = "HTTP/1.1 " + std::to_string(status) + " " + reason(status) +
+             "\r\nContent-Type: application/octet-stream\r\n" + extra;
+
+  if ((status == 200 || status == 206) &&
+      path.compare(0, 9, "/chunked/") == 0) {
+    response += "Transfer-Encoding: chunked\r\n\r\n";
+    for (size_t off = 0; off < content.size(); off += HTTP_CHUNK) {
+      std::string chunk = content.substr(off, HTTP_CHUNK);
+      char size[16];
+      snprintf(size, sizeof(size), "%zx", chunk.size());
+      response += std::string(size) + "\r\n" + chunk + "\r\n";
+    }
+    response += "0\r\n\r\n";
+  } else {
+    response += "Content-Length: " + std::to_string(content.size()) +
+                "\r\n\r\n" + content;
+  }
+  return true;
+}
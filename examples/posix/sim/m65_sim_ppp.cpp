@@ -0,0 +1,277 @@
+#include <string.h>
+
+#include "m65_sim.hpp"
+
+/* PPP peer of a channel in data mode (RFC 1661/1662/1332).
+ *
+ * Only what a dial-up client needs: LCP without authentication, IPCP
+ * handing out SIM_HOST_ADDR and two DNS servers, Echo-Request replies. IPv4
+ * packets are reflected: source and destination addresses are swapped (and
+ * UDP ports, ICMP echo requests become replies), so the host receives every
+ * packet back as if the remote end echoed it.
+ */
+
+enum : uint8_t {
+  PPP_FLAG = 0x7E,
+  PPP_ESCAPE = 0x7D,
+  PPP_TRANS = 0x20,
+};
+
+enum : uint16_t {
+  PPP_IP = 0x0021,
+  PPP_IPCP = 0x8021,
+  PPP_LCP = 0xC021,
+};
+
+enum : uint8_t {
+  CP_CONF_REQ = 1,
+  CP_CONF_ACK = 2,
+  CP_CONF_NAK = 3,
+  CP_TERM_REQ = 5,
+  CP_TERM_ACK = 6,
+  LCP_ECHO_REQ = 9,
+  LCP_ECHO_REP = 10,
+};
+
+static const uint8_t SIM_PEER_ADDR[4] = {10, 64, 0, 1};
+static const uint8_t SIM_HOST_ADDR[4] = {10, 64, 0, 2};
+static const uint8_t SIM_DNS[2][4] = {{8, 8, 8, 8}, {8, 8, 4, 4}};
+static const uint32_t SIM_MAGIC = 0x4D363553; // "M65S"
+
+static uint16_t ppp_fcs(uint16_t fcs, const uint8_t* data, size_t len) {
+  static const auto table = [] {
+    std::vector<uint16_t> t(256);
+    for (unsigned i = 0; i < 256; i++) {
+      uint16_t v = (uint16_t)i;
+      for (int bit = 0; bit < 8; bit++)
+        v = (v & 1) ? (uint16_t)((v >> 1) ^ 0x8408) : (uint16_t)(v >> 1);
+      t[i] = v;
+    }
+    return t;
+  }();
+  while (len--) fcs = (uint16_t)((fcs >> 8) ^ table[(fcs ^ *data++) & 0xFF]);
+  return fcs;
+}
+
+static uint16_t be16(const std::string& s, size_t pos) {
+  return (uint16_t)(((uint8_t)s[pos] << 8) | (uint8_t)s[pos + 1]);
+}
+
+static std::string cp_packet(
+    uint8_t code, uint8_t id, const std::string& data) {
+  size_t len = data.size() + 4;
+  std::string p = {(char)code, (char)id, (char)(len >> 8), (char)len};
+  return p + data;
+}
+
+static std::string addr_option(uint8_t type, const uint8_t* addr) {
+  return std::string{(char)type, 6} + std::string((const char*)addr, 4);
+}
+
+static uint16_t inet_checksum(const uint8_t* data, size_t len) {
+  uint32_t sum = 0;
+  for (size_t i = 0; i + 1 < len; i += 2)
+    sum += (uint32_t)((data[i] << 8) | data[i + 1]);
+  if (len & 1) sum += (uint32_t)(data[len - 1] << 8);
+  while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+  return (uint16_t)~sum;
+}
+
+void M65Sim::ppp_start(uint64_t now_ms) {
+  Channel& ch = chan();
+  ch.mode = Mode::PPP;
+  ch.ppp = Ppp();
+
+  // ACCM 0 and a magic number, no authentication
+  std::string opts = {2, 6, 0, 0, 0, 0, 5, 6, (char)(SIM_MAGIC >> 24),
+      (char)(SIM_MAGIC >> 16), (char)(SIM_MAGIC >> 8), (char)SIM_MAGIC};
+  ppp_send(PPP_LCP, cp_packet(CP_CONF_REQ, ++ch.ppp.id, opts), now_ms);
+}
+
+void M65Sim::ppp_leave(const char* result, uint64_t now_ms) {
+  Channel& ch = chan();
+  ch.mode = Mode::COMMAND;
+  ch.ppp = Ppp();
+  ch.line.clear();
+  emit(std::string("\r\n") + result + "\r\n", now_ms);
+}
+
+void M65Sim::ppp_byte(uint8_t b, uint64_t now_ms) {
+  Ppp& p = chan().ppp;
+
+  if (b == PPP_FLAG) {
+    if (p.frame.size() >= 4 &&
+        ppp_fcs(0xFFFF, (const uint8_t*)p.frame.data(), p.frame.size()) ==
+            0xF0B8) {
+      std::string frame;
+      frame.swap(p.frame);
+      frame.resize(frame.size() - 2);
+      ppp_frame(frame, now_ms);
+    }
+    p.frame.clear();
+    p.in_frame = false;
+    p.escape = false;
+    p.plus = 0;
+    return;
+  }
+
+  // "+++" outside a frame escapes back to command mode
+  if (!p.in_frame && b == '+') {
+    if (++p.plus == 3) ppp_leave("OK", now_ms);
+    return;
+  }
+  p.in_frame = true;
+  p.plus = 0;
+
+  if (b == PPP_ESCAPE) {
+    p.escape = true;
+    return;
+  }
+  if (p.escape) {
+    b ^= PPP_TRANS;
+    p.escape = false;
+  }
+  p.frame += (char)b;
+}
+
+void M65Sim::ppp_frame(const std::string& frame, uint64_t now_ms) {
+  // Address and control fields are never compressed (ACFC is not acked)
+  if (frame.size() < 4 || (uint8_t)frame[0] != 0xFF ||
+      (uint8_t)frame[1] != 0x03)
+    return;
+  uint16_t proto = be16(frame, 2);
+  std::string info = frame.substr(4);
+
+  if (proto == PPP_LCP)
+    ppp_lcp(info, now_ms);
+  else if (proto == PPP_IPCP)
+    ppp_ipcp(info, now_ms);
+  else if (proto == PPP_IP)
+    ppp_ip(info, now_ms);
+}
+
+void M65Sim::ppp_lcp(const std::string& packet, uint64_t now_ms) {
+  if (packet.size() < 4) return;
+  Ppp& p = chan().ppp;
+  uint8_t code = (uint8_t)packet[0], id = (uint8_t)packet[1];
+  std::string data = packet.substr(4, be16(packet, 2) - 4);
+
+  switch (code) {
+  case CP_CONF_REQ:
+    // Everything the host asks for is fine, remember its ACCM
+    for (size_t pos = 0; pos + 2 <= data.size() && data[pos + 1] >= 2;
+         pos += (uint8_t)data[pos + 1]) {
+      if (data[pos] == 2 && data[pos + 1] == 6 && pos + 6 <= data.size())
+        p.host_accm =
+            ((uint32_t)be16(data, pos + 2) << 16) | be16(data, pos + 4);
+    }
+    ppp_send(PPP_LCP, cp_packet(CP_CONF_ACK, id, data), now_ms);
+    p.lcp_host_acked = true;
+    break;
+
+  case CP_CONF_ACK:
+    if (id == p.id) p.lcp_acked = true;
+    break;
+
+  case CP_TERM_REQ:
+    ppp_send(PPP_LCP, cp_packet(CP_TERM_ACK, id, ""), now_ms);
+    ppp_leave("NO CARRIER", now_ms);
+    return;
+
+  case LCP_ECHO_REQ: {
+    std::string magic = {(char)(SIM_MAGIC >> 24), (char)(SIM_MAGIC >> 16),
+        (char)(SIM_MAGIC >> 8), (char)SIM_MAGIC};
+    ppp_send(PPP_LCP, cp_packet(LCP_ECHO_REP, id, magic), now_ms);
+    break;
+  }
+  }
+
+  if (p.lcp_acked && p.lcp_host_acked && !p.ipcp_sent) {
+    p.ipcp_sent = true;
+    ppp_send(PPP_IPCP,
+        cp_packet(CP_CONF_REQ, ++p.id, addr_option(3, SIM_PEER_ADDR)), now_ms);
+  }
+}
+
+void M65Sim::ppp_ipcp(const std::string& packet, uint64_t now_ms) {
+  if (packet.size() < 4) return;
+  uint8_t code = (uint8_t)packet[0], id = (uint8_t)packet[1];
+  std::string data = packet.substr(4, be16(packet, 2) - 4);
+
+  if (code == CP_TERM_REQ) {
+    ppp_send(PPP_IPCP, cp_packet(CP_TERM_ACK, id, ""), now_ms);
+    return;
+  }
+  if (code != CP_CONF_REQ) return;
+
+  // Nak unset addresses with the ones we assign, ack once they match
+  std::string nak;
+  for (size_t pos = 0; pos + 6 <= data.size(); pos += 6) {
+    uint8_t type = (uint8_t)data[pos];
+    const uint8_t* value = (const uint8_t*)data.data() + pos + 2;
+    const uint8_t* want = type == 3 ? SIM_HOST_ADDR
+                          : type == 129 ? SIM_DNS[0]
+                          : type == 131 ? SIM_DNS[1]
+                                        : nullptr;
+    if (want && memcmp(value, want, 4) != 0) nak += addr_option(type, want);
+  }
+
+  if (nak.empty())
+    ppp_send(PPP_IPCP, cp_packet(CP_CONF_ACK, id, data), now_ms);
+  else
+    ppp_send(PPP_IPCP, cp_packet(CP_CONF_NAK, id, nak), now_ms);
+}
+
+void M65Sim::ppp_ip(std::string packet, uint64_t now_ms) {
+  if (packet.size() < 20 || ((uint8_t)packet[0] >> 4) != 4) return;
+  size_t ihl = ((uint8_t)packet[0] & 0x0F) * 4;
+  if (ihl < 20 || packet.size() < ihl) return;
+  uint8_t* ip = (uint8_t*)&packet[0];
+
+  // Swapping both addresses (and ports) leaves every checksum unchanged
+  uint8_t tmp[4];
+  memcpy(tmp, ip + 12, 4);
+  memcpy(ip + 12, ip + 16, 4);
+  memcpy(ip + 16, tmp, 4);
+
+  uint8_t* l4 = ip + ihl;
+  size_t l4_len = packet.size() - ihl;
+  if (ip[9] == 17 && l4_len >= 8) {
+    uint8_t port[2] = {l4[0], l4[1]};
+    memcpy(l4, l4 + 2, 2);
+    memcpy(l4 + 2, port, 2);
+  } else if (ip[9] == 1 && l4_len >= 4 && l4[0] == 8) {
+    // ICMP echo request -> echo reply
+    l4[0] = 0;
+    l4[2] = l4[3] = 0;
+    uint16_t sum = inet_checksum(l4, l4_len);
+    l4[2] = (uint8_t)(sum >> 8);
+    l4[3] = (uint8_t)sum;
+  }
+
+  ppp_send(PPP_IP, packet, now_ms);
+}
+
+void M65Sim::ppp_send(
+    uint16_t proto, const std::string& info, uint64_t now_ms) {
+  std::string raw = {(char)0xFF, 0x03, (char)(proto >> 8), (char)proto};
+  raw += info;
+  uint16_t fcs =
+      ppp_fcs(0xFFFF, (const uint8_t*)raw.data(), raw.size()) ^ 0xFFFF;
+  raw += (char)(fcs & 0xFF);
+  raw += (char)(fcs >> 8);
+
+  // LCP always uses the default ACCM
+  uint32_t accm = proto == PPP_LCP ? 0xFFFFFFFF : chan().ppp.host_accm;
+  std::string out(1, (char)PPP_FLAG);
+  for (char c : raw) {
+    uint8_t b = (uint8_t)c;
+    if (b == PPP_FLAG || b == PPP_ESCAPE || (b < 0x20 && (accm >> b) & 1)) {
+      out += (char)PPP_ESCAPE;
+      b ^= PPP_TRANS;
+    }
+    out += (char)b;
+  }
+  out += (char)PPP_FLAG;
+  emit(out, now_ms);
+}
@@ -0,0 +1,248 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "m65_sim.hpp"
+
+/* Virtual Quectel M65 on a pseudo-terminal.
+ *
+ * Usage: m65_sim [-l latency_ms] [-b baud] [-m max_baud] [-e error_rate]
+ *                [-d drop_rate] [-s seed] [-L link_path]
+ *
+ * Prints the slave device path, then point the HAL at it:
+ *   UMODEM_SERIAL_DEV=/dev/pts/N ./socket_posix
+ *
+ * The host must open the port at the modem's UART rate (115200, or the
+ * rate set with AT+IPR): while the two differ, its input is lost and the
+ * simulator's output arrives garbled. Output paced with -b follows AT+IPR
+ * changes. With -m, output at rates above max_baud is always garbled, as
+ * from a line too poor for them; commands still get through.
+ *
+ * Control commands are read from stdin (one per line), so a session can be
+ * scripted by piping a file:
+ *   urc <line>        inject an unsolicited line, e.g. "urc 0, CLOSED"
+ *   dial <text>       connect to the AT+QISERVER listener and send <text>
+ *                     plus a line feed; replies are printed to stderr
+ *   hangup <id>       close inbound connection <id>
+ *   sleep <ms>        delay the following commands
+ *   latency <ms>      response latency
+ *   baud <rate>       pace output at <rate> baud (0 = unpaced)
+ *   error <rate>      probability of answering ERROR
+ *   drop <rate>       probability of not answering
+ *   quit
+ */
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+struct Pacer {
+  uint32_t baud = 0; // 0 = unpaced
+  std::string out;
+  uint64_t next_ms = 0;
+
+  // Bytes allowed per 1 ms slot (10 bits per byte on the wire)
+  size_t slot_bytes() const {
+    size_t n = baud / 10000;
+    return n > 0 ? n : 1;
+  }
+  uint32_t slot_ms() const { return baud >= 10000 ? 1 : 10000 / baud; }
+};
+
+// UART rate the host configured on its end of the pty
+static uint32_t host_baudrate(int slave) {
+  static const struct {
+    speed_t speed;
+    uint32_t baudrate;
+  } rates[] = {{B9600, 9600}, {B19200, 19200}, {B38400, 38400},
+      {B57600, 57600}, {B115200, 115200}, {B230400, 230400},
+      {B460800, 460800}, {B921600, 921600}};
+
+  struct termios tty;
+  if (tcgetattr(slave, &tty) != 0) return 0;
+  speed_t speed = cfgetospeed(&tty);
+  for (const auto& rate : rates) {
+    if (rate.speed == speed) return rate.baudrate;
+  }
+  return 0;
+}
+
+// Whether both ends use the same rate (autobaud follows the host)
+static bool rates_match(int slave, const M65Sim& sim) {
+  return sim.baudrate() == 0 || host_baudrate(slave) == sim.baudrate();
+}
+
+static void flush_output(int master, Pacer& pacer, uint64_t now) {
+  while (!pacer.out.empty()) {
+    size_t n = pacer.out.size();
+    if (pacer.baud) {
+      if (now < pacer.next_ms) return;
+      if (n > pacer.slot_bytes()) n = pacer.slot_bytes();
+    }
+    ssize_t written = write(master, pacer.out.data(), n);
+    if (written <= 0) return;
+    pacer.out.erase(0, (size_t)written);
+    if (pacer.baud) pacer.next_ms = now + pacer.slot_ms();
+  }
+}
+
+static bool handle_control(
+    const std::string& line, M65Sim& sim, Pacer& pacer, uint64_t* resume_ms) {
+  size_t sp = line.find(' ');
+  std::string cmd = line.substr(0, sp);
+  std::string arg = sp == std::string::npos ? "" : line.substr(sp + 1);
+
+  if (cmd == "urc")
+    sim.inject_urc(arg, now_ms());
+  else if (cmd == "dial") {
+    if (sim.dial(arg.empty() ? "" : arg + "\n", now_ms()) < 0)
+      fprintf(stderr, "m65_sim: dial refused, not listening or full\n");
+  } else if (cmd == "hangup")
+    sim.hangup(atoi(arg.c_str()), now_ms());
+  else if (cmd == "sleep")
+    *resume_ms = now_ms() + (uint64_t)atol(arg.c_str());
+  else if (cmd == "latency")
+    sim.config().latency_ms = (uint32_t)atol(arg.c_str());
+  else if (cmd == "baud")
+    pacer.baud = (uint32_t)atol(arg.c_str());
+  else if (cmd == "error")
+    sim.config().error_rate = atof(arg.c_str());
+  else if (cmd == "drop")
+    sim.config().drop_rate = atof(arg.c_str());
+  else if (cmd == "quit")
+    return false;
+  else if (!cmd.empty())
+    fprintf(stderr, "m65_sim: unknown command '%s'\n", cmd.c_str());
+  return true;
+}
+
+int main(int argc, char** argv) {
+  M65SimConfig config;
+  Pacer pacer;
+  const char* link_path = NULL;
+  uint32_t max_baud = 0; // 0 = any rate works
+
+  int opt;
+  while ((opt = getopt(argc, argv, "l:b:m:e:d:s:L:")) != -1) {
+    switch (opt) {
+    case 'l': config.latency_ms = (uint32_t)atol(optarg); break;
+    case 'b': pacer.baud = (uint32_t)atol(optarg); break;
+    case 'm': max_baud = (uint32_t)atol(optarg); break;
+    case 'e': config.error_rate = atof(optarg); break;
+    case 'd': config.drop_rate = atof(optarg); break;
+    case 's': config.seed = (uint32_t)atol(optarg); break;
+    case 'L': link_path = optarg; break;
+    default:
+      fprintf(stderr,
+          "usage: %s [-l latency_ms] [-b baud] [-m max_baud] "
+          "[-e error_rate] [-d drop_rate] [-s seed] [-L link_path]\n",
+          argv[0]);
+      return 1;
+    }
+  }
+
+  int master, slave;
+  char slave_name[128];
+  if (openpty(&master, &slave, slave_name, NULL, NULL) != 0) {
+    perror("openpty failed");
+    return 1;
+  }
+
+  // Raw until the host configures the port; keeping the slave open also
+  // stops the master from reporting EIO between host sessions.
+  struct termios tty;
+  tcgetattr(slave, &tty);
+  cfmakeraw(&tty);
+  cfsetospeed(&tty, B115200);
+  cfsetispeed(&tty, B115200);
+  tcsetattr(slave, TCSANOW, &tty);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL, 0) | O_NONBLOCK);
+
+  if (link_path) {
+    unlink(link_path);
+    if (symlink(slave_name, link_path) != 0) perror("symlink failed");
+  }
+  printf("%s\n", slave_name);
+  fflush(stdout);
+
+  M65Sim sim(config);
+  sim.set_output([&](const char* data, size_t len) {
+    if (rates_match(slave, sim) && (!max_baud || sim.baudrate() <= max_baud)) {
+      pacer.out.append(data, len);
+      return;
+    }
+    // Read at the wrong rate, no byte survives (and no line ends)
+    for (size_t i = 0; i < len; i++) pacer.out += (char)(data[i] ^ 0x55);
+  });
+  sim.set_inbound_output([](int id, const std::string& data) {
+    fprintf(stderr, "m65_sim: inbound %d: %.*s", id, (int)data.size(),
+        data.data());
+    if (data.empty() || data.back() != '\n') fputc('\n', stderr);
+  });
+  uint32_t uart_rate = sim.baudrate();
+
+  std::string script;
+  uint64_t resume_ms = 0;
+  bool stdin_open = true;
+  bool running = true;
+
+  while (running) {
+    uint64_t now = now_ms();
+
+    // Run queued control commands unless a "sleep" is pending
+    while (running && now >= resume_ms) {
+      size_t nl = script.find('\n');
+      if (nl == std::string::npos) break;
+      std::string line = script.substr(0, nl);
+      script.erase(0, nl + 1);
+      running = handle_control(line, sim, pacer, &resume_ms);
+    }
+
+    uint64_t wait = sim.poll(now);
+    if (sim.baudrate() != uart_rate) {
+      uart_rate = sim.baudrate();
+      if (pacer.baud && uart_rate) pacer.baud = uart_rate;
+    }
+    flush_output(master, pacer, now);
+    if (!pacer.out.empty() && pacer.baud) wait = std::min<uint64_t>(wait, 1);
+    if (resume_ms > now && script.find('\n') != std::string::npos)
+      wait = std::min<uint64_t>(wait, resume_ms - now);
+
+    struct pollfd fds[2] = {{master, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+    int timeout = wait == UINT64_MAX ? -1 : (int)std::min<uint64_t>(wait, 1000);
+    if (poll(fds, stdin_open ? 2 : 1, timeout) < 0 && errno != EINTR) break;
+
+    if (fds[0].revents & POLLIN) {
+      uint8_t buf[4096];
+      ssize_t n = read(master, buf, sizeof(buf));
+      if (n > 0 && rates_match(slave, sim))
+        sim.input(buf, (size_t)n, now_ms());
+    }
+
+    if (stdin_open && (fds[1].revents & (POLLIN | POLLHUP))) {
+      char buf[512];
+      ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+      if (n <= 0)
+        stdin_open = false;
+      else
+        script.append(buf, (size_t)n);
+    }
+  }
+
+  if (link_path) unlink(link_path);
+  close(slave);
+  close(master);
+  return 0;
+}
@@ -150,10 +150,12 @@ int main()
 
       // Wait for response (event-driven)
       uint64_t start = current_millis();
-      while (current_millis() - start <= 5000)
+      uint64_t elapsed;
+      while ((elapsed = current_millis() - start) <= 5000)
       {
-        umodem_poll();
-        usleep(1000);
+        uint32_t next = umodem_poll();
+        uint64_t left = 5000 - elapsed;
+        umodem_wait(next < left ? next : (uint32_t)left);
       }
     }
     else
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "port/umodem_port.h"
+#include "test_hal.hpp"
+#include "umodem.h"
+#include "umodem_coro.hpp"
+
+/* A refused connect of a coroutine socket.
+ *
+ * The modem answers AT+QIOPEN with OK and reports the outcome later; a
+ * CONNECT FAIL must complete the wait with UMODEM_ERR right away rather
+ * than after the whole timeout.
+ */
+
+#define TEST_SOCK_HOST "10.0.0.1"
+#define TEST_SOCK_PORT 7
+#define TEST_TIMEOUT_MS 5000
+
+using umodem::co::Executor;
+using umodem::co::Task;
+
+static Task<> connect(umodem::co::Socket& sock, umodem_result_t expected) {
+  uint32_t start = umodem_hal_millis();
+  TEST_CHECK(co_await sock.connect(TEST_SOCK_HOST, TEST_SOCK_PORT,
+                 TEST_TIMEOUT_MS) == expected);
+  TEST_CHECK(umodem_hal_millis() - start < TEST_TIMEOUT_MS / 5);
+}
+
+int main() {
+  umodem_apn_t apn = {.apn = "internet", .user = "", .pass = ""};
+  if (umodem_init(&apn) != UMODEM_OK || umodem_sock_init() != UMODEM_OK) {
+    fprintf(stderr, "umodem_init failed\n");
+    return 1;
+  }
+
+  test_sim().config().latency_ms = 20;
+  {
+    Executor exec;
+    umodem::co::Socket sock(exec, umodem::Socket::create(UMODEM_SOCK_TCP));
+    TEST_CHECK(sock);
+
+    test_sim().config().refuse_connect = true;
+    exec.spawn(connect(sock, UMODEM_ERR));
+    exec.run();
+
+    test_sim().config().refuse_connect = false;
+    exec.spawn(connect(sock, UMODEM_OK));
+    exec.run();
+  }
+
+  umodem_deinit();
+
+  if (test_failures()) {
+    fprintf(stderr, "%d check(s) failed\n", test_failures());
+    return 1;
+  }
+  puts("coro_connect: ok");
+  return 0;
+}
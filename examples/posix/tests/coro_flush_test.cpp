@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "test_hal.hpp"
+#include "umodem.h"
+#include "umodem_coro.hpp"
+
+/* Deferred socket flushes next to coroutine commands.
+ *
+ * Each round buffers a record on a coalescing socket whose flush comes due
+ * 10 ms later, then awaits a command the modem answers after 30 ms. The
+ * flush must wait for that result instead of writing AT+QISEND in between;
+ * the records still all go out, and come back from the echo.
+ */
+
+#define TEST_SOCK_HOST "10.0.0.1"
+#define TEST_SOCK_PORT 7
+#define TEST_ROUNDS 10
+
+using umodem::co::Executor;
+using umodem::co::Modem;
+using umodem::co::Task;
+
+static const char record[] = "ping!";
+
+static Task<> send_and_query(
+    Modem& modem, umodem::co::Socket& sock, const char* imei) {
+  for (int i = 0; i < TEST_ROUNDS; i++) {
+    TEST_CHECK(co_await sock.send(umodem::as_bytes(record)) ==
+               (int)strlen(record));
+
+    char response[64] = "";
+    TEST_CHECK(co_await modem.at("AT+CGSN", response) == UMODEM_OK);
+    TEST_CHECK(strstr(response, imei) != NULL);
+    TEST_CHECK(strstr(response, "SEND") == NULL);
+  }
+
+  size_t expected = TEST_ROUNDS * strlen(record);
+  size_t received = 0;
+  while (received < expected) {
+    uint8_t buf[64];
+    int len = co_await sock.recv(buf, 2000);
+    TEST_CHECK(len > 0);
+    if (len <= 0) break;
+    received += (size_t)len;
+  }
+  TEST_CHECK(received == expected);
+}
+
+int main() {
+  umodem_apn_t apn = {.apn = "internet", .user = "", .pass = ""};
+  if (umodem_init(&apn) != UMODEM_OK || umodem_sock_init() != UMODEM_OK) {
+    fprintf(stderr, "umodem_init failed\n");
+    return 1;
+  }
+
+  umodem_status_t status;
+  TEST_CHECK(umodem_get_status(&status) == UMODEM_OK);
+
+  umodem::Socket plain = umodem::Socket::create(UMODEM_SOCK_TCP);
+  TEST_CHECK(plain);
+  TEST_CHECK(plain.connect(TEST_SOCK_HOST, TEST_SOCK_PORT, 1000) == UMODEM_OK);
+  TEST_CHECK(plain.coalesce(512, 10) == UMODEM_OK);
+  TEST_CHECK(plain.nodelay(false) == UMODEM_OK);
+
+  test_sim().config().latency_ms = 30;
+  {
+    Executor exec;
+    Modem modem(exec);
+    umodem::co::Socket sock(exec, std::move(plain));
+    exec.spawn(send_and_query(modem, sock, status.imei));
+    exec.run();
+  }
+
+  umodem_deinit();
+
+  if (test_failures()) {
+    fprintf(stderr, "%d check(s) failed\n", test_failures());
+    return 1;
+  }
+  puts("coro_flush: ok");
+  return 0;
+}
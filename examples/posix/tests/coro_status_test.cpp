@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "test_hal.hpp"
+#include "umodem.h"
+#include "umodem_coro.hpp"
+
+/* The status refresh of umodem_poll() next to coroutine commands.
+ *
+ * The executor runs umodem_poll() while a command a coroutine awaits is
+ * still in flight. With UMODEM_STATUS_REFRESH_MS at 50 ms and 20 ms of
+ * modem latency the refresh comes due over and over during the run; it must
+ * wait for the coroutine's result instead of writing AT+CSQ / AT+CREG? in
+ * between and taking that result as its own.
+ */
+
+using umodem::co::Executor;
+using umodem::co::Modem;
+using umodem::co::Task;
+
+static Task<> query_imei(
+    Executor& exec, Modem& modem, const char* imei, int rounds) {
+  for (int i = 0; i < rounds; i++) {
+    char response[64] = "";
+    TEST_CHECK(co_await modem.at("AT+CGSN", response) == UMODEM_OK);
+    TEST_CHECK(strstr(response, imei) != NULL);
+    TEST_CHECK(strstr(response, "+C") == NULL);
+
+    // Leave the channel idle now and then so the refresh gets to run
+    co_await exec.sleep((uint32_t)(i % 4) * 20);
+  }
+}
+
+int main() {
+  umodem_apn_t apn = {.apn = "internet", .user = "", .pass = ""};
+  if (umodem_init(&apn) != UMODEM_OK) {
+    fprintf(stderr, "umodem_init failed\n");
+    return 1;
+  }
+
+  umodem_status_t status;
+  TEST_CHECK(umodem_get_status(&status) == UMODEM_OK);
+  // Nothing refreshed at init
+  TEST_CHECK(status.signal_source != UMODEM_STATUS_SRC_POLL);
+  TEST_CHECK(status.imei[0] != '\0');
+
+  test_sim().config().latency_ms = 20;
+  {
+    Executor exec;
+    Modem modem(exec);
+    exec.spawn(query_imei(exec, modem, status.imei, 40));
+    exec.run();
+  }
+
+  // The refresh did run, between the commands, and parsed its own replies
+  TEST_CHECK(umodem_get_status(&status) == UMODEM_OK);
+  TEST_CHECK(status.signal_source == UMODEM_STATUS_SRC_POLL);
+  TEST_CHECK(status.rssi == 21);
+  TEST_CHECK(status.reg_stat == 1);
+
+  umodem_deinit();
+
+  if (test_failures()) {
+    fprintf(stderr, "%d check(s) failed\n", test_failures());
+    return 1;
+  }
+  puts("coro_status: ok");
+  return 0;
+}
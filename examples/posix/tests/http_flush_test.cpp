@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "port/umodem_port.h"
+#include "test_hal.hpp"
+#include "umodem.h"
+#include "umodem_http.h"
+
+/* Deferred socket flushes next to an HTTP body.
+ *
+ * Each round buffers a record on a coalescing socket whose flush comes due
+ * 10 ms later, then runs a GET the modem answers with 20 ms of latency per
+ * step. The flush must wait for the request instead of writing AT+QISEND
+ * and the record into the body; afterwards the record still goes out and
+ * comes back from the echo.
+ */
+
+#define TEST_SOCK_HOST "10.0.0.1"
+#define TEST_SOCK_PORT 7
+#define TEST_URL "http://m65-sim.local/bytes/1000"
+#define TEST_BODY_LEN 1000
+#define TEST_ROUNDS 5
+
+static const char record[] = "ping!";
+
+struct body_t {
+  uint32_t offset;
+  int corrupt;
+};
+
+static int on_body(const uint8_t* data, size_t len, void* ctx) {
+  body_t* body = (body_t*)ctx;
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] != 'a' + (body->offset + i) % 26) body->corrupt = 1;
+  }
+  body->offset += (uint32_t)len;
+  return 0;
+}
+
+// Read the echo of one record, polling until it arrived
+static size_t recv_echo(int sockfd) {
+  size_t received = 0;
+  uint32_t start = umodem_hal_millis();
+  while (received < strlen(record) && umodem_hal_millis() - start < 2000) {
+    uint8_t buf[64];
+    int len = umodem_sock_recv(sockfd, buf, sizeof(buf));
+    if (len < 0) break;
+    received += (size_t)len;
+    if (len == 0) umodem_wait(umodem_poll());
+  }
+  return received;
+}
+
+int main() {
+  umodem_apn_t apn = {.apn = "internet", .user = "", .pass = ""};
+  if (umodem_init(&apn) != UMODEM_OK || umodem_sock_init() != UMODEM_OK) {
+    fprintf(stderr, "umodem_init failed\n");
+    return 1;
+  }
+
+  int sockfd = umodem_sock_create(UMODEM_SOCK_TCP);
+  TEST_CHECK(sockfd > 0);
+  TEST_CHECK(umodem_sock_connect(sockfd, TEST_SOCK_HOST,
+                 strlen(TEST_SOCK_HOST), TEST_SOCK_PORT, 1000) == UMODEM_OK);
+  TEST_CHECK(umodem_sock_set_coalesce(sockfd, 512, 10) == UMODEM_OK);
+  TEST_CHECK(umodem_sock_set_nodelay(sockfd, 0) == UMODEM_OK);
+
+  test_sim().config().latency_ms = 20;
+  for (int i = 0; i < TEST_ROUNDS; i++) {
+    TEST_CHECK(umodem_sock_send(sockfd, (const uint8_t*)record,
+                   strlen(record)) == (int)strlen(record));
+
+    body_t body = {0, 0};
+    umodem_http_request_t get = {};
+    get.method = UMODEM_HTTP_GET;
+    get.url = TEST_URL;
+    get.on_body = on_body;
+    get.ctx = &body;
+    get.timeout_ms = 10000;
+
+    umodem_http_response_t resp;
+    TEST_CHECK(umodem_http_request(&get, &resp) == UMODEM_OK);
+    TEST_CHECK(!resp.via_socket);
+    TEST_CHECK(resp.body_bytes == TEST_BODY_LEN);
+    TEST_CHECK(!body.corrupt);
+
+    TEST_CHECK(recv_echo(sockfd) == strlen(record));
+  }
+
+  umodem_sock_close(sockfd);
+  umodem_deinit();
+
+  if (test_failures()) {
+    fprintf(stderr, "%d check(s) failed\n", test_failures());
+    return 1;
+  }
+  puts("http_flush: ok");
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "test_hal.hpp"
+#include "umodem.h"
+#include "umodem_http.h"
+
+/* The socket fallback of umodem_http_request().
+ *
+ * A 404 makes AT+QHTTPGET end in +CME ERROR: 3822 after the request went
+ * out. The server has seen it, so the request must fail as it is instead
+ * of being fetched a second time over a socket.
+ */
+
+#define TEST_URL "http://m65-sim.local/missing"
+
+static size_t count(const std::string& text, const char* what) {
+  size_t n = 0;
+  for (size_t pos = text.find(what); pos != std::string::npos;
+       pos = text.find(what, pos + 1))
+    n++;
+  return n;
+}
+
+int main() {
+  umodem_apn_t apn = {.apn = "internet", .user = "", .pass = ""};
+  if (umodem_init(&apn) != UMODEM_OK || umodem_sock_init() != UMODEM_OK) {
+    fprintf(stderr, "umodem_init failed\n");
+    return 1;
+  }
+
+  umodem_http_request_t get = {};
+  get.method = UMODEM_HTTP_GET;
+  get.url = TEST_URL;
+  get.timeout_ms = 10000;
+
+  test_take_tx();
+  umodem_http_response_t resp;
+  TEST_CHECK(umodem_http_request(&get, &resp) != UMODEM_OK);
+  TEST_CHECK(!resp.via_socket);
+
+  std::string tx = test_take_tx();
+  TEST_CHECK(count(tx, "AT+QHTTPGET=") == 1);
+  TEST_CHECK(tx.find("AT+QIOPEN") == std::string::npos);
+
+  umodem_deinit();
+
+  if (test_failures()) {
+    fprintf(stderr, "%d check(s) failed\n", test_failures());
+    return 1;
+  }
+  puts("http_retry: ok");
+  return 0;
+}
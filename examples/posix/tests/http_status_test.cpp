@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "test_hal.hpp"
+#include "umodem.h"
+#include "umodem_http.h"
+
+/* The status refresh of umodem_poll() next to an HTTP body.
+ *
+ * AT+QHTTPREAD streams the body between CONNECT and OK while the driver
+ * keeps calling umodem_poll(). With UMODEM_STATUS_REFRESH_MS at 50 ms and
+ * 20 ms of modem latency the refresh comes due during the body; it must
+ * wait for the request instead of writing AT+CSQ / AT+CREG? into it and
+ * taking the body's OK as its own.
+ */
+
+#define TEST_URL "http://m65-sim.local/bytes/1000"
+#define TEST_BODY_LEN 1000
+#define TEST_ROUNDS 5
+
+struct body_t {
+  uint32_t offset;
+  int corrupt;
+};
+
+static int on_body(const uint8_t* data, size_t len, void* ctx) {
+  body_t* body = (body_t*)ctx;
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] != 'a' + (body->offset + i) % 26) body->corrupt = 1;
+  }
+  body->offset += (uint32_t)len;
+  return 0;
+}
+
+int main() {
+  umodem_apn_t apn = {.apn = "internet", .user = "", .pass = ""};
+  if (umodem_init(&apn) != UMODEM_OK || umodem_sock_init() != UMODEM_OK) {
+    fprintf(stderr, "umodem_init failed\n");
+    return 1;
+  }
+
+  test_sim().config().latency_ms = 20;
+  for (int i = 0; i < TEST_ROUNDS; i++) {
+    body_t body = {0, 0};
+    umodem_http_request_t get = {};
+    get.method = UMODEM_HTTP_GET;
+    get.url = TEST_URL;
+    get.on_body = on_body;
+    get.ctx = &body;
+    get.timeout_ms = 10000;
+
+    umodem_http_response_t resp;
+    TEST_CHECK(umodem_http_request(&get, &resp) == UMODEM_OK);
+    TEST_CHECK(!resp.via_socket);
+    TEST_CHECK(resp.body_bytes == TEST_BODY_LEN);
+    TEST_CHECK(body.offset == TEST_BODY_LEN);
+    TEST_CHECK(!body.corrupt);
+
+    // Let the refresh run between the requests as well
+    umodem_wait(umodem_poll());
+  }
+
+  umodem_status_t status;
+  TEST_CHECK(umodem_get_status(&status) == UMODEM_OK);
+  TEST_CHECK(status.signal_source == UMODEM_STATUS_SRC_POLL);
+  TEST_CHECK(status.rssi == 21);
+
+  umodem_deinit();
+
+  if (test_failures()) {
+    fprintf(stderr, "%d check(s) failed\n", test_failures());
+    return 1;
+  }
+  puts("http_status: ok");
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "port/umodem_port.h"
+#include "test_hal.hpp"
+#include "umodem.h"
+#include "umodem_event.h"
+
+/* Inbound connections next to client sockets.
+ *
+ * The modem numbers the two kinds separately. A client socket created but
+ * not opened yet leaves its modem index free, so the first inbound
+ * connection takes the same index. It must get a sockfd of its own, its
+ * data and CLOSED must not touch the client socket, and a connection the
+ * driver cannot take must be closed on the modem. Closing the listener
+ * drops what its connections still had buffered.
+ */
+
+#define TEST_SOCK_HOST "10.0.0.1"
+#define TEST_SOCK_PORT 7
+#define TEST_LISTEN_PORT 9000
+
+static int g_data_fd = 0;
+static int g_closed = 0;
+static int g_closed_fd = 0;
+
+static void on_event(umodem_event_t* event, void* user_ctx) {
+  (void)user_ctx;
+  int fd = *(int*)umodem_get_event_data(event);
+  if (umodem_event_get_flag(event) == UMODEM_EVENT_SOCK_DATA_RECEIVED) g_data_fd = fd;
+  if (umodem_event_get_flag(event) == UMODEM_EVENT_SOCK_CLOSED) {
+    g_closed++;
+    g_closed_fd = fd;
+  }
+}
+
+// Poll for a while, long enough for queued output and URCs
+static void pump(uint32_t ms) {
+  uint32_t start = umodem_hal_millis();
+  while (umodem_hal_millis() - start < ms) {
+    uint32_t next = umodem_poll();
+    umodem_wait(next < 10 ? next : 10);
+  }
+}
+
+static uint64_t sim_now(void) { return umodem_hal_millis(); }
+
+int main() {
+  umodem_apn_t apn = {.apn = "internet", .user = "", .pass = ""};
+  if (umodem_init(&apn) != UMODEM_OK || umodem_sock_init() != UMODEM_OK) {
+    fprintf(stderr, "umodem_init failed\n");
+    return 1;
+  }
+  umodem_event_subscribe(UMODEM_EVENT_MASK(UMODEM_EVENT_SOCK_DATA_RECEIVED) |
+                             UMODEM_EVENT_MASK(UMODEM_EVENT_SOCK_CLOSED),
+      on_event, NULL);
+
+  int client = umodem_sock_create(UMODEM_SOCK_TCP);
+  TEST_CHECK(client > 0);
+  TEST_CHECK(umodem_sock_listen(UMODEM_SOCK_TCP, TEST_LISTEN_PORT, 2) ==
+             UMODEM_OK);
+
+  // Takes modem index 0, like the client socket
+  TEST_CHECK(test_sim().dial("hello\n", sim_now()) == 0);
+  pump(50);
+  int inbound = umodem_sock_accept();
+  TEST_CHECK(inbound > 0 && inbound != client);
+  TEST_CHECK(g_data_fd == inbound);
+
+  char buf[32] = "";
+  TEST_CHECK(umodem_sock_recv(inbound, buf, sizeof(buf) - 1) == 6);
+  TEST_CHECK(strcmp(buf, "hello\n") == 0);
+  TEST_CHECK(umodem_sock_send(inbound, "bye\n", 4) == 4);
+
+  // The hangup closes the inbound socket only
+  test_sim().hangup(0, sim_now());
+  pump(50);
+  TEST_CHECK(g_closed == 1);
+  TEST_CHECK(g_closed_fd == inbound);
+  TEST_CHECK(umodem_sock_send(inbound, "x", 1) < 0);
+
+  TEST_CHECK(umodem_sock_connect(client, TEST_SOCK_HOST,
+                 strlen(TEST_SOCK_HOST), TEST_SOCK_PORT, 1000) == UMODEM_OK);
+  TEST_CHECK(umodem_sock_send(client, "ping", 4) == 4);
+  pump(50);
+  memset(buf, 0, sizeof(buf));
+  TEST_CHECK(umodem_sock_recv(client, buf, sizeof(buf) - 1) == 4);
+  TEST_CHECK(strcmp(buf, "ping") == 0);
+
+  // Bytes still coalescing on an inbound socket go away with the listener
+  TEST_CHECK(test_sim().dial("", sim_now()) == 1);
+  pump(50);
+  inbound = umodem_sock_accept();
+  TEST_CHECK(inbound > 0);
+  TEST_CHECK(umodem_sock_set_coalesce(inbound, 512, 20) == UMODEM_OK);
+  TEST_CHECK(umodem_sock_send(inbound, "late", 4) == 4);
+  TEST_CHECK(umodem_sock_unlisten() == UMODEM_OK);
+  test_take_tx();
+  pump(100);
+  TEST_CHECK(test_take_tx().find("AT+QISEND") == std::string::npos);
+
+  // A connection announced while not listening is closed again, in the
+  // server context (the client send switches away from it)
+  TEST_CHECK(umodem_sock_send(client, "ping", 4) == 4);
+  pump(50);
+  test_take_tx();
+  test_sim().inject_urc("3, REMOTE IP: 10.0.0.9", sim_now());
+  pump(50);
+  std::string tx = test_take_tx();
+  TEST_CHECK(tx.find("AT+QISRVC=2\r") != std::string::npos);
+  TEST_CHECK(tx.find("AT+QICLOSE=3\r") != std::string::npos);
+  TEST_CHECK(umodem_sock_accept() == -1);
+
+  umodem_sock_close(client);
+  umodem_deinit();
+
+  if (test_failures()) {
+    fprintf(stderr, "%d check(s) failed\n", test_failures());
+    return 1;
+  }
+  puts("server_slots: ok");
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include "port/umodem_port.h"
+#include "test_hal.hpp"
+#include "umodem_buffer.h"
+
+static int g_failures = 0;
+static std::string g_tx;
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void sleep_ms(uint64_t ms) {
+  struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+  nanosleep(&ts, NULL);
+}
+
+M65Sim& test_sim(void) {
+  static M65Sim instance;
+  static bool wired = false;
+  if (!wired) {
+    instance.set_output([](const char* data, size_t len) {
+      umodem_buffer_push((const uint8_t*)data, len);
+    });
+    wired = true;
+  }
+  return instance;
+}
+
+void test_fail(const char* file, int line, const char* expr) {
+  fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+  g_failures++;
+}
+
+int test_failures(void) { return g_failures; }
+
+std::string test_take_tx(void) {
+  std::string tx;
+  tx.swap(g_tx);
+  return tx;
+}
+
+void umodem_hal_init() { test_sim(); }
+
+void umodem_hal_deinit() {}
+
+int umodem_hal_send(const uint8_t* buf, size_t len) {
+  uint64_t now = now_ms();
+  g_tx.append((const char*)buf, len);
+  test_sim().input(buf, len, now);
+  test_sim().poll(now);
+  return (int)len;
+}
+
+// Output due by now lands in the RX buffer directly
+int umodem_hal_read(uint8_t* buf, size_t len) {
+  (void)buf;
+  (void)len;
+  test_sim().poll(now_ms());
+  return 0;
+}
+
+uint32_t umodem_hal_millis(void) { return (uint32_t)now_ms(); }
+
+void umodem_hal_delay_ms(uint32_t ms) { sleep_ms(ms); }
+
+// Sleep until the simulator's next output is due, in short steps so an
+// idle simulator never blocks a test
+void umodem_hal_wait_rx(uint32_t timeout_ms) {
+  uint64_t due = test_sim().poll(now_ms());
+  if (due > timeout_ms) due = timeout_ms;
+  if (due > 10) due = 10;
+  sleep_ms(due);
+  test_sim().poll(now_ms());
+}
+
+void umodem_hal_lock(void) {}
+
+void umodem_hal_unlock(void) {}
+
+void* umodem_hal_alloc(size_t size) { return malloc(size); }
+
+void umodem_hal_free(void* ptr) { free(ptr); }
@@ -0,0 +1,32 @@
+#ifndef UMODEM_TEST_HAL_HPP_
+#define UMODEM_TEST_HAL_HPP_
+
+#include <stdio.h>
+
+#include <string>
+
+#include "m65_sim.hpp"
+
+/* In-process HAL for the tests: the "serial port" is a virtual M65
+ * (examples/posix/sim). Unlike the benchmark HAL, responses keep the
+ * simulator's latency, so commands stay in flight while umodem_poll() runs
+ * and timing-dependent paths are exercised. */
+
+/* The simulator behind the HAL, e.g. to change its latency. */
+M65Sim& test_sim(void);
+
+/* Everything the library wrote since the last call. */
+std::string test_take_tx(void);
+
+/* Report a failed check and count it, see test_failures(). */
+#define TEST_CHECK(cond)                                                 \
+  do {                                                                   \
+    if (!(cond)) test_fail(__FILE__, __LINE__, #cond);                   \
+  } while (0)
+
+void test_fail(const char* file, int line, const char* expr);
+
+/* Number of failed checks so far. */
+int test_failures(void);
+
+#endif
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <cstring>
+
+#include "umodem.h"
+#include "umodem_sock.h"
+#include "port/umodem_port.h"
+
+/* Bulk upload over AT+QISEND versus transparent mode.
+ *
+ * Sends the same data to an echo server both ways and reads the echo back,
+ * reporting the throughput of each path. Against the simulator
+ * (examples/posix/sim), pacing its output at a UART rate:
+ *
+ *   ./m65_sim -b 115200 -L /tmp/m65 &
+ *   UMODEM_SERIAL_DEV=/tmp/m65 ./transparent_posix
+ */
+
+#define ECHO_HOST "echo.m65-sim.local"
+#define ECHO_PORT 7
+#define UPLOAD_SIZE 16384
+#define QISEND_CHUNK 1024
+#define TRANSPARENT_CHUNK 128
+#define ECHO_TIMEOUT_MS 30000
+
+umodem_apn_t apn_config = {
+    .apn = "internet",
+    .user = "",
+    .pass = "",
+};
+
+static uint8_t upload_byte(uint32_t pos)
+{
+  return (uint8_t)('a' + pos % 26);
+}
+
+// Echo checker shared by both paths
+struct transfer_t
+{
+  uint32_t sent;
+  uint32_t received;
+  int corrupt;
+};
+
+static void check_echo(transfer_t *t, const uint8_t *data, int len)
+{
+  for (int i = 0; i < len; i++)
+  {
+    if (data[i] != upload_byte(t->received + (uint32_t)i))
+      t->corrupt = 1;
+  }
+  t->received += (uint32_t)len;
+}
+
+static void report(const char *name, const transfer_t *t, uint32_t elapsed_ms)
+{
+  printf("%-12s %u bytes echoed in %u ms (%u B/s)%s\n", name, t->received,
+         elapsed_ms, elapsed_ms ? t->received * 1000 / elapsed_ms : 0,
+         t->corrupt ? ", corrupted" : "");
+}
+
+static int upload_qisend(void)
+{
+  int sockfd = umodem_sock_create(UMODEM_SOCK_TCP);
+  if (sockfd <= 0 || umodem_sock_connect(sockfd, ECHO_HOST, strlen(ECHO_HOST), ECHO_PORT, 10000) != UMODEM_OK)
+  {
+    printf("Socket connect failed\n");
+    umodem_sock_close(sockfd);
+    return -1;
+  }
+
+  transfer_t t = {0, 0, 0};
+  uint8_t buf[QISEND_CHUNK];
+  uint32_t start = umodem_hal_millis();
+  while (t.received < UPLOAD_SIZE && umodem_hal_millis() - start < ECHO_TIMEOUT_MS)
+  {
+    if (t.sent < UPLOAD_SIZE)
+    {
+      size_t len = UPLOAD_SIZE - t.sent < sizeof(buf) ? UPLOAD_SIZE - t.sent : sizeof(buf);
+      for (size_t i = 0; i < len; i++)
+        buf[i] = upload_byte(t.sent + (uint32_t)i);
+      if (umodem_sock_send(sockfd, buf, len) != (int)len)
+        break;
+      t.sent += (uint32_t)len;
+    }
+
+    int len = umodem_sock_recv(sockfd, buf, sizeof(buf));
+    if (len < 0)
+      break;
+    check_echo(&t, buf, len);
+  }
+
+  report("qisend", &t, umodem_hal_millis() - start);
+  umodem_sock_close(sockfd);
+  return t.received == UPLOAD_SIZE && !t.corrupt ? 0 : -1;
+}
+
+static int upload_transparent(void)
+{
+  if (umodem_sock_transparent_open(ECHO_HOST, strlen(ECHO_HOST), ECHO_PORT, 10000) != UMODEM_OK)
+  {
+    printf("Transparent connect failed\n");
+    return -1;
+  }
+
+  // The echo lands in the RX ring: read it between small writes
+  transfer_t t = {0, 0, 0};
+  uint8_t buf[TRANSPARENT_CHUNK];
+  uint32_t start = umodem_hal_millis();
+  while (t.received < UPLOAD_SIZE && umodem_hal_millis() - start < ECHO_TIMEOUT_MS)
+  {
+    if (t.sent < UPLOAD_SIZE)
+    {
+      size_t len = UPLOAD_SIZE - t.sent < sizeof(buf) ? UPLOAD_SIZE - t.sent : sizeof(buf);
+      for (size_t i = 0; i < len; i++)
+        buf[i] = upload_byte(t.sent + (uint32_t)i);
+      if (umodem_sock_transparent_send(buf, len) != (int)len)
+        break;
+      t.sent += (uint32_t)len;
+    }
+
+    int len = umodem_sock_transparent_recv(buf, sizeof(buf));
+    if (len < 0)
+      break;
+    if (len == 0)
+      umodem_wait(10);
+    check_echo(&t, buf, len);
+  }
+  uint32_t elapsed = umodem_hal_millis() - start;
+
+  umodem_result_t closed = umodem_sock_transparent_close();
+  report("transparent", &t, elapsed);
+  return closed == UMODEM_OK && t.received == UPLOAD_SIZE && !t.corrupt ? 0 : -1;
+}
+
+int main()
+{
+  if (umodem_init(&apn_config) != UMODEM_OK || umodem_sock_init() != UMODEM_OK)
+  {
+    printf("Failed to initialize uModem\n");
+    return -1;
+  }
+
+  int result = upload_qisend();
+  if (upload_transparent() != 0)
+    result = -1;
+
+  // Back in command mode, AT commands work again
+  int rssi = 0, ber = 0;
+  if (result == 0 && umodem_get_signal_quality(&rssi, &ber) != UMODEM_OK)
+    result = -1;
+
+  printf("%s\n", result == 0 ? "Done" : "Failed");
+  umodem_sock_deinit();
+  umodem_deinit();
+  return result;
+}
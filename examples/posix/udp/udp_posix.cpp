@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <cstring>
+
+#include "umodem.h"
+#include "umodem_sock.h"
+#include "port/umodem_port.h"
+
+/* Datagram telemetry over UDP.
+ *
+ * Sends readings of different sizes to two collectors from one socket with
+ * umodem_sock_sendto() and checks, with umodem_sock_recvfrom(), that every
+ * echo comes back whole and from the peer it was sent to. Against the
+ * simulator (examples/posix/sim), whose peers echo every datagram:
+ *
+ *   ./m65_sim -L /tmp/m65 &
+ *   UMODEM_SERIAL_DEV=/tmp/m65 ./udp_posix
+ */
+
+#define COLLECTOR_HOST "127.0.0.1"
+#define ECHO_TIMEOUT_MS 5000
+
+umodem_apn_t apn_config = {
+    .apn = "internet",
+    .user = "",
+    .pass = "",
+};
+
+static const uint16_t collectors[] = {5683, 5684};
+static const size_t sizes[] = {1, 17, 200, 1024};
+
+// Wait for the echo of one datagram, polling for +QIRDI in between
+static int wait_datagram(int sockfd, uint8_t *buf, size_t len, umodem_sock_addr_t *from)
+{
+  uint32_t start = umodem_hal_millis();
+  while (umodem_hal_millis() - start < ECHO_TIMEOUT_MS)
+  {
+    int n = umodem_sock_recvfrom(sockfd, buf, len, from);
+    if (n != 0)
+      return n;
+    uint32_t next = umodem_poll();
+    umodem_wait(next < 50 ? next : 50);
+  }
+  return 0;
+}
+
+int main()
+{
+  if (umodem_init(&apn_config) != UMODEM_OK || umodem_sock_init() != UMODEM_OK)
+  {
+    printf("Failed to initialize uModem\n");
+    return -1;
+  }
+
+  int sockfd = umodem_sock_create(UMODEM_SOCK_UDP);
+  if (sockfd <= 0)
+  {
+    printf("Failed to create socket\n");
+    return -1;
+  }
+
+  int result = 0;
+  uint8_t out[1024], in[1500];
+  printf("%-6s %6s %6s  %s\n", "port", "sent", "echo", "from");
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    uint16_t port = collectors[i % 2];
+    for (size_t j = 0; j < sizes[i]; j++)
+      out[j] = (uint8_t)(i + j);
+
+    if (umodem_sock_sendto(sockfd, out, sizes[i], COLLECTOR_HOST, strlen(COLLECTOR_HOST), port) != (int)sizes[i])
+    {
+      printf("%-6u send failed\n", port);
+      result = -1;
+      continue;
+    }
+
+    umodem_sock_addr_t from = {};
+    int n = wait_datagram(sockfd, in, sizeof(in), &from);
+    printf("%-6u %6zu %6d  %s:%u\n", port, sizes[i], n, from.addr, from.port);
+    if (n != (int)sizes[i] || memcmp(in, out, sizes[i]) != 0 || from.port != port)
+      result = -1;
+  }
+
+  printf("%s\n", result == 0 ? "Done" : "Failed");
+  umodem_sock_close(sockfd);
+  umodem_sock_deinit();
+  umodem_deinit();
+  return result;
+}
@@ -475,8 +475,7 @@ void StartDefaultTask(void *argument)
   /* Infinite loop */
   for (;;)
   {
-    umodem_poll();
-    osDelay(1);
+    umodem_wait(umodem_poll());
   }
   /* USER CODE END 5 */
 }
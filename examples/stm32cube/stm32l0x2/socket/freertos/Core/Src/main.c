@@ -505,8 +505,7 @@ void StartUmodemTask(void *argument)
   /* Infinite loop */
   for (;;)
   {
-    umodem_poll();
-    osDelay(1);
+    umodem_wait(umodem_poll());
   }
   /* USER CODE END StartUmodemTask */
 }
@@ -6,16 +6,34 @@
 #include "cmsis_os.h"
 #include "port/umodem_port.h"
 #include "umodem_buffer.h"
-
-#define DMA_RX_BUFFER_SIZE 64
+#include "umodem_core.h"
+
+/* Set to 1 to let the RX DMA write straight into the uModem ring storage.
+ * No bytes are copied: idle-line, half and full transfer interrupts only
+ * wake the task, which advances the ring head from umodem_hal_read() with
+ * the HAL lock held. The ring has a single writer and a single reader and
+ * is not safe against an interrupt, so the ISR never touches it. The
+ * storage must fit the 16 bit DMA counter (at most 65535 bytes).
+ */
+#ifndef UMODEM_PORT_RX_DMA_DIRECT
+#define UMODEM_PORT_RX_DMA_DIRECT 0
+#endif
 
 extern UART_HandleTypeDef huart2;
 extern DMA_HandleTypeDef hdma_usart2_rx;
 
+#if UMODEM_PORT_RX_DMA_DIRECT
+static uint8_t* dma_rx2_buffer = NULL;
+static size_t dma_rx2_size = 0;
+#else
+#define DMA_RX_BUFFER_SIZE 64
 static volatile uint8_t dma_rx2_buffer[DMA_RX_BUFFER_SIZE];
+static const size_t dma_rx2_size = DMA_RX_BUFFER_SIZE;
+#endif
 
 static osMessageQueueId_t tx2_queue = NULL;
 static osSemaphoreId_t tx2_sem = NULL;
+static osSemaphoreId_t rx2_sem = NULL;
 
 typedef struct {
   uint8_t* bytes;
@@ -37,10 +55,22 @@ static void tx2_task(void* args) {
   }
 }
 
-static volatile uint16_t start = 0;
+#if UMODEM_PORT_RX_DMA_DIRECT
+// Storage index up to which the ring has been committed (task only)
+static size_t start = 0;
+// Set by the error ISR after restarting the DMA at index 0
+static volatile uint8_t rx2_rewind = 0;
+
+static void process_dma_data(void) {
+  // Wake up umodem_hal_wait_rx(), the task commits in umodem_hal_read()
+  osSemaphoreRelease(rx2_sem);
+}
+#else
+static volatile size_t start = 0;
 
 static void process_dma_data(void) {
-  uint16_t end = DMA_RX_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(&hdma_usart2_rx);
+  size_t end = dma_rx2_size - __HAL_DMA_GET_COUNTER(&hdma_usart2_rx);
+  if (end == dma_rx2_size) end = 0;
 
   if (end == start) return;
 
@@ -48,18 +78,23 @@ static void process_dma_data(void) {
     umodem_buffer_push((const uint8_t*)&dma_rx2_buffer[start], end - start);
   else {
     umodem_buffer_push(
-        (const uint8_t*)&dma_rx2_buffer[start], DMA_RX_BUFFER_SIZE - start);
+        (const uint8_t*)&dma_rx2_buffer[start], dma_rx2_size - start);
     umodem_buffer_push((const uint8_t*)dma_rx2_buffer, end);
   }
 
   start = end;
+
+  // Wake up umodem_hal_wait_rx()
+  osSemaphoreRelease(rx2_sem);
 }
+#endif
 
 void umodem_hal_init(void) {
   tx2_queue = osMessageQueueNew(16, sizeof(tx_rx_data), NULL);
   tx2_sem = osSemaphoreNew(1, 1, NULL);
+  rx2_sem = osSemaphoreNew(1, 0, NULL);
 
-  if (!tx2_sem || !tx2_queue) Error_Handler();
+  if (!tx2_sem || !tx2_queue || !rx2_sem) Error_Handler();
 
   osThreadAttr_t tx2TaskAttr = {};
   tx2TaskAttr.name = "TX2Task";
@@ -68,7 +103,13 @@ void umodem_hal_init(void) {
   if (osThreadNew(tx2_task, NULL, &tx2TaskAttr) == NULL) Error_Handler();
 
   // Start DMA
-  HAL_UART_Receive_DMA(&huart2, (uint8_t*)dma_rx2_buffer, DMA_RX_BUFFER_SIZE);
+#if UMODEM_PORT_RX_DMA_DIRECT
+  dma_rx2_buffer = umodem_buffer_get_storage(&dma_rx2_size);
+  if (!dma_rx2_buffer || dma_rx2_size > 0xFFFF) Error_Handler();
+  rx2_rewind = 0;
+#endif
+  start = 0;
+  HAL_UART_Receive_DMA(&huart2, (uint8_t*)dma_rx2_buffer, dma_rx2_size);
 
   // Enable IDLE interrupt
   __HAL_UART_ENABLE_IT(&huart2, UART_IT_IDLE);
@@ -92,7 +133,31 @@ int umodem_hal_send(const uint8_t* buf, size_t len) {
   return len;
 }
 
+#if UMODEM_PORT_RX_DMA_DIRECT
+// Bytes are already in the ring storage, only advance its head
+int umodem_hal_read(uint8_t* buf, size_t len) {
+  (void)buf;
+  (void)len;
+
+  umodem_hal_lock();
+  if (rx2_rewind) {
+    rx2_rewind = 0;
+    umodem_buffer_rewind();
+    start = 0;
+  }
+
+  size_t end = dma_rx2_size - __HAL_DMA_GET_COUNTER(&hdma_usart2_rx);
+  if (end == dma_rx2_size) end = 0;
+  if (end != start) {
+    umodem_buffer_commit((end + dma_rx2_size - start) % dma_rx2_size);
+    start = end;
+  }
+  umodem_hal_unlock();
+  return 0;
+}
+#else
 int umodem_hal_read(uint8_t* buf, size_t len) { return 0; }
+#endif
 
 uint32_t umodem_hal_millis(void) {
   return osKernelGetTickCount() * portTICK_PERIOD_MS;
@@ -100,6 +165,13 @@ uint32_t umodem_hal_millis(void) {
 
 void umodem_hal_delay_ms(uint32_t ms) { osDelay(pdMS_TO_TICKS(ms)); }
 
+void umodem_hal_wait_rx(uint32_t timeout_ms) {
+  if (timeout_ms == UMODEM_POLL_INFINITE)
+    osSemaphoreAcquire(rx2_sem, osWaitForever);
+  else
+    osSemaphoreAcquire(rx2_sem, pdMS_TO_TICKS(timeout_ms));
+}
+
 void umodem_hal_lock(void) { osSemaphoreAcquire(tx2_sem, osWaitForever); }
 
 void umodem_hal_unlock(void) { osSemaphoreRelease(tx2_sem); }
@@ -135,13 +207,18 @@ void HAL_UART_ErrorCallback(UART_HandleTypeDef* huart) {
     // Stop DMA
     HAL_UART_DMAStop(huart);
 
-    // Restart DMA
+    // Restart DMA, in direct mode the task rewinds the ring to match
     if (HAL_UART_Receive_DMA(
-            &huart2, (uint8_t*)dma_rx2_buffer, DMA_RX_BUFFER_SIZE) != HAL_OK)
+            &huart2, (uint8_t*)dma_rx2_buffer, dma_rx2_size) != HAL_OK)
       Error_Handler();
 
     __HAL_UART_ENABLE_IT(&huart2, UART_IT_IDLE);
+#if UMODEM_PORT_RX_DMA_DIRECT
+    rx2_rewind = 1;
+    osSemaphoreRelease(rx2_sem);
+#else
     start = 0;
+#endif
   }
 }
 
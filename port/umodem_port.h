@@ -9,6 +9,15 @@ extern "C"
 {
 #endif
 
+  /**
+   * @brief One segment of a gathered transmit, see `umodem_hal_sendv()`.
+   */
+  typedef struct
+  {
+    const uint8_t *base;
+    size_t len;
+  } umodem_iovec_t;
+
   /**
    * @brief Initialize the modem transport (e.g., UART, USB, socket).
    *
@@ -33,6 +42,21 @@ extern "C"
    */
   int umodem_hal_send(const uint8_t *buf, size_t len);
 
+  /**
+   * @brief Send several buffers to the modem as one transmission.
+   *
+   * Same contract as `umodem_hal_send()`, but lets a command, its payload and
+   * terminator leave in a single write (e.g. `writev()` or one DMA chain).
+   *
+   * Optional: the default implementation calls `umodem_hal_send()` for each
+   * segment.
+   *
+   * @param iov Array of segments.
+   * @param iovcnt Number of segments.
+   * @return Total number of bytes sent, or negative on error.
+   */
+  int umodem_hal_sendv(const umodem_iovec_t *iov, size_t iovcnt);
+
   /**
    * @brief Read any avialble data from modem.
    * 
@@ -62,6 +86,44 @@ extern "C"
    */
   void umodem_hal_delay_ms(uint32_t ms);
 
+  /**
+   * @brief Block until new RX data arrives or the timeout elapses.
+   *
+   * Lets the application sleep between `umodem_poll()` calls instead of
+   * polling at a fixed rate. Implementations should return early as soon as
+   * data has been pushed into the uModem buffer.
+   *
+   * Optional: the default implementation sleeps for at most 10 ms.
+   *
+   * @param timeout_ms Maximum time to wait, or `UMODEM_POLL_INFINITE` to wait
+   *                   for RX data only.
+   */
+  void umodem_hal_wait_rx(uint32_t timeout_ms);
+
+  /**
+   * @brief Change the UART rate.
+   *
+   * Called by `umodem_set_baudrate()` right after the modem acknowledged the
+   * new rate. Pending output must be transmitted at the old rate first (e.g.
+   * `tcsetattr(TCSADRAIN)` or waiting for the TX FIFO to empty).
+   *
+   * Optional: the default implementation returns -1 (rate is fixed).
+   *
+   * @param baudrate New rate in bits per second.
+   * @return 0 on success, negative if the rate is not supported.
+   */
+  int umodem_hal_set_baudrate(uint32_t baudrate);
+
+  /**
+   * @brief Enable or disable RTS/CTS hardware flow control on the UART.
+   *
+   * Optional: the default implementation returns -1 (no flow control lines).
+   *
+   * @param enable Non-zero to enable, 0 to disable.
+   * @return 0 on success, negative if not supported.
+   */
+  int umodem_hal_set_flow_control(int enable);
+
   /**
    * @brief Acquire a lock to protect uModem internal state.
    *
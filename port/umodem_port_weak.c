@@ -10,6 +10,16 @@ UMODEM_WEAK int umodem_hal_send(const uint8_t* buf, size_t len) {
   return -1;
 }
 
+UMODEM_WEAK int umodem_hal_sendv(const umodem_iovec_t* iov, size_t iovcnt) {
+  int total = 0;
+  for (size_t i = 0; i < iovcnt; i++) {
+    int sent = umodem_hal_send(iov[i].base, iov[i].len);
+    if (sent < 0) return sent;
+    total += sent;
+  }
+  return total;
+}
+
 UMODEM_WEAK int umodem_hal_read(uint8_t* buf, size_t len) {
   return 0;
 }
@@ -18,6 +28,14 @@ UMODEM_WEAK uint32_t umodem_hal_millis(void) { return 0; }
 
 UMODEM_WEAK void umodem_hal_delay_ms(uint32_t ms) {}
 
+UMODEM_WEAK void umodem_hal_wait_rx(uint32_t timeout_ms) {
+  umodem_hal_delay_ms(timeout_ms < 10 ? timeout_ms : 10);
+}
+
+UMODEM_WEAK int umodem_hal_set_baudrate(uint32_t baudrate) { return -1; }
+
+UMODEM_WEAK int umodem_hal_set_flow_control(int enable) { return -1; }
+
 UMODEM_WEAK void umodem_hal_lock(void) {}
 
 UMODEM_WEAK void umodem_hal_unlock(void) {}
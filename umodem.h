@@ -6,5 +6,10 @@
 #include "umodem_event.h"
 #include "umodem_sock.h"
 #include "umodem_mqtt.h"
+#include "umodem_http.h"
+#include "umodem_metrics.h"
+#include "umodem_trace.h"
+#include "umodem_cmux.h"
+#include "umodem_ppp.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,377 @@
+#ifndef uMODEM_HPP_
+#define uMODEM_HPP_
+
+/*
+ * C++17 wrapper over the C API.
+ *
+ * Header-only and optional: it owns nothing but the handles the C layer
+ * hands out. Modem, Socket, MqttSession and Subscription release them in
+ * their destructors and are move-only, so error paths need no manual
+ * cleanup. Payloads and topics are passed as views with explicit lengths,
+ * and event callbacks are plain callables bound through a static thunk,
+ * without virtual dispatch or allocation.
+ *
+ *   umodem::Modem modem(apn);
+ *   if (!modem || modem.open_data() != UMODEM_OK) return;
+ *
+ *   auto sock = umodem::Socket::create(UMODEM_SOCK_TCP);
+ *   if (sock.connect("example.com", 7, 10000) == UMODEM_OK)
+ *     sock.send(std::string_view("hello"));
+ *   // closed when sock goes out of scope
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+
+#include "umodem.h"
+
+namespace umodem {
+
+using Result = umodem_result_t;
+
+#if defined(__cpp_lib_span)
+template <class T>
+using span = std::span<T>;
+#else
+/** @brief Minimal stand-in for std::span before C++20. */
+template <class T>
+class span {
+ public:
+  constexpr span() noexcept = default;
+  constexpr span(T* data, size_t size) noexcept : data_(data), size_(size) {}
+  template <size_t N>
+  constexpr span(T (&array)[N]) noexcept : data_(array), size_(N) {}
+  // Contiguous containers (std::array, std::vector, ...)
+  template <class C,
+      class = std::enable_if_t<std::is_convertible_v<
+          decltype(std::declval<C&>().data()), T*>>>
+  constexpr span(C& c) noexcept : data_(c.data()), size_(c.size()) {}
+
+  constexpr T* data() const noexcept { return data_; }
+  constexpr size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  constexpr T* begin() const noexcept { return data_; }
+  constexpr T* end() const noexcept { return data_ + size_; }
+  constexpr T& operator[](size_t i) const noexcept { return data_[i]; }
+
+ private:
+  T* data_ = nullptr;
+  size_t size_ = 0;
+};
+#endif
+
+/** @brief Bytes of a string, e.g. a text payload. */
+inline span<const uint8_t> as_bytes(std::string_view s) noexcept {
+  return {reinterpret_cast<const uint8_t*>(s.data()), s.size()};
+}
+
+/** @brief Received MQTT message, valid for the duration of the callback. */
+struct MqttMessage {
+  int session;
+  std::string_view topic;
+  span<const uint8_t> payload;
+};
+
+/** @brief Typed view of an event, valid for the duration of the callback. */
+class Event {
+ public:
+  explicit Event(umodem_event_t* event) noexcept : event_(event) {}
+
+  umodem_event_flag_t flag() const noexcept {
+    return umodem_event_get_flag(event_);
+  }
+
+  /** @brief Socket of a UMODEM_EVENT_SOCK_* event, -1 otherwise. */
+  int socket() const noexcept {
+    switch (flag()) {
+    case UMODEM_EVENT_SOCK_CONNECTED:
+    case UMODEM_EVENT_SOCK_CLOSED:
+    case UMODEM_EVENT_SOCK_DATA_RECEIVED:
+    case UMODEM_EVENT_SOCK_ACCEPTED: {
+      const int* fd = static_cast<const int*>(umodem_get_event_data(event_));
+      return fd ? *fd : -1;
+    }
+    default: return -1;
+    }
+  }
+
+  /** @brief Message of a UMODEM_EVENT_MQTT_DATA_* event. */
+  bool mqtt(MqttMessage& msg) const noexcept {
+    if (flag() != UMODEM_EVENT_MQTT_DATA_RECEIVED &&
+        flag() != UMODEM_EVENT_MQTT_DATA_PUBLISHED)
+      return false;
+    const auto* d = static_cast<const umodem_event_mqtt_data_t*>(
+        umodem_get_event_data(event_));
+    if (!d) return false;
+    msg.session = d->sockfd;
+    msg.topic = std::string_view(d->topic ? d->topic : "", d->topic_len);
+    msg.payload = span<const uint8_t>(d->data, d->data_len);
+    return true;
+  }
+
+  umodem_event_t* raw() const noexcept { return event_; }
+
+ private:
+  umodem_event_t* event_;
+};
+
+/** @brief Event subscription, removed on destruction. */
+class Subscription {
+ public:
+  Subscription() noexcept = default;
+
+  /**
+   * @brief Subscribe @p fn, called as fn(const Event&), to the events in
+   * @p mask. The callable is referenced, not copied: it must outlive the
+   * subscription.
+   */
+  template <class F>
+  Subscription(uint32_t mask, F& fn) noexcept
+      : handle_(umodem_event_subscribe(mask, &thunk<F>, &fn)) {}
+
+  Subscription(Subscription&& other) noexcept
+      : handle_(std::exchange(other.handle_, -1)) {}
+  Subscription& operator=(Subscription&& other) noexcept {
+    if (this != &other) {
+      reset();
+      handle_ = std::exchange(other.handle_, -1);
+    }
+    return *this;
+  }
+  Subscription(const Subscription&) = delete;
+  Subscription& operator=(const Subscription&) = delete;
+  ~Subscription() { reset(); }
+
+  explicit operator bool() const noexcept { return handle_ >= 0; }
+
+  void reset() noexcept {
+    if (handle_ >= 0) umodem_event_unsubscribe(handle_);
+    handle_ = -1;
+  }
+
+ private:
+  template <class F>
+  static void thunk(umodem_event_t* event, void* ctx) {
+    (*static_cast<F*>(ctx))(Event(event));
+  }
+
+  int handle_ = -1;
+};
+
+/**
+ * @brief Library and modem lifetime: umodem_init() on construction, and on
+ * destruction the MQTT client, the data context and the library are torn
+ * down in that order, as far as they were brought up.
+ */
+class Modem {
+ public:
+  explicit Modem(umodem_apn_t& apn) noexcept
+      : init_(umodem_init(&apn)), up_(init_ == UMODEM_OK) {}
+
+  Modem(Modem&& other) noexcept
+      : init_(other.init_), up_(std::exchange(other.up_, false)),
+        data_(std::exchange(other.data_, false)),
+        mqtt_(std::exchange(other.mqtt_, false)) {}
+  Modem& operator=(Modem&&) = delete;
+  Modem(const Modem&) = delete;
+  Modem& operator=(const Modem&) = delete;
+
+  ~Modem() {
+    if (mqtt_) umodem_mqtt_deinit();
+    if (data_) umodem_sock_deinit();
+    if (up_) umodem_deinit();
+  }
+
+  /** @brief Whether umodem_init() succeeded, see result(). */
+  explicit operator bool() const noexcept { return up_; }
+  Result result() const noexcept { return init_; }
+
+  /** @brief Bring up the data context for sockets and HTTP. */
+  Result open_data() noexcept {
+    if (!up_) return UMODEM_ERR;
+    if (data_) return UMODEM_OK;
+    Result r = umodem_sock_init();
+    data_ = r == UMODEM_OK;
+    return r;
+  }
+
+  /** @brief Start the MQTT client. */
+  Result open_mqtt() noexcept {
+    if (!up_) return UMODEM_ERR;
+    if (mqtt_) return UMODEM_OK;
+    Result r = umodem_mqtt_init();
+    mqtt_ = r == UMODEM_OK;
+    return r;
+  }
+
+  uint32_t poll() noexcept { return umodem_poll(); }
+  void wait(uint32_t timeout_ms) noexcept { umodem_wait(timeout_ms); }
+
+  Result imei(span<char> buf) noexcept {
+    return umodem_get_imei(buf.data(), buf.size());
+  }
+  Result iccid(span<char> buf) noexcept {
+    return umodem_get_iccid(buf.data(), buf.size());
+  }
+  Result signal_quality(int& rssi, int& ber) noexcept {
+    return umodem_get_signal_quality(&rssi, &ber);
+  }
+
+ private:
+  Result init_;
+  bool up_;
+  bool data_ = false;
+  bool mqtt_ = false;
+};
+
+/** @brief Modem socket, closed on destruction. */
+class Socket {
+ public:
+  Socket() noexcept = default;
+
+  /** @brief Allocate a socket, check the result with operator bool. */
+  static Socket create(umodem_sock_type_t type) noexcept {
+    return Socket(umodem_sock_create(type));
+  }
+
+  /** @brief Take the next inbound connection of umodem_sock_listen(). */
+  static Socket accept() noexcept {
+    int fd = umodem_sock_accept();
+    return Socket(fd > 0 ? fd : -1);
+  }
+
+  Socket(Socket&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+  Socket& operator=(Socket&& other) noexcept {
+    if (this != &other) {
+      close();
+      fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+  }
+  Socket(const Socket&) = delete;
+  Socket& operator=(const Socket&) = delete;
+  ~Socket() { close(); }
+
+  explicit operator bool() const noexcept { return fd_ > 0; }
+  int fd() const noexcept { return fd_; }
+
+  Result connect(
+      std::string_view host, uint16_t port, uint32_t timeout_ms) noexcept {
+    return umodem_sock_connect(fd_, host.data(), host.size(), port, timeout_ms);
+  }
+
+  /** @return Bytes sent, or -1 on failure. */
+  int send(span<const uint8_t> data) noexcept {
+    return umodem_sock_send(fd_, data.data(), data.size());
+  }
+  int send(std::string_view data) noexcept { return send(as_bytes(data)); }
+
+  /** @return Bytes received, 0 if none are pending, -1 on failure. */
+  int recv(span<uint8_t> buf) noexcept {
+    return umodem_sock_recv(fd_, buf.data(), buf.size());
+  }
+
+  /** @brief Send one datagram (UDP), see umodem_sock_sendto(). */
+  int sendto(span<const uint8_t> data, std::string_view host,
+      uint16_t port) noexcept {
+    return umodem_sock_sendto(
+        fd_, data.data(), data.size(), host.data(), host.size(), port);
+  }
+
+  /** @brief Receive one datagram, see umodem_sock_recvfrom(). */
+  int recvfrom(span<uint8_t> buf, umodem_sock_addr_t& from) noexcept {
+    return umodem_sock_recvfrom(fd_, buf.data(), buf.size(), &from);
+  }
+
+  /** @brief Coalesce small sends, see umodem_sock_set_coalesce(). */
+  Result coalesce(size_t threshold, uint32_t delay_ms) noexcept {
+    return umodem_sock_set_coalesce(fd_, threshold, delay_ms);
+  }
+  Result nodelay(bool enable) noexcept {
+    return umodem_sock_set_nodelay(fd_, enable ? 1 : 0);
+  }
+  Result flush() noexcept { return umodem_sock_flush(fd_); }
+
+  Result close() noexcept {
+    if (fd_ <= 0) return UMODEM_OK;
+    return umodem_sock_close(std::exchange(fd_, -1));
+  }
+
+ private:
+  explicit Socket(int fd) noexcept : fd_(fd) {}
+
+  int fd_ = -1;
+};
+
+/** @brief MQTT connection, disconnected on destruction. */
+class MqttSession {
+ public:
+  MqttSession() noexcept = default;
+
+  /**
+   * @brief Connect to a broker, check the result with operator bool.
+   *
+   * @param host  NUL-terminated, as the modem takes it as a C string.
+   */
+  static MqttSession connect(const char* host, uint16_t port,
+      const umodem_mqtt_connect_opts_t& opts) noexcept {
+    return MqttSession(umodem_mqtt_connect(host, port, &opts));
+  }
+
+  MqttSession(MqttSession&& other) noexcept
+      : id_(std::exchange(other.id_, -1)) {}
+  MqttSession& operator=(MqttSession&& other) noexcept {
+    if (this != &other) {
+      disconnect();
+      id_ = std::exchange(other.id_, -1);
+    }
+    return *this;
+  }
+  MqttSession(const MqttSession&) = delete;
+  MqttSession& operator=(const MqttSession&) = delete;
+  ~MqttSession() { disconnect(); }
+
+  explicit operator bool() const noexcept { return id_ > 0; }
+  int id() const noexcept { return id_; }
+
+  Result publish(std::string_view topic, span<const uint8_t> payload,
+      umodem_mqtt_qos_t qos = UMODEM_MQTT_QOS_0, bool retain = false) noexcept {
+    return umodem_mqtt_publish(id_, topic.data(), topic.size(),
+        payload.data(), payload.size(), qos, retain ? 1 : 0);
+  }
+  Result publish(std::string_view topic, std::string_view payload,
+      umodem_mqtt_qos_t qos = UMODEM_MQTT_QOS_0, bool retain = false) noexcept {
+    return publish(topic, as_bytes(payload), qos, retain);
+  }
+
+  /** @brief The driver keeps referring to @p topic while subscribed. */
+  Result subscribe(std::string_view topic,
+      umodem_mqtt_qos_t qos = UMODEM_MQTT_QOS_0) noexcept {
+    return umodem_mqtt_subscribe(id_, topic.data(), topic.size(), qos);
+  }
+  Result unsubscribe(std::string_view topic) noexcept {
+    return umodem_mqtt_unsubscribe(id_, topic.data(), topic.size());
+  }
+
+  Result disconnect() noexcept {
+    if (id_ <= 0) return UMODEM_OK;
+    return umodem_mqtt_disconnect(std::exchange(id_, -1));
+  }
+
+ private:
+  explicit MqttSession(int id) noexcept : id_(id) {}
+
+  int id_ = -1;
+};
+
+} // namespace umodem
+
+#endif
@@ -1,12 +1,29 @@
 #include <string.h>
+#include <limits.h>
 #include <stdlib.h>
 
 #include "umodem_core.h"
 #include "umodem_at.h"
 #include "umodem_buffer.h"
+#include "umodem_cmux.h"
+#include "umodem_metrics.h"
+#include "umodem_ppp.h"
+#include "umodem_trace.h"
 
 #include "port/umodem_port.h"
 
+// Nesting depth of umodem_at_send() plus held commands, see umodem_at_busy()
+static volatile int at_in_flight = 0;
+
+// Ring of the channel in transparent mode, see umodem_at_set_raw()
+static umodem_ring_t *raw_ring = NULL;
+
+// See umodem_at_cme_error()
+static int at_cme_error = 0;
+
+static umodem_result_t at_transact(umodem_at_channel_t channel, const char *cmd, char *response, size_t resp_len, uint32_t timeout_ms);
+static umodem_result_t at_take_result(umodem_ring_t *ring, char *response, size_t resp_len);
+
 void umodem_at_init()
 {
   umodem_hal_init();
@@ -17,135 +34,587 @@ void umodem_at_deinit()
   umodem_hal_deinit();
 }
 
+int umodem_at_busy(void)
+{
+  return at_in_flight > 0;
+}
+
+int umodem_at_cme_error(void)
+{
+  return at_cme_error;
+}
+
+void umodem_at_hold(void)
+{
+  umodem_hal_lock();
+  at_in_flight++;
+  umodem_hal_unlock();
+}
+
+void umodem_at_release(void)
+{
+  umodem_hal_lock();
+  if (at_in_flight > 0)
+    at_in_flight--;
+  umodem_hal_unlock();
+}
+
+// RX ring holding the replies of a channel
+static umodem_ring_t *channel_ring(umodem_at_channel_t channel)
+{
+#if UMODEM_CMUX_ENABLE
+  if (channel == UMODEM_AT_CH_DATA && umodem_cmux_active())
+    return umodem_cmux_data_ring();
+#endif
+  return umodem_buffer_ring();
+}
+
+umodem_ring_t *umodem_at_ring(umodem_at_channel_t channel)
+{
+  return channel_ring(channel);
+}
+
+// A channel carrying PPP frames or transparent socket data
+static int channel_in_data_mode(umodem_at_channel_t channel)
+{
+  umodem_ring_t *ring = channel_ring(channel);
+  return ring == umodem_ppp_ring() || ring == raw_ring;
+}
+
+void umodem_at_set_raw(umodem_at_channel_t channel, int raw)
+{
+  umodem_hal_lock();
+  raw_ring = raw ? channel_ring(channel) : NULL;
+  umodem_hal_unlock();
+}
+
+umodem_ring_t *umodem_at_raw_ring(void)
+{
+  return raw_ring;
+}
+
+int umodem_at_write(const uint8_t *data, size_t len)
+{
+  return umodem_at_write_on(UMODEM_AT_CH_CONTROL, data, len);
+}
+
+int umodem_at_write_on(umodem_at_channel_t channel, const uint8_t *data, size_t len)
+{
+#if UMODEM_CMUX_ENABLE
+  // Frames are accounted for by the multiplexer
+  if (umodem_cmux_active())
+    return umodem_cmux_write(channel == UMODEM_AT_CH_DATA ? UMODEM_CMUX_DLC_DATA : UMODEM_CMUX_DLC_CONTROL, data, len);
+#endif
+
+  int written = umodem_hal_send(data, len);
+  if (written > 0)
+  {
+    UMODEM_METRICS_TX((size_t)written);
+    UMODEM_TRACE_TX(data, (size_t)written);
+  }
+  return written;
+}
+
 umodem_result_t umodem_at_send(const char *cmd, char *response, size_t resp_len, uint32_t timeout_ms)
 {
-  if (umodem_hal_send((const uint8_t *)cmd, strlen(cmd)) < 0)
+  return umodem_at_send_on(UMODEM_AT_CH_CONTROL, cmd, response, resp_len, timeout_ms);
+}
+
+umodem_result_t umodem_at_send_on(umodem_at_channel_t channel, const char *cmd, char *response, size_t resp_len, uint32_t timeout_ms)
+{
+#if UMODEM_METRICS_ENABLE
+  uint32_t start = umodem_hal_millis();
+#endif
+
+  // A channel in data mode does not take commands
+  if (channel_in_data_mode(channel))
+    return UMODEM_ERR;
+
+  // Channels may be driven from different threads
+  umodem_hal_lock();
+  at_in_flight++;
+  umodem_hal_unlock();
+
+  umodem_result_t result = at_transact(channel, cmd, response, resp_len, timeout_ms);
+
+  umodem_hal_lock();
+  at_in_flight--;
+  umodem_hal_unlock();
+
+  UMODEM_METRICS_AT(cmd, umodem_hal_millis() - start, result);
+  return result;
+}
+
+umodem_result_t umodem_at_send_expect(umodem_at_channel_t channel, const char *cmd, const char *expect, uint32_t timeout_ms)
+{
+  if (!expect || !expect[0] || channel_in_data_mode(channel))
     return UMODEM_ERR;
 
+#if UMODEM_METRICS_ENABLE
+  uint32_t start = umodem_hal_millis();
+#endif
+
+  umodem_hal_lock();
+  at_in_flight++;
+  umodem_hal_unlock();
+
+  umodem_ring_t *ring = channel_ring(channel);
+  umodem_result_t result = UMODEM_TIMEOUT;
+
+  if (cmd && umodem_at_write_on(channel, (const uint8_t *)cmd, strlen(cmd)) < 0)
+    result = UMODEM_ERR;
+
   uint32_t time_start = umodem_hal_millis();
-  while (umodem_hal_millis() - time_start <= timeout_ms)
+  while (result == UMODEM_TIMEOUT && umodem_hal_millis() - time_start <= timeout_ms)
   {
     umodem_poll(); // Process URCs
 
     umodem_hal_lock();
 
-    int pos = -1;
-    size_t match_len = 0;
-    umodem_result_t result = UMODEM_ERR;
-
-    // Success responses
-    if ((pos = umodem_buffer_find((uint8_t *)"\r\nSEND OK\r\n", 11)) >= 0)
-    {
-      pos += 2;
-      match_len = 9;
-      result = UMODEM_OK;
-    }
-    else if ((pos = umodem_buffer_find((uint8_t *)"\r\nCLOSE OK\r\n", 12)) >= 0)
-    {
-      pos += 2;
-      match_len = 10;
-      result = UMODEM_OK;
-    }
-    else if ((pos = umodem_buffer_find((uint8_t *)"\r\nDEACT OK\r\n", 12)) >= 0)
-    {
-      pos += 2;
-      match_len = 10;
+    static const char *const failures[] = {"\r\nERROR\r\n", "+CME ERROR:", "NO CARRIER", "SEND FAIL"};
+    size_t pos = umodem_ring_find_from(ring, (const uint8_t *)expect, strlen(expect), 0);
+    if (pos != UMODEM_RING_NPOS)
       result = UMODEM_OK;
-    }
-    else if ((pos = umodem_buffer_find((uint8_t *)"\r\nOK\r\n", 6)) >= 0)
+    else
     {
-      pos += 2;
-      match_len = 4;
-      result = UMODEM_OK;
+      for (size_t i = 0; i < sizeof(failures) / sizeof(failures[0]) && pos == UMODEM_RING_NPOS; i++)
+        pos = umodem_ring_find_from(ring, (const uint8_t *)failures[i], strlen(failures[i]), 0);
+      if (pos != UMODEM_RING_NPOS)
+        result = UMODEM_ERR;
     }
-    else if ((pos = umodem_buffer_find((uint8_t *)"\r\n> ", 4)) >= 0)
+
+    // Consume the result line once it is complete
+    if (pos != UMODEM_RING_NPOS)
     {
-      pos += 2;
-      match_len = 2;
-      result = UMODEM_OK;
+      size_t end_pos = umodem_ring_find_from(ring, (const uint8_t *)"\r\n", 2, pos + 1);
+      if (end_pos != UMODEM_RING_NPOS)
+        umodem_ring_pop(ring, NULL, end_pos + 2);
+      else
+        result = UMODEM_TIMEOUT;
     }
 
-    // Error responses
-    else if ((pos = umodem_buffer_find((uint8_t *)"\r\nERROR\r\n", 9)) >= 0)
+    umodem_hal_unlock();
+    if (result == UMODEM_TIMEOUT)
+      umodem_hal_wait_rx(10);
+  }
+
+  umodem_hal_lock();
+  at_in_flight--;
+  umodem_hal_unlock();
+
+  if (cmd)
+    UMODEM_METRICS_AT(cmd, umodem_hal_millis() - start, result);
+  return result;
+}
+
+int umodem_at_send_read(umodem_at_channel_t channel, const char *cmd, const char *prefix, uint8_t *buf, size_t len, uint32_t timeout_ms)
+{
+  return umodem_at_send_read_header(channel, cmd, prefix, NULL, 0, buf, len, timeout_ms);
+}
+
+int umodem_at_send_read_header(umodem_at_channel_t channel, const char *cmd, const char *prefix, char *header, size_t header_size, uint8_t *buf, size_t len, uint32_t timeout_ms)
+{
+  if (!cmd || !prefix || !prefix[0] || !buf || channel_in_data_mode(channel))
+    return -1;
+  if (header && header_size > 0)
+    header[0] = '\0';
+
+#if UMODEM_METRICS_ENABLE
+  uint32_t start = umodem_hal_millis();
+#endif
+
+  umodem_hal_lock();
+  at_in_flight++;
+  umodem_hal_unlock();
+
+  umodem_ring_t *ring = channel_ring(channel);
+  size_t prefix_len = strlen(prefix);
+  size_t data_left = 0, copied = 0;
+  int in_data = 0;
+  int result = -1;
+  int done = umodem_at_write_on(channel, (const uint8_t *)cmd, strlen(cmd)) < 0;
+
+  uint32_t time_start = umodem_hal_millis();
+  while (!done && umodem_hal_millis() - time_start <= timeout_ms)
+  {
+    umodem_poll(); // Process URCs
+
+    umodem_hal_lock();
+
+    size_t drained = 0;
+    if (!in_data)
     {
-      pos += 2;
-      match_len = 7;
+      size_t head = umodem_ring_find_from(ring, (const uint8_t *)prefix, prefix_len, 0);
+      size_t eol = head != UMODEM_RING_NPOS ? umodem_ring_find_from(ring, (const uint8_t *)"\r\n", 2, head) : UMODEM_RING_NPOS;
+      if (eol != UMODEM_RING_NPOS)
+      {
+        // Header line complete, the payload follows right after it
+        char line[64];
+        size_t line_len = eol - head;
+        if (line_len >= sizeof(line))
+          line_len = sizeof(line) - 1;
+        umodem_ring_peek_from(ring, (uint8_t *)line, head, line_len);
+        line[line_len] = '\0';
+        if (header && header_size > 0)
+        {
+          size_t n = line_len < header_size - 1 ? line_len : header_size - 1;
+          memcpy(header, line, n);
+          header[n] = '\0';
+        }
+
+        const char *field = strrchr(line, ',');
+        data_left = strtoul(field ? field + 1 : line + prefix_len, NULL, 10);
+        umodem_ring_pop(ring, NULL, eol + 2);
+        in_data = 1;
+      }
+      else if (head == UMODEM_RING_NPOS)
+      {
+        size_t ok = umodem_ring_find_from(ring, (const uint8_t *)"\r\nOK\r\n", 6, 0);
+        size_t err = umodem_ring_find_from(ring, (const uint8_t *)"\r\nERROR\r\n", 9, 0);
+        if (err == UMODEM_RING_NPOS)
+          err = umodem_ring_find_from(ring, (const uint8_t *)"+CME ERROR:", 11, 0);
+
+        if (ok != UMODEM_RING_NPOS)
+        {
+          umodem_ring_pop(ring, NULL, ok + 6);
+          result = 0;
+          done = 1;
+        }
+        else if (err != UMODEM_RING_NPOS)
+        {
+          size_t end_pos = umodem_ring_find_from(ring, (const uint8_t *)"\r\n", 2, err + 1);
+          if (end_pos != UMODEM_RING_NPOS)
+          {
+            umodem_ring_pop(ring, NULL, end_pos + 2);
+            done = 1;
+          }
+        }
+      }
     }
-    else if ((pos = umodem_buffer_find((uint8_t *)"+CME ERROR:", 11)) >= 0)
+
+    if (in_data)
     {
-      int end_pos = umodem_buffer_find_from((uint8_t *)"\r\n", 2, pos);
-      if (end_pos >= pos + 11)
-        match_len = (size_t)(end_pos - pos) + 2; // include \r\n
+      // Drain the payload as it arrives, the ring may be smaller than it
+      size_t avail = umodem_ring_get_count(ring);
+      size_t n = avail < data_left ? avail : data_left;
+      size_t copy = copied + n <= len ? n : len - copied;
+      umodem_ring_pop(ring, buf + copied, copy);
+      umodem_ring_pop(ring, NULL, n - copy);
+      copied += copy;
+      data_left -= n;
+      drained = n;
+
+      size_t ok = data_left == 0 ? umodem_ring_find_from(ring, (const uint8_t *)"\r\nOK\r\n", 6, 0) : UMODEM_RING_NPOS;
+      if (ok != UMODEM_RING_NPOS)
+      {
+        umodem_ring_pop(ring, NULL, ok + 6);
+        result = (int)copied;
+        done = 1;
+      }
     }
-    else if ((pos = umodem_buffer_find((uint8_t *)"+CMS ERROR:", 11)) >= 0)
+
+    umodem_hal_unlock();
+    if (!done && !drained)
+      umodem_hal_wait_rx(10);
+  }
+
+  umodem_hal_lock();
+  at_in_flight--;
+  umodem_hal_unlock();
+
+  UMODEM_METRICS_AT(cmd, umodem_hal_millis() - start, result < 0 ? UMODEM_ERR : UMODEM_OK);
+  return result;
+}
+
+int umodem_at_read_line(umodem_at_channel_t channel, char *line, size_t len, uint32_t timeout_ms)
+{
+  if (!line || len == 0 || channel_in_data_mode(channel))
+    return -1;
+
+  umodem_hal_lock();
+  at_in_flight++;
+  umodem_hal_unlock();
+
+  umodem_ring_t *ring = channel_ring(channel);
+  int result = -1;
+
+  uint32_t time_start = umodem_hal_millis();
+  while (result < 0 && umodem_hal_millis() - time_start <= timeout_ms)
+  {
+    umodem_poll(); // Process URCs
+
+    umodem_hal_lock();
+
+    // Drop empty lines, then take the first complete one
+    size_t eol;
+    while ((eol = umodem_ring_find_from(ring, (const uint8_t *)"\r\n", 2, 0)) == 0)
+      umodem_ring_pop(ring, NULL, 2);
+
+    if (eol != UMODEM_RING_NPOS)
     {
-      int end_pos = umodem_buffer_find_from((uint8_t *)"\r\n", 2, pos);
-      if (end_pos >= pos + 11)
-        match_len = (size_t)(end_pos - pos) + 2;
+      size_t copy = eol < len - 1 ? eol : len - 1;
+      if (copy > 0)
+        umodem_ring_peek_from(ring, (uint8_t *)line, 0, copy);
+      line[copy] = '\0';
+      umodem_ring_pop(ring, NULL, eol + 2);
+      result = (int)copy;
     }
 
-    if (match_len > 0)
+    umodem_hal_unlock();
+    if (result < 0)
+      umodem_hal_wait_rx(10);
+  }
+
+  umodem_hal_lock();
+  at_in_flight--;
+  umodem_hal_unlock();
+
+  return result;
+}
+
+umodem_result_t umodem_at_poll_result(umodem_at_channel_t channel, char *response, size_t resp_len)
+{
+  if (channel_in_data_mode(channel))
+    return UMODEM_ERR;
+
+  umodem_hal_lock();
+  umodem_result_t result = at_take_result(channel_ring(channel), response, resp_len);
+  umodem_hal_unlock();
+  return result;
+}
+
+// Consume the final result code of a command from the ring, if it arrived.
+// Returns UMODEM_TIMEOUT while it has not; call with the HAL lock held.
+static umodem_result_t at_take_result(umodem_ring_t *ring, char *response, size_t resp_len)
+{
+  size_t pos;
+  size_t match_len = 0;
+  umodem_result_t result = UMODEM_ERR;
+  int cme = 0;
+
+  // Success responses
+  if ((pos = umodem_ring_find_from(ring, (uint8_t *)"\r\nSEND OK\r\n", 11, 0)) != UMODEM_RING_NPOS)
+  {
+    pos += 2;
+    match_len = 9;
+    result = UMODEM_OK;
+  }
+  else if ((pos = umodem_ring_find_from(ring, (uint8_t *)"CLOSE OK\r\n", 10, 0)) != UMODEM_RING_NPOS)
+  {
+    // With AT+QIMUX=1 the reply is "<id>, CLOSE OK"
+    match_len = 10;
+    result = UMODEM_OK;
+  }
+  else if ((pos = umodem_ring_find_from(ring, (uint8_t *)"\r\nDEACT OK\r\n", 12, 0)) != UMODEM_RING_NPOS)
+  {
+    pos += 2;
+    match_len = 10;
+    result = UMODEM_OK;
+  }
+  else if ((pos = umodem_ring_find_from(ring, (uint8_t *)"\r\nOK\r\n", 6, 0)) != UMODEM_RING_NPOS)
+  {
+    pos += 2;
+    match_len = 4;
+    result = UMODEM_OK;
+  }
+  else if ((pos = umodem_ring_find_from(ring, (uint8_t *)"\r\n> ", 4, 0)) != UMODEM_RING_NPOS)
+  {
+    pos += 2;
+    match_len = 2;
+    result = UMODEM_OK;
+  }
+
+  // Error responses
+  else if ((pos = umodem_ring_find_from(ring, (uint8_t *)"\r\nERROR\r\n", 9, 0)) != UMODEM_RING_NPOS)
+  {
+    pos += 2;
+    match_len = 7;
+  }
+  else if ((pos = umodem_ring_find_from(ring, (uint8_t *)"+CME ERROR:", 11, 0)) != UMODEM_RING_NPOS)
+  {
+    size_t end_pos = umodem_ring_find_from(ring, (uint8_t *)"\r\n", 2, pos);
+    if (end_pos != UMODEM_RING_NPOS && end_pos >= pos + 11)
+      match_len = end_pos - pos + 2; // include \r\n
+    cme = 1;
+  }
+  else if ((pos = umodem_ring_find_from(ring, (uint8_t *)"+CMS ERROR:", 11, 0)) != UMODEM_RING_NPOS)
+  {
+    size_t end_pos = umodem_ring_find_from(ring, (uint8_t *)"\r\n", 2, pos);
+    if (end_pos != UMODEM_RING_NPOS && end_pos >= pos + 11)
+      match_len = end_pos - pos + 2;
+  }
+
+  if (match_len > 0)
+  {
+    size_t total_len = pos;
+    uint8_t *buf = (uint8_t *)umodem_hal_alloc(total_len + match_len + 1);
+    memset(buf, 0, total_len + match_len + 1);
+    if (!buf)
+      return UMODEM_ERR; // out of memory
+
+    umodem_ring_pop(ring, buf, total_len + match_len);
+    at_cme_error = 0;
+    if (cme && !UMODEM_STRTOI((const char *)buf + total_len + 11, 0, INT_MAX, &at_cme_error))
+      at_cme_error = 0;
+    buf[total_len] = '\0';
+
+    if (response && resp_len > 0)
     {
-      size_t total_len = (size_t)pos;
-      uint8_t *buf = (uint8_t *)umodem_hal_alloc(total_len + match_len + 1);
-      memset(buf, 0, total_len + match_len + 1);
-      if (!buf)
+      uint8_t *payload_start = buf;
+      uint8_t *payload_end = buf + total_len; // points to start of "OK\r\n"
+
+      // Skip leading whitespace and empty lines
+      while (payload_start < payload_end && (*payload_start == '\r' || *payload_start == '\n'))
+        payload_start++;
+
+      // Trim trailing \r\n from payload_end
+      uint8_t max_trim = 4; // max 2 trailing \r\n pairs
+      while (payload_end > payload_start && max_trim > 0 &&
+             (*(payload_end - 1) == '\r' || *(payload_end - 1) == '\n'))
       {
-        umodem_hal_unlock();
-        return UMODEM_ERR; // out of memory
+        payload_end--;
+        max_trim--;
       }
 
-      umodem_buffer_pop(buf, total_len + match_len);
-      buf[total_len] = '\0';
-
-      if (response && resp_len > 0)
+      // Find last occurrence of "\r\n\r\n" before payload_end
+      uint8_t *last_empty_line = NULL;
+      uint8_t *search = payload_start;
+      while (search < payload_end - 3)
       {
-        uint8_t *payload_start = buf;
-        uint8_t *payload_end = buf + total_len; // points to start of "OK\r\n"
+        if (memcmp(search, (const uint8_t*)"\r\n\r\n", 4) == 0)
+          last_empty_line = search;
+        search++;
+      }
 
-        // Skip leading whitespace and empty lines
-        while (payload_start < payload_end && (*payload_start == '\r' || *payload_start == '\n'))
-          payload_start++;
+      if (last_empty_line && last_empty_line + 4 <= payload_end)
+        payload_start = last_empty_line + 4;
 
-        // Trim trailing \r\n from payload_end
-        uint8_t max_trim = 4; // max 2 trailing \r\n pairs
-        while (payload_end > payload_start && max_trim > 0 &&
-               (*(payload_end - 1) == '\r' || *(payload_end - 1) == '\n'))
-        {
-          payload_end--;
-          max_trim--;
-        }
+      size_t payload_len = (size_t)(payload_end - payload_start);
+      if (payload_len >= resp_len)
+        payload_len = resp_len - 1;
 
-        // Find last occurrence of "\r\n\r\n" before payload_end
-        uint8_t *last_empty_line = NULL;
-        uint8_t *search = payload_start;
-        while (search < payload_end - 3)
-        {
-          if (memcmp(search, (const uint8_t*)"\r\n\r\n", 4) == 0)
-            last_empty_line = search;
-          search++;
-        }
+      if (payload_len > 0)
+        memcpy(response, payload_start, payload_len);
+      response[payload_len] = '\0';
+    }
 
-        if (last_empty_line && last_empty_line + 4 <= payload_end)
-          payload_start = last_empty_line + 4;
+    umodem_hal_free(buf);
+    return result;
+  }
 
-        size_t payload_len = (size_t)(payload_end - payload_start);
-        if (payload_len >= resp_len)
-          payload_len = resp_len - 1;
+  return UMODEM_TIMEOUT;
+}
 
-        if (payload_len > 0)
-          memcpy(response, payload_start, payload_len);
-        response[payload_len] = '\0';
-      }
+static umodem_result_t at_transact(umodem_at_channel_t channel, const char *cmd, char *response, size_t resp_len, uint32_t timeout_ms)
+{
+  umodem_ring_t *ring = channel_ring(channel);
 
-      umodem_hal_unlock();
-      umodem_hal_free(buf);
-      return result;
-    }
+  if (umodem_at_write_on(channel, (const uint8_t *)cmd, strlen(cmd)) < 0)
+    return UMODEM_ERR;
 
+  uint32_t time_start = umodem_hal_millis();
+  while (umodem_hal_millis() - time_start <= timeout_ms)
+  {
+    umodem_poll(); // Process URCs
+
+    umodem_hal_lock();
+    umodem_result_t result = at_take_result(ring, response, resp_len);
     umodem_hal_unlock();
-    umodem_hal_delay_ms(10);
+
+    if (result != UMODEM_TIMEOUT)
+      return result;
+    umodem_hal_wait_rx(10);
   }
 
   return UMODEM_TIMEOUT; // timeout
-}
\ No newline at end of file
+}
+void umodem_at_cmd_init(umodem_at_cmd_t *cmd, char *buf, size_t size)
+{
+  cmd->buf = buf;
+  cmd->size = buf ? size : 0;
+  cmd->len = 0;
+  cmd->overflow = cmd->size == 0;
+  cmd->invalid = 0;
+}
+
+// Append raw bytes, keeping room for the NUL terminator
+static void cmd_put(umodem_at_cmd_t *cmd, const char *data, size_t len)
+{
+  if (cmd->overflow || len >= cmd->size - cmd->len)
+  {
+    cmd->overflow = 1;
+    return;
+  }
+
+  memcpy(cmd->buf + cmd->len, data, len);
+  cmd->len += len;
+}
+
+void umodem_at_cmd_str(umodem_at_cmd_t *cmd, const char *str)
+{
+  cmd_put(cmd, str, strlen(str));
+}
+
+// Append the decimal digits of v, after a '-' if negative is set
+static void cmd_put_number(umodem_at_cmd_t *cmd, unsigned long v, int negative)
+{
+  char digits[24];
+  char *p = digits + sizeof(digits);
+
+  do
+  {
+    *--p = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  if (negative)
+    *--p = '-';
+
+  cmd_put(cmd, p, (size_t)(digits + sizeof(digits) - p));
+}
+
+void umodem_at_cmd_int(umodem_at_cmd_t *cmd, long value)
+{
+  cmd_put_number(cmd, value < 0 ? 0UL - (unsigned long)value : (unsigned long)value, value < 0);
+}
+
+void umodem_at_cmd_uint(umodem_at_cmd_t *cmd, unsigned long value)
+{
+  cmd_put_number(cmd, value, 0);
+}
+
+umodem_result_t umodem_at_cmd_quoted(umodem_at_cmd_t *cmd, const char *str, size_t len)
+{
+  // A NUL ends the string, like "%.*s", so lengths counting it still work
+  const char *nul = memchr(str, '\0', len);
+  if (nul)
+    len = (size_t)(nul - str);
+
+  for (size_t i = 0; i < len; i++)
+  {
+    if (str[i] == '"' || (uint8_t)str[i] < 0x20 || str[i] == 0x7F)
+    {
+      cmd->invalid = 1;
+      return UMODEM_PARAM;
+    }
+  }
+
+  cmd_put(cmd, "\"", 1);
+  cmd_put(cmd, str, len);
+  cmd_put(cmd, "\"", 1);
+  return UMODEM_OK;
+}
+
+const char *umodem_at_cmd_cr(umodem_at_cmd_t *cmd)
+{
+  cmd_put(cmd, "\r", 1);
+  return umodem_at_cmd_end(cmd);
+}
+
+const char *umodem_at_cmd_end(umodem_at_cmd_t *cmd)
+{
+  if (cmd->overflow || cmd->invalid)
+    return NULL;
+
+  cmd->buf[cmd->len] = '\0';
+  return cmd->buf;
+}
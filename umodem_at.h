@@ -5,18 +5,222 @@
 #include "stddef.h"
 
 #include "umodem.h"
+#include "umodem_buffer.h"
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+  /**
+   * @brief Logical AT channel.
+   *
+   * With a CMUX session open (umodem_cmux.h) each channel is a separate DLC
+   * with its own RX ring, so a command on one channel never waits behind a
+   * transfer on the other. Otherwise both map to the serial link.
+   */
+  typedef enum
+  {
+    UMODEM_AT_CH_CONTROL = 0, // Configuration, status queries, URCs
+    UMODEM_AT_CH_DATA,        // Socket and MQTT payload transfers
+  } umodem_at_channel_t;
+
   void umodem_at_init(void);
 
   void umodem_at_deinit(void);
 
   umodem_result_t umodem_at_send(const char *cmd, char *response, size_t resp_len, uint32_t timeout_ms);
 
+  /**
+   * @brief Same as umodem_at_send() on a given channel.
+   */
+  umodem_result_t umodem_at_send_on(umodem_at_channel_t channel, const char *cmd, char *response, size_t resp_len, uint32_t timeout_ms);
+
+  /**
+   * @brief Send a command answered by an intermediate result instead of OK,
+   * e.g. "CONNECT" when a channel switches to data mode.
+   *
+   * The line holding @p expect is consumed; anything after it (e.g. the
+   * first PPP frames) stays in the channel's ring. ERROR, +CME ERROR,
+   * NO CARRIER and SEND FAIL fail the command. With @p cmd NULL nothing is
+   * written: only wait for the result of a payload written with
+   * umodem_at_write_on().
+   */
+  umodem_result_t umodem_at_send_expect(umodem_at_channel_t channel, const char *cmd, const char *expect, uint32_t timeout_ms);
+
+  /**
+   * @brief Send a command answered with a binary payload, such as
+   * "+QIRD: <addr>,TCP,<len>\r\n<data>\r\nOK".
+   *
+   * The payload length is the last comma-separated field of the line
+   * starting with @p prefix, and the payload is copied as is (it may hold
+   * NUL bytes or CR LF). A plain OK without that line means no data.
+   *
+   * @return Number of bytes copied to @p buf (at most @p len, the rest is
+   *         dropped), 0 if there was no payload, or -1 on error or timeout.
+   */
+  int umodem_at_send_read(umodem_at_channel_t channel, const char *cmd, const char *prefix, uint8_t *buf, size_t len, uint32_t timeout_ms);
+
+  /**
+   * @brief Same as umodem_at_send_read(), also copying the header line
+   * (from @p prefix up to its CR LF, truncated to fit) to @p header.
+   * @p header is left empty if there was no payload.
+   */
+  int umodem_at_send_read_header(umodem_at_channel_t channel, const char *cmd, const char *prefix, char *header, size_t header_size, uint8_t *buf, size_t len, uint32_t timeout_ms);
+
+  /**
+   * @brief Check, without waiting, for the final result of a command written
+   * with umodem_at_write_on(). Call it after umodem_poll() until it returns
+   * something other than UMODEM_TIMEOUT.
+   *
+   * Recognizes the same result codes and fills @p response like
+   * umodem_at_send_on(), which is built on it.
+   *
+   * @return UMODEM_OK or UMODEM_ERR once the final result was consumed,
+   *         UMODEM_TIMEOUT while it has not arrived yet.
+   */
+  umodem_result_t umodem_at_poll_result(umodem_at_channel_t channel, char *response, size_t resp_len);
+
+  /**
+   * @brief Wait for the next non-empty line on a channel, for results that
+   * follow the final OK (e.g. the address of AT+QIDNSGIP).
+   *
+   * The line is consumed and copied to @p line without its CR LF, truncated
+   * to @p len - 1 characters. URC lines are returned too, after they were
+   * dispatched.
+   *
+   * @return Length copied, or -1 on timeout.
+   */
+  int umodem_at_read_line(umodem_at_channel_t channel, char *line, size_t len, uint32_t timeout_ms);
+
+  /**
+   * @brief Get the RX ring currently backing a channel.
+   */
+  umodem_ring_t *umodem_at_ring(umodem_at_channel_t channel);
+
+  /**
+   * @brief Mark a channel as a raw byte pipe (transparent mode), or back.
+   *
+   * A raw channel takes no commands and its ring is not scanned for URCs:
+   * received bytes stay there until the owner pops them.
+   */
+  void umodem_at_set_raw(umodem_at_channel_t channel, int raw);
+
+  /**
+   * @brief Get the ring of the raw channel, NULL if there is none.
+   */
+  umodem_ring_t *umodem_at_raw_ring(void);
+
+  /**
+   * @brief Write raw bytes to the modem, e.g. a payload after the "> "
+   * prompt. All transmit paths go through here so they are accounted for.
+   *
+   * @return Number of bytes written, or a negative value on error.
+   */
+  int umodem_at_write(const uint8_t *data, size_t len);
+
+  /**
+   * @brief Same as umodem_at_write() on a given channel.
+   */
+  int umodem_at_write_on(umodem_at_channel_t channel, const uint8_t *data, size_t len);
+
+  /**
+   * @brief Check whether an AT command is waiting for its final result.
+   *
+   * umodem_poll() runs inside umodem_at_send() to process URCs; while this
+   * returns non-zero it queues events instead of dispatching them, so event
+   * callbacks may safely issue their own AT commands.
+   */
+  int umodem_at_busy(void);
+
+  /**
+   * @brief Code of the last final result consumed if it was "+CME ERROR",
+   * 0 for any other result code.
+   */
+  int umodem_at_cme_error(void);
+
+  /**
+   * @brief Count a command written with umodem_at_write_on() as in flight
+   * until umodem_at_release(), so umodem_at_busy() covers it like a
+   * command sent with umodem_at_send(). Hold it from before the write until
+   * its final result was consumed or given up on.
+   *
+   * Data phases that call umodem_poll() between commands, e.g. a body
+   * streamed after CONNECT, hold the channel the same way so that
+   * umodem_poll() does not send its own commands into them. Holds nest.
+   */
+  void umodem_at_hold(void);
+
+  /**
+   * @brief End a umodem_at_hold().
+   */
+  void umodem_at_release(void);
+
+  /**
+   * @brief AT command line being assembled, see umodem_at_cmd_init().
+   *
+   * Fields are private. Appending past the end of the buffer sets the
+   * overflow flag and is otherwise ignored, and so is a quoted parameter
+   * the modem cannot take, so a command can be built without checking
+   * every step.
+   */
+  typedef struct
+  {
+    char *buf;
+    size_t size;
+    size_t len;
+    int overflow;
+    int invalid;
+  } umodem_at_cmd_t;
+
+  /**
+   * @brief Start a command line in @p buf, a cheaper and bounded
+   * alternative to snprintf():
+   *
+   *   umodem_at_cmd_init(&c, buf, sizeof(buf));
+   *   umodem_at_cmd_str(&c, "AT+QISEND=");
+   *   umodem_at_cmd_int(&c, id);
+   *   const char *cmd = umodem_at_cmd_cr(&c); // "AT+QISEND=0\r", or NULL
+   */
+  void umodem_at_cmd_init(umodem_at_cmd_t *cmd, char *buf, size_t size);
+
+  /** @brief Append a NUL terminated string as is. */
+  void umodem_at_cmd_str(umodem_at_cmd_t *cmd, const char *str);
+
+  /** @brief Append a signed decimal number. */
+  void umodem_at_cmd_int(umodem_at_cmd_t *cmd, long value);
+
+  /** @brief Append an unsigned decimal number. */
+  void umodem_at_cmd_uint(umodem_at_cmd_t *cmd, unsigned long value);
+
+  /**
+   * @brief Append a string parameter in double quotes, as is.
+   *
+   * The M65 takes no escapes in quoted parameters, so a string holding a
+   * double quote or a control character cannot be sent: it is rejected
+   * and the line fails in umodem_at_cmd_cr(). Backslashes pass unchanged,
+   * and a NUL within @p len ends the string.
+   *
+   * @return UMODEM_OK, or UMODEM_PARAM if the string was rejected.
+   */
+  umodem_result_t umodem_at_cmd_quoted(umodem_at_cmd_t *cmd, const char *str, size_t len);
+
+  /**
+   * @brief Terminate the command line with CR.
+   *
+   * @return The NUL terminated command, or NULL if it did not fit or a
+   *         quoted parameter was rejected.
+   */
+  const char *umodem_at_cmd_cr(umodem_at_cmd_t *cmd);
+
+  /**
+   * @brief Terminate the text as built, without CR, e.g. a line that is
+   * not an AT command.
+   *
+   * @return The NUL terminated text, or NULL like umodem_at_cmd_cr().
+   */
+  const char *umodem_at_cmd_end(umodem_at_cmd_t *cmd);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,182 +4,420 @@
 #include "umodem_core.h"
 #include "umodem_config.h"
 #include "umodem_buffer.h"
+#include "umodem_cmux.h"
+#include "umodem_metrics.h"
+#include "umodem_trace.h"
+
+#if UMODEM_RX_BUF_SIZE & (UMODEM_RX_BUF_SIZE - 1)
+#error "UMODEM_RX_BUF_SIZE must be a power of two"
+#endif
+
+#if UMODEM_RX_BUF_SIZE > 0
+static uint8_t builtin_storage[UMODEM_RX_BUF_SIZE];
+#else
+#define builtin_storage NULL
+#endif
+
+// Storage of the default ring, replaced by umodem_buffer_set_storage()
+static uint8_t *ring_storage = builtin_storage;
+static size_t ring_storage_size = UMODEM_RX_BUF_SIZE;
+
+static umodem_ring_t ring = {
+    .buf = builtin_storage,
+    .size = UMODEM_RX_BUF_SIZE,
+    .mask = UMODEM_RX_BUF_SIZE - 1,
+};
+
+void umodem_ring_init(umodem_ring_t *r, uint8_t *storage, size_t size, size_t *urc_scan_offset)
+{
+  // Positions wrap with a mask, keep the largest power of two that fits
+  while (size & (size - 1))
+    size &= size - 1;
+
+  r->buf = storage;
+  r->size = size;
+  r->mask = size - 1;
+  r->head = 0;
+  r->tail = 0;
+  r->count = 0;
+  if (r->buf)
+    memset(r->buf, 0, r->size);
+  r->urc_scan_offset = urc_scan_offset;
+  if (r->urc_scan_offset)
+    *r->urc_scan_offset = 0;
+
+  r->policy = UMODEM_RX_OVERFLOW_POLICY;
+  r->high_watermark = 0;
+  r->low_watermark = 0;
+  r->watermark_cb = NULL;
+  r->watermark_ctx = NULL;
+  r->above_watermark = 0;
+  memset(&r->stats, 0, sizeof(r->stats));
+}
 
-typedef struct
+umodem_result_t umodem_buffer_set_storage(uint8_t *storage, size_t size)
 {
-  uint8_t buf[UMODEM_RX_BUF_SIZE];
-  size_t head;
-  size_t tail;
-  size_t count;
-  size_t *urc_scan_offset;
-} ring_buffer_t;
+  if (!storage)
+  {
+    ring_storage = builtin_storage;
+    ring_storage_size = UMODEM_RX_BUF_SIZE;
+    return UMODEM_OK;
+  }
+  // A ring of one byte or none cannot hold a line
+  if (size < 2)
+    return UMODEM_PARAM;
 
-static ring_buffer_t ring;
+  ring_storage = storage;
+  ring_storage_size = size;
+  return UMODEM_OK;
+}
 
 void umodem_buffer_init(size_t *urc_scan_offset)
 {
-  ring.head = 0;
-  ring.tail = 0;
-  ring.count = 0;
-  memset(ring.buf, 0, sizeof(ring.buf));
-  ring.urc_scan_offset = urc_scan_offset;
-  *ring.urc_scan_offset = 0;
+  umodem_ring_init(&ring, ring_storage, ring_storage_size, urc_scan_offset);
 }
 
-size_t umodem_buffer_push(const uint8_t *data, size_t len)
+umodem_ring_t *umodem_buffer_ring(void)
 {
-  if (data == NULL)
-    return 0;
+  return &ring;
+}
 
-  size_t free_space;
-  size_t used;
+void umodem_ring_set_overflow_policy(umodem_ring_t *r, umodem_overflow_policy_t policy)
+{
+  r->policy = policy;
+}
 
-  if (ring.head >= ring.tail)
-    used = ring.head - ring.tail;
-  else
-    used = UMODEM_RX_BUF_SIZE - (ring.tail - ring.head);
+void umodem_ring_set_watermarks(umodem_ring_t *r, size_t high, size_t low, umodem_ring_watermark_cb_t cb, void *ctx)
+{
+  r->high_watermark = cb ? high : 0;
+  r->low_watermark = low < high ? low : 0;
+  r->watermark_cb = high ? cb : NULL;
+  r->watermark_ctx = ctx;
+  r->above_watermark = 0;
+}
 
-  free_space = UMODEM_RX_BUF_SIZE - 1 - used; // -1 to distinguish full vs empty
+void umodem_ring_get_stats(const umodem_ring_t *r, umodem_ring_stats_t *stats)
+{
+  if (stats)
+    *stats = r->stats;
+}
 
-  // If incoming data is larger than free space → drop oldest
-  if (len > free_space)
+void umodem_ring_reset_stats(umodem_ring_t *r)
+{
+  memset(&r->stats, 0, sizeof(r->stats));
+  r->stats.peak = r->count;
+}
+
+static void raise_watermark(umodem_ring_t *r)
+{
+  if (r->watermark_cb && !r->above_watermark)
+  {
+    r->above_watermark = 1;
+    r->watermark_cb(r, 1, r->watermark_ctx);
+  }
+}
+
+// Raise or release the watermark callback after the fill level changed
+static void update_watermark(umodem_ring_t *r)
+{
+  if (!r->watermark_cb)
+    return;
+
+  if (!r->above_watermark && r->count >= r->high_watermark)
+  {
+    raise_watermark(r);
+  }
+  else if (r->above_watermark && r->count <= r->low_watermark)
   {
-    size_t drop = len - free_space;
-    ring.tail = (ring.tail + drop) % UMODEM_RX_BUF_SIZE;
-    ring.count -= drop; // because we're about to add 'len', but net change is len - drop
+    r->above_watermark = 0;
+    r->watermark_cb(r, 0, r->watermark_ctx);
+  }
+}
+
+static void count_dropped(umodem_ring_t *r, size_t drop)
+{
+  UMODEM_METRICS_RING_DROP(drop);
+  r->stats.dropped += (uint32_t)drop;
+}
+
+static void drop_oldest(umodem_ring_t *r, size_t drop)
+{
+  count_dropped(r, drop);
+  r->tail = (r->tail + drop) & r->mask;
+  r->count -= drop;
 
-    // Also adjust urc_scan_offset
-    if (ring.urc_scan_offset)
+  // Also adjust urc_scan_offset
+  if (r->urc_scan_offset)
+  {
+    if (*r->urc_scan_offset > drop)
+      *r->urc_scan_offset -= drop;
+    else
+      *r->urc_scan_offset = 0;
+  }
+}
+
+size_t umodem_ring_push(umodem_ring_t *r, const uint8_t *data, size_t len)
+{
+  if (data == NULL)
+    return 0;
+
+  size_t free_space = r->size - 1 - r->count; // -1 to distinguish full vs empty
+
+  if (len > free_space)
+  {
+    r->stats.overflows++;
+    switch (r->policy)
     {
-      if (*ring.urc_scan_offset > drop)
-        *ring.urc_scan_offset -= drop;
-      else
-        *ring.urc_scan_offset = 0;
+    case UMODEM_OVERFLOW_DROP_NEWEST:
+      count_dropped(r, len - free_space);
+      len = free_space;
+      break;
+
+    case UMODEM_OVERFLOW_BACKPRESSURE:
+      raise_watermark(r);
+      // fall through
+    case UMODEM_OVERFLOW_REJECT:
+      r->stats.rejected += (uint32_t)(len - free_space);
+      len = free_space;
+      break;
+
+    default:
+      // Only the newest bytes of an oversized chunk can be kept
+      if (len > r->size - 1)
+      {
+        count_dropped(r, len - (r->size - 1));
+        data += len - (r->size - 1);
+        len = r->size - 1;
+      }
+      drop_oldest(r, len - free_space);
+      break;
     }
   }
 
   // How much space remains until buffer end
-  size_t space_end = UMODEM_RX_BUF_SIZE - ring.head;
+  size_t space_end = r->size - r->head;
 
   if (len <= space_end)
   {
     // Single memcpy
-    memcpy(&ring.buf[ring.head], data, len);
-    ring.head = (ring.head + len) % UMODEM_RX_BUF_SIZE;
+    memcpy(&r->buf[r->head], data, len);
+    r->head = (r->head + len) & r->mask;
   }
   else
   {
     // Wrap around: two memcpy
-    memcpy(&ring.buf[ring.head], data, space_end);
-    memcpy(&ring.buf[0], data + space_end, len - space_end);
-    ring.head = (len - space_end);
+    memcpy(&r->buf[r->head], data, space_end);
+    memcpy(&r->buf[0], data + space_end, len - space_end);
+    r->head = (len - space_end);
   }
 
-  ring.count += len;
+  r->count += len;
+  if (r->count > r->stats.peak)
+    r->stats.peak = r->count;
+  UMODEM_METRICS_RX(len);
+  update_watermark(r);
   return len;
 }
 
-int umodem_buffer_pop(uint8_t *dst, size_t len)
+size_t umodem_buffer_push(const uint8_t *data, size_t len)
 {
-  if (ring.count < len)
-    return -1;
+  if (data == NULL)
+    return 0;
 
-  if (ring.tail + len > UMODEM_RX_BUF_SIZE)
-  {
-    size_t first_part = UMODEM_RX_BUF_SIZE - ring.tail;
-    size_t second_part = len - first_part;
-    if (dst)
-    {
-      memcpy(dst, &ring.buf[ring.tail], first_part);
-      memcpy(dst + first_part, ring.buf, second_part);
-    }
-    ring.tail = second_part;
-  }
-  else
+  UMODEM_TRACE_RX(data, len);
+
+#if UMODEM_CMUX_ENABLE
+  if (umodem_cmux_active())
+    return umodem_cmux_input(data, len);
+#endif
+
+  return umodem_ring_push(&ring, data, len);
+}
+
+uint8_t *umodem_buffer_get_storage(size_t *capacity)
+{
+  if (capacity)
+    *capacity = ring.size;
+  return ring.buf;
+}
+
+size_t umodem_buffer_commit(size_t len)
+{
+  if (len == 0 || len >= ring.size)
+    return 0;
+
+#if UMODEM_TRACE_ENABLE
+  // The chunk may wrap around the end of the storage
+  size_t first = ring.size - ring.head;
+  if (first > len)
+    first = len;
+  umodem_trace_record_rx(&ring.buf[ring.head], first);
+  if (len > first)
+    umodem_trace_record_rx(ring.buf, len - first);
+#endif
+
+  // The external writer overran unread bytes → drop oldest
+  if (ring.count + len > ring.size - 1)
   {
-    if (dst)
-      memcpy(dst, &ring.buf[ring.tail], len);
-    ring.tail = (ring.tail + len == UMODEM_RX_BUF_SIZE) ? 0 : ring.tail + len;
+    ring.stats.overflows++;
+    drop_oldest(&ring, ring.count + len - (ring.size - 1));
   }
 
-  ring.count -= len;
+  ring.head = (ring.head + len) & ring.mask;
+  ring.count += len;
+  if (ring.count > ring.stats.peak)
+    ring.stats.peak = ring.count;
+  UMODEM_METRICS_RX(len);
+  update_watermark(&ring);
+  return len;
+}
+
+size_t umodem_ring_pop(umodem_ring_t *r, uint8_t *dst, size_t len)
+{
+  if (r->count < len)
+    return 0;
 
-  if (ring.urc_scan_offset)
+  if (dst)
+    umodem_ring_peek_from(r, dst, 0, len);
+  r->tail = (r->tail + len) & r->mask;
+  r->count -= len;
+
+  if (r->urc_scan_offset)
   {
-    if (*ring.urc_scan_offset > len)
-      *ring.urc_scan_offset -= len;
+    if (*r->urc_scan_offset > len)
+      *r->urc_scan_offset -= len;
     else
-      *ring.urc_scan_offset = 0;
+      *r->urc_scan_offset = 0;
   }
 
+  update_watermark(r);
   return len;
 }
 
-int umodem_buffer_peek_from(uint8_t *dst, size_t offset, size_t len)
+size_t umodem_buffer_pop(uint8_t *dst, size_t len)
+{
+  return umodem_ring_pop(&ring, dst, len);
+}
+
+size_t umodem_ring_peek_from(const umodem_ring_t *r, uint8_t *dst, size_t offset, size_t len)
 {
   if (dst == NULL || len == 0)
-    return -1;
+    return 0;
 
-  if (offset + len > ring.count)
-    return -1;
+  if (offset > r->count || len > r->count - offset)
+    return 0;
 
-  size_t read_pos = (ring.tail + offset) % UMODEM_RX_BUF_SIZE;
+  size_t read_pos = (r->tail + offset) & r->mask;
 
-  if (read_pos + len <= UMODEM_RX_BUF_SIZE)
+  if (read_pos + len <= r->size)
   {
-    memcpy(dst, &ring.buf[read_pos], len);
+    memcpy(dst, &r->buf[read_pos], len);
   }
   else
   {
-    size_t first_part = UMODEM_RX_BUF_SIZE - read_pos;
+    size_t first_part = r->size - read_pos;
     size_t second_part = len - first_part;
-    memcpy(dst, &ring.buf[read_pos], first_part);
-    memcpy(dst + first_part, ring.buf, second_part);
+    memcpy(dst, &r->buf[read_pos], first_part);
+    memcpy(dst + first_part, r->buf, second_part);
   }
 
-  return (int)len;
+  return len;
 }
 
-int umodem_buffer_peek(uint8_t *dst, size_t len)
+size_t umodem_buffer_peek_from(uint8_t *dst, size_t offset, size_t len)
 {
-  return umodem_buffer_peek_from(dst, 0, len);
+  return umodem_ring_peek_from(&ring, dst, offset, len);
 }
 
-int umodem_buffer_find(uint8_t *expect, size_t len)
+size_t umodem_buffer_peek(uint8_t *dst, size_t len)
 {
-  if (expect == NULL || len == 0 || ring.count < len)
-    return -1;
+  return umodem_ring_peek_from(&ring, dst, 0, len);
+}
 
-  uint8_t linear_buf[ring.count];
-  if (umodem_buffer_peek_from(linear_buf, 0, ring.count) != (int)ring.count)
-    return -1;
+// Compare the pattern against the ring at a logical offset, across the wrap
+static int ring_match(const umodem_ring_t *r, size_t offset, const uint8_t *pattern, size_t pattern_len)
+{
+  size_t pos = (r->tail + offset) & r->mask;
+  size_t first_part = r->size - pos;
+  if (first_part > pattern_len)
+    first_part = pattern_len;
 
-  uint8_t *found = UMODEM_MEMMEM(linear_buf, ring.count, expect, len);
-  return found ? (int)(found - linear_buf) : -1;
+  return memcmp(&r->buf[pos], pattern, first_part) == 0 &&
+         memcmp(r->buf, pattern + first_part, pattern_len - first_part) == 0;
 }
 
-int umodem_buffer_find_from(const uint8_t *pattern, size_t pattern_len, size_t start_offset)
+size_t umodem_ring_find_from(const umodem_ring_t *r, const uint8_t *pattern, size_t pattern_len, size_t start_offset)
 {
   if (pattern == NULL || pattern_len == 0)
-    return -1;
+    return UMODEM_RING_NPOS;
+
+  if (start_offset >= r->count || r->count - start_offset < pattern_len)
+    return UMODEM_RING_NPOS;
 
-  if (start_offset >= ring.count)
-    return -1;
+  // Look for the first byte in place, one contiguous run at a time
+  size_t last = r->count - pattern_len;
+  size_t offset = start_offset;
+  while (offset <= last)
+  {
+    size_t pos = (r->tail + offset) & r->mask;
+    size_t run = r->size - pos;
+    if (run > last - offset + 1)
+      run = last - offset + 1;
+
+    const uint8_t *hit = (const uint8_t *)memchr(&r->buf[pos], pattern[0], run);
+    if (!hit)
+    {
+      offset += run;
+      continue;
+    }
 
-  size_t search_len = ring.count - start_offset;
-  if (search_len < pattern_len)
-    return -1;
+    offset += (size_t)(hit - &r->buf[pos]);
+    if (ring_match(r, offset, pattern, pattern_len))
+      return offset;
+    offset++;
+  }
 
-  uint8_t linear_buf[search_len];
+  return UMODEM_RING_NPOS;
+}
 
-  if (umodem_buffer_peek_from(linear_buf, start_offset, search_len) != (int)search_len)
-    return -1;
+size_t umodem_buffer_find(const uint8_t *expect, size_t len)
+{
+  return umodem_ring_find_from(&ring, expect, len, 0);
+}
 
-  uint8_t *found = UMODEM_MEMMEM(linear_buf, search_len, pattern, pattern_len);
-  return found ? (int)(found - linear_buf) + (int)start_offset : -1;
+size_t umodem_buffer_find_from(const uint8_t *pattern, size_t pattern_len, size_t start_offset)
+{
+  return umodem_ring_find_from(&ring, pattern, pattern_len, start_offset);
+}
+
+// The head stays put: an external writer keeps filling the storage at its
+// own index, see umodem_buffer_get_storage()
+void umodem_ring_flush(umodem_ring_t *r)
+{
+  r->tail = r->head;
+  r->count = 0;
+  if (r->urc_scan_offset)
+    *r->urc_scan_offset = 0;
+  update_watermark(r);
+}
+
+void umodem_buffer_flush(void)
+{
+  umodem_ring_flush(&ring);
+}
+
+void umodem_buffer_rewind(void)
+{
+  ring.head = 0;
+  umodem_ring_flush(&ring);
+}
+
+size_t umodem_ring_get_count(const umodem_ring_t *r)
+{
+  return r->count;
 }
 
 size_t umodem_buffer_get_count(void)
 {
   return ring.count;
-}
\ No newline at end of file
+}
@@ -4,11 +4,156 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "umodem_core.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+  /**
+   * What a ring does with a chunk that does not fit.
+   *
+   * The REJECT policies suit writers that can hold on to the rest, such as a
+   * HAL pushing from its own buffer: it pushes the remainder again once the
+   * parser has made room. Rings fed by the CMUX decoder lose it.
+   */
+  typedef enum
+  {
+    UMODEM_OVERFLOW_DROP_OLDEST = 0, // Discard the oldest bytes
+    UMODEM_OVERFLOW_DROP_NEWEST,     // Discard the rest of the chunk
+    UMODEM_OVERFLOW_REJECT,          // Store what fits, return that count
+    UMODEM_OVERFLOW_BACKPRESSURE,    // REJECT and raise the watermark
+  } umodem_overflow_policy_t;
+
+  /**
+   * Overflow counters of a ring, see umodem_ring_get_stats().
+   */
+  typedef struct
+  {
+    uint32_t overflows; // Pushes that did not fit
+    uint32_t dropped;   // Bytes discarded (DROP policies, DMA overruns)
+    uint32_t rejected;  // Bytes handed back to the writer
+    size_t peak;        // Highest fill level seen
+  } umodem_ring_stats_t;
+
+  /** Returned by the find functions when the pattern is not there. */
+#define UMODEM_RING_NPOS ((size_t)-1)
+
+  struct umodem_ring;
+
+  /**
+   * Called when the fill level of a ring reaches the high watermark (above
+   * = 1) and again when it has fallen to the low watermark (above = 0).
+   *
+   * Runs with the HAL lock held: from the writer on the way up, from the
+   * parser on the way down. Meant to deassert RTS or pause a DMA channel,
+   * not to touch the ring.
+   */
+  typedef void (*umodem_ring_watermark_cb_t)(struct umodem_ring *ring, int above, void *ctx);
+
+  /**
+   * Ring buffer instance.
+   *
+   * The umodem_buffer_* functions work on the default instance, which holds
+   * the modem's RX stream. Additional instances hold the streams of other
+   * channels, e.g. the data DLC of umodem_cmux.h. Fields are private, use
+   * the umodem_ring_* functions.
+   */
+  typedef struct umodem_ring
+  {
+    uint8_t *buf;
+    size_t size;
+    size_t mask;
+    size_t head;
+    size_t tail;
+    size_t count;
+    size_t *urc_scan_offset;
+    umodem_overflow_policy_t policy;
+    size_t high_watermark;
+    size_t low_watermark;
+    umodem_ring_watermark_cb_t watermark_cb;
+    void *watermark_ctx;
+    int above_watermark;
+    umodem_ring_stats_t stats;
+  } umodem_ring_t;
+
+  /**
+   * Initialize a ring over caller provided storage.
+   *
+   * @param storage Backing storage, holds at most size - 1 bytes.
+   * @param size Storage size in bytes. Positions wrap with a mask, so only
+   *             the largest power of two not above size is used.
+   * @param urc_scan_offset Optional, updated when data is popped or dropped
+   *                        (see umodem_buffer_init()).
+   *
+   * The overflow policy is reset to UMODEM_RX_OVERFLOW_POLICY, watermarks
+   * are cleared and the counters zeroed.
+   */
+  void umodem_ring_init(umodem_ring_t *ring, uint8_t *storage, size_t size, size_t *urc_scan_offset);
+
+  /**
+   * Select what happens to a chunk that does not fit.
+   */
+  void umodem_ring_set_overflow_policy(umodem_ring_t *ring, umodem_overflow_policy_t policy);
+
+  /**
+   * Install a watermark callback.
+   *
+   * @param high Fill level that raises the callback, 0 to remove it.
+   * @param low Fill level at or below which it is released, below high.
+   */
+  void umodem_ring_set_watermarks(umodem_ring_t *ring, size_t high, size_t low, umodem_ring_watermark_cb_t cb, void *ctx);
+
+  /** Copy the overflow counters of a ring. */
+  void umodem_ring_get_stats(const umodem_ring_t *ring, umodem_ring_stats_t *stats);
+
+  /** Zero the overflow counters of a ring. */
+  void umodem_ring_reset_stats(umodem_ring_t *ring);
+
+  /**
+   * Append data to a ring. A chunk that does not fit is handled according
+   * to the ring's overflow policy.
+   *
+   * @return Number of bytes stored, less than len if the policy rejected
+   *         or dropped part of the chunk.
+   */
+  size_t umodem_ring_push(umodem_ring_t *ring, const uint8_t *data, size_t len);
+
+  /** Same as umodem_buffer_pop() on a given ring. */
+  size_t umodem_ring_pop(umodem_ring_t *ring, uint8_t *dst, size_t len);
+
+  /** Same as umodem_buffer_peek_from() on a given ring. */
+  size_t umodem_ring_peek_from(const umodem_ring_t *ring, uint8_t *dst, size_t offset, size_t len);
+
+  /** Same as umodem_buffer_find_from() on a given ring. */
+  size_t umodem_ring_find_from(const umodem_ring_t *ring, const uint8_t *pattern, size_t pattern_len, size_t start_offset);
+
+  /** Same as umodem_buffer_flush() on a given ring. */
+  void umodem_ring_flush(umodem_ring_t *ring);
+
+  /** Same as umodem_buffer_get_count() on a given ring. */
+  size_t umodem_ring_get_count(const umodem_ring_t *ring);
+
+  /**
+   * Get the default ring, the one behind the umodem_buffer_* functions.
+   */
+  umodem_ring_t *umodem_buffer_ring(void);
+
+  /**
+   * Back the default ring with caller provided storage instead of the
+   * static UMODEM_RX_BUF_SIZE array, e.g. a buffer sized at runtime or
+   * placed in external RAM. Call before umodem_init(), the storage must
+   * outlive the session.
+   *
+   * @param storage Backing storage, NULL to go back to the static array.
+   * @param size Storage size in bytes, see umodem_ring_init(). Ignored
+   *             with NULL storage.
+   * @return UMODEM_OK, or UMODEM_PARAM if the storage holds less than two
+   *         bytes and was not taken.
+   */
+  umodem_result_t umodem_buffer_set_storage(uint8_t *storage, size_t size);
+
   /**
    * Initialize the internal ring buffer.
    * Must be called once before use.
@@ -22,35 +167,79 @@ extern "C"
   /**
    * Push data INTO the buffer (called by HAL on RX).
    *
-   * @return Number of bytes actually stored.
+   * While a CMUX session is open (umodem_cmux.h) the data is a framed
+   * stream: it is decoded and each channel's payload goes to its own ring.
+   *
+   * @return Number of bytes actually stored. With the REJECT and
+   *         BACKPRESSURE policies the caller keeps the rest and pushes it
+   *         again later.
    */
   size_t umodem_buffer_push(const uint8_t *data, size_t len);
 
+  /**
+   * Get the backing storage of the buffer for an external writer,
+   * e.g. a UART DMA channel in circular mode.
+   *
+   * The writer must fill the storage circularly starting at index 0 right
+   * after umodem_buffer_init() or umodem_buffer_rewind(), and report every
+   * new chunk with umodem_buffer_commit(). Not usable together with CMUX,
+   * whose frames must be decoded before they reach a ring.
+   *
+   * @param capacity Set to the storage size in bytes.
+   * @return Pointer to the storage, NULL if there is none (see
+   *         umodem_buffer_set_storage()).
+   */
+  uint8_t *umodem_buffer_get_storage(size_t *capacity);
+
+  /**
+   * Commit bytes written directly into the storage at the current head.
+   * If the writer overran unread data, the oldest bytes are dropped
+   * whatever the policy: they are already overwritten. Use a watermark
+   * callback to pause the writer in time.
+   *
+   * Ring updates are not atomic against the reader: call this from task context with the HAL lock held, e.g. from
+   * umodem_hal_read(), never from the DMA interrupt. The interrupt should
+   * only wake umodem_hal_wait_rx(); the writer keeps running meanwhile,
+   * so the storage absorbs what arrives until the next commit.
+   *
+   * @param len Number of bytes written since the last commit
+   *            (must be smaller than the capacity).
+   * @return Number of bytes committed.
+   */
+  size_t umodem_buffer_commit(size_t len);
+
   /**
    * Pop data FROM the buffer.
-   * @return Number of bytes actually read or -1 if failed.
+   * @return len, or 0 if fewer than len bytes are buffered.
    */
-  int umodem_buffer_pop(uint8_t *dst, size_t len);
+  size_t umodem_buffer_pop(uint8_t *dst, size_t len);
 
   /**
    * Peek data FROM the buffer.
    *
-   * @return Number of bytes actually read or -1 if failed.
+   * @return len, or 0 if fewer than len bytes are buffered.
    */
-  int umodem_buffer_peek(uint8_t *dst, size_t len);
+  size_t umodem_buffer_peek(uint8_t *dst, size_t len);
 
   /**
    * Find matching bytes in the buffer
    *
-   * @return -1 if not found or position in the buffer.
+   * @return UMODEM_RING_NPOS if not found or position in the buffer.
    */
-  int umodem_buffer_find(uint8_t *expect, size_t len);
+  size_t umodem_buffer_find(const uint8_t *expect, size_t len);
 
   /**
-   * Discard all data in the buffer.
+   * Discard all data in the buffer. The write position is kept, so an
+   * external writer carries on where it is.
    */
   void umodem_buffer_flush(void);
 
+  /**
+   * Discard all data and move the write position back to the start of the
+   * storage, for an external writer that restarted there.
+   */
+  void umodem_buffer_rewind(void);
+
   /**
    * Find matching bytes in the buffer starting from a given offset.
    *
@@ -58,17 +247,18 @@ extern "C"
    * @param pattern_len Length of pattern
    * @param start_offset Logical offset in buffer to start searching from (0 = oldest byte)
    *
-   * @return -1 if not found, or logical position in buffer (same as find())
+   * @return UMODEM_RING_NPOS if not found, or logical position in buffer
+   *         (same as find())
    */
-  int umodem_buffer_find_from(const uint8_t *pattern, size_t pattern_len, size_t start_offset);
+  size_t umodem_buffer_find_from(const uint8_t *pattern, size_t pattern_len, size_t start_offset);
 
   /**
    * Peek 'len' bytes from the buffer starting at logical 'offset'.
    * offset=0 means the oldest byte (ring.tail).
    * 
-   * @return number of bytes read, or -1 on error.
+   * @return number of bytes read, or 0 on error.
    */
-  int umodem_buffer_peek_from(uint8_t *dst, size_t offset, size_t len);
+  size_t umodem_buffer_peek_from(uint8_t *dst, size_t offset, size_t len);
 
   /** 
    * Get current number of bytes stored in the buffer.
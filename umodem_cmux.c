@@ -0,0 +1,416 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "umodem_cmux.h"
+
+#if UMODEM_CMUX_ENABLE
+
+#include "umodem_at.h"
+#include "umodem_metrics.h"
+#include "umodem_trace.h"
+
+#include "port/umodem_port.h"
+
+#if UMODEM_CMUX_N1 < 16 || UMODEM_CMUX_N1 > 32768
+#error "UMODEM_CMUX_N1 must be between 16 and 32768"
+#endif
+
+#if UMODEM_CMUX_DATA_BUF_SIZE & (UMODEM_CMUX_DATA_BUF_SIZE - 1)
+#error "UMODEM_CMUX_DATA_BUF_SIZE must be a power of two"
+#endif
+
+#define CMUX_FLAG 0xF9
+#define CMUX_EA 0x01
+#define CMUX_CR 0x02
+#define CMUX_PF 0x10
+
+// Frame types, P/F bit cleared
+#define CMUX_SABM 0x2F
+#define CMUX_UA 0x63
+#define CMUX_DM 0x0F
+#define CMUX_DISC 0x43
+#define CMUX_UIH 0xEF
+
+// DLC 0 message types, EA bit set and C/R bit cleared
+#define CMUX_MSG_NSC 0x11
+#define CMUX_MSG_CLD 0xC1
+#define CMUX_MSG_MSC 0xE1
+
+// V.24 signals sent with MSC: DV | RTR | RTC
+#define CMUX_MSC_SIGNALS 0x8D
+
+#define CMUX_FCS_INIT 0xFF
+#define CMUX_FCS_GOOD 0xCF
+#define CMUX_RETRIES 3
+#define CMUX_DLC_COUNT 3
+
+// Flag, address, control, two length octets / FCS, flag
+#define CMUX_FRAME_OVERHEAD 6
+
+enum { DLC_CLOSED, DLC_OPENING, DLC_OPEN, DLC_CLOSING };
+
+typedef enum {
+  RX_HUNT,
+  RX_ADDR,
+  RX_CTRL,
+  RX_LEN,
+  RX_LEN2,
+  RX_INFO,
+  RX_FCS,
+  RX_END,
+} cmux_rx_state_t;
+
+static volatile int cmux_active = 0;
+static volatile uint8_t dlc_state[CMUX_DLC_COUNT];
+static volatile uint8_t cld_pending = 0;
+
+static uint8_t fcs_table[256];
+
+// Frame decoder, only touched under the HAL lock
+static struct {
+  cmux_rx_state_t state;
+  uint8_t addr;
+  uint8_t ctrl;
+  uint8_t fcs;
+  size_t len;
+  size_t pos;
+  uint8_t info[UMODEM_CMUX_N1];
+} rx;
+
+// Reply owed to a command from the modem, sent by umodem_cmux_poll()
+static struct {
+  int pending;
+  int close_session;
+  uint8_t dlci;
+  uint8_t ctrl;
+  uint8_t info[8];
+  size_t len;
+} reply;
+
+static uint8_t data_storage[UMODEM_CMUX_DATA_BUF_SIZE];
+static umodem_ring_t data_ring;
+static size_t data_scan_offset = 0;
+
+// CRC-8, reversed polynomial x^8 + x^2 + x + 1 (07.10 clause 5.2.1.6)
+static void fcs_init(void) {
+  for (unsigned i = 0; i < 256; i++) {
+    uint8_t crc = (uint8_t)i;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (uint8_t)((crc >> 1) ^ 0xE0) : (uint8_t)(crc >> 1);
+    fcs_table[i] = crc;
+  }
+}
+
+static uint8_t fcs_update(uint8_t fcs, const uint8_t* data, size_t len) {
+  while (len--) fcs = fcs_table[fcs ^ *data++];
+  return fcs;
+}
+
+static int send_frame(uint8_t dlci, uint8_t ctrl, uint8_t cr,
+    const uint8_t* info, size_t len) {
+  uint8_t frame[UMODEM_CMUX_N1 + CMUX_FRAME_OVERHEAD];
+  size_t pos = 0;
+
+  frame[pos++] = CMUX_FLAG;
+  frame[pos++] = (uint8_t)(dlci << 2) | cr | CMUX_EA;
+  frame[pos++] = ctrl;
+  if (len <= 127) {
+    frame[pos++] = (uint8_t)(len << 1) | CMUX_EA;
+  } else {
+    frame[pos++] = (uint8_t)(len << 1);
+    frame[pos++] = (uint8_t)(len >> 7);
+  }
+
+  // UIH frames only protect the header
+  uint8_t fcs = fcs_update(CMUX_FCS_INIT, &frame[1], pos - 1);
+  if (len > 0) memcpy(&frame[pos], info, len);
+  if ((ctrl & ~CMUX_PF) != CMUX_UIH) fcs = fcs_update(fcs, info, len);
+  pos += len;
+
+  frame[pos++] = (uint8_t)(0xFF - fcs);
+  frame[pos++] = CMUX_FLAG;
+
+  int written = umodem_hal_send(frame, pos);
+  if (written > 0) {
+    UMODEM_METRICS_TX((size_t)written);
+    UMODEM_TRACE_TX(frame, (size_t)written);
+  }
+  return written == (int)pos ? 0 : -1;
+}
+
+static void queue_reply(
+    uint8_t dlci, uint8_t ctrl, const uint8_t* info, size_t len) {
+  if (len > sizeof(reply.info)) return;
+  reply.dlci = dlci;
+  reply.ctrl = ctrl;
+  if (len > 0) memcpy(reply.info, info, len);
+  reply.len = len;
+  reply.pending = 1;
+}
+
+static void rx_control_message(void) {
+  if (rx.len < 2) return;
+  uint8_t type = rx.info[0];
+
+  if (!(type & CMUX_CR)) {
+    // Response to one of our commands
+    if ((type & ~CMUX_CR) == CMUX_MSG_CLD) cld_pending = 0;
+    return;
+  }
+
+  // Command from the modem: echo MSC back as the response, refuse the rest
+  if ((type & ~CMUX_CR) == CMUX_MSG_MSC) {
+    queue_reply(0, CMUX_UIH, rx.info, rx.len);
+    reply.info[0] &= (uint8_t)~CMUX_CR;
+  } else {
+    uint8_t nsc[3] = {CMUX_MSG_NSC, (1 << 1) | CMUX_EA, type};
+    queue_reply(0, CMUX_UIH, nsc, sizeof(nsc));
+  }
+}
+
+static void rx_frame(void) {
+  uint8_t dlci = rx.addr >> 2;
+
+  switch (rx.ctrl & ~CMUX_PF) {
+  case CMUX_UA:
+    if (dlci >= CMUX_DLC_COUNT) break;
+    if (dlc_state[dlci] == DLC_OPENING)
+      dlc_state[dlci] = DLC_OPEN;
+    else if (dlc_state[dlci] == DLC_CLOSING)
+      dlc_state[dlci] = DLC_CLOSED;
+    break;
+
+  case CMUX_DM:
+    if (dlci < CMUX_DLC_COUNT) dlc_state[dlci] = DLC_CLOSED;
+    break;
+
+  case CMUX_DISC:
+    if (dlci < CMUX_DLC_COUNT) dlc_state[dlci] = DLC_CLOSED;
+    queue_reply(dlci, CMUX_UA | CMUX_PF, NULL, 0);
+    if (dlci == 0) reply.close_session = 1;
+    break;
+
+  case CMUX_UIH:
+    if (dlci == 0)
+      rx_control_message();
+    else if (dlci == UMODEM_CMUX_DLC_CONTROL)
+      umodem_ring_push(umodem_buffer_ring(), rx.info, rx.len);
+    else if (dlci == UMODEM_CMUX_DLC_DATA)
+      umodem_ring_push(&data_ring, rx.info, rx.len);
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void rx_byte(uint8_t b) {
+  switch (rx.state) {
+  case RX_HUNT:
+    if (b == CMUX_FLAG) rx.state = RX_ADDR;
+    break;
+
+  case RX_ADDR:
+    if (b == CMUX_FLAG) break; // Closing flag of the previous frame
+    if (!(b & CMUX_EA)) {
+      rx.state = RX_HUNT;
+      break;
+    }
+    rx.addr = b;
+    rx.fcs = fcs_update(CMUX_FCS_INIT, &b, 1);
+    rx.state = RX_CTRL;
+    break;
+
+  case RX_CTRL:
+    rx.ctrl = b;
+    rx.fcs = fcs_update(rx.fcs, &b, 1);
+    rx.state = RX_LEN;
+    break;
+
+  case RX_LEN:
+  case RX_LEN2:
+    rx.fcs = fcs_update(rx.fcs, &b, 1);
+    if (rx.state == RX_LEN) {
+      rx.len = b >> 1;
+      if (!(b & CMUX_EA)) {
+        rx.state = RX_LEN2;
+        break;
+      }
+    } else {
+      rx.len |= (size_t)b << 7;
+    }
+    rx.pos = 0;
+    if (rx.len > UMODEM_CMUX_N1)
+      rx.state = RX_HUNT;
+    else
+      rx.state = rx.len > 0 ? RX_INFO : RX_FCS;
+    break;
+
+  case RX_INFO:
+    rx.info[rx.pos++] = b;
+    if (rx.pos == rx.len) rx.state = RX_FCS;
+    break;
+
+  case RX_FCS:
+    if ((rx.ctrl & ~CMUX_PF) != CMUX_UIH)
+      rx.fcs = fcs_update(rx.fcs, rx.info, rx.len);
+    rx.state = fcs_update(rx.fcs, &b, 1) == CMUX_FCS_GOOD ? RX_END : RX_HUNT;
+    break;
+
+  case RX_END:
+    if (b == CMUX_FLAG) {
+      rx_frame();
+      rx.state = RX_ADDR;
+    } else {
+      rx.state = RX_HUNT;
+    }
+    break;
+  }
+}
+
+size_t umodem_cmux_input(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) rx_byte(data[i]);
+  return len;
+}
+
+int umodem_cmux_write(uint8_t dlci, const uint8_t* data, size_t len) {
+  size_t sent = 0;
+  while (sent < len) {
+    size_t chunk = len - sent;
+    if (chunk > UMODEM_CMUX_N1) chunk = UMODEM_CMUX_N1;
+    if (send_frame(dlci, CMUX_UIH, CMUX_CR, data + sent, chunk) != 0)
+      return -1;
+    sent += chunk;
+  }
+  return (int)sent;
+}
+
+umodem_ring_t* umodem_cmux_data_ring(void) { return &data_ring; }
+
+void umodem_cmux_poll(void) {
+  if (!reply.pending) return;
+
+  umodem_hal_lock();
+  uint8_t info[sizeof(reply.info)];
+  uint8_t dlci = reply.dlci, ctrl = reply.ctrl;
+  size_t len = reply.len;
+  int close_session = reply.close_session;
+  memcpy(info, reply.info, len);
+  reply.pending = 0;
+  reply.close_session = 0;
+  umodem_hal_unlock();
+
+  send_frame(dlci, ctrl, 0, info, len);
+
+  // The modem closed the multiplexer: back to plain AT mode
+  if (close_session) {
+    umodem_hal_lock();
+    cmux_active = 0;
+    umodem_hal_unlock();
+  }
+}
+
+int umodem_cmux_active(void) { return cmux_active; }
+
+// Process input until a state leaves the value it had when the frame was sent
+static void wait_while(volatile uint8_t* state, uint8_t value) {
+  uint32_t start = umodem_hal_millis();
+  while (*state == value &&
+         umodem_hal_millis() - start <= UMODEM_CMUX_ACK_TIMEOUT_MS) {
+    umodem_poll();
+    if (*state == value) umodem_hal_wait_rx(10);
+  }
+}
+
+static umodem_result_t dlc_transition(
+    uint8_t dlci, uint8_t ctrl, uint8_t pending, uint8_t done) {
+  for (int attempt = 0; attempt < CMUX_RETRIES; attempt++) {
+    dlc_state[dlci] = pending;
+    if (send_frame(dlci, ctrl | CMUX_PF, CMUX_CR, NULL, 0) != 0)
+      return UMODEM_ERR;
+
+    wait_while(&dlc_state[dlci], pending);
+    if (dlc_state[dlci] == done) return UMODEM_OK;
+    if (dlc_state[dlci] != pending) return UMODEM_ERR; // Refused with DM
+  }
+
+  dlc_state[dlci] = DLC_CLOSED;
+  return UMODEM_TIMEOUT;
+}
+
+static int send_msc(uint8_t dlci) {
+  uint8_t msc[4] = {CMUX_MSG_MSC | CMUX_CR, (2 << 1) | CMUX_EA,
+      (uint8_t)(dlci << 2) | CMUX_CR | CMUX_EA, CMUX_MSC_SIGNALS};
+  return send_frame(0, CMUX_UIH, CMUX_CR, msc, sizeof(msc));
+}
+
+umodem_result_t umodem_cmux_start(void) {
+  if (cmux_active) return UMODEM_OK;
+  if (umodem_at_busy()) return UMODEM_ERR;
+
+  fcs_init();
+
+  char cmd_buf[32];
+  umodem_at_cmd_t at;
+  umodem_at_cmd_init(&at, cmd_buf, sizeof(cmd_buf));
+  umodem_at_cmd_str(&at, "AT+CMUX=0,0,5,");
+  umodem_at_cmd_int(&at, UMODEM_CMUX_N1);
+  const char* cmd = umodem_at_cmd_cr(&at);
+  if (!cmd || umodem_at_send(cmd, NULL, 0, UMODEM_CMD_TIMEOUT_MS) != UMODEM_OK)
+    return UMODEM_ERR;
+
+  // From here on the modem only speaks in frames
+  umodem_hal_lock();
+  memset(&rx, 0, sizeof(rx));
+  memset(&reply, 0, sizeof(reply));
+  memset((void*)dlc_state, DLC_CLOSED, sizeof(dlc_state));
+  umodem_ring_init(
+      &data_ring, data_storage, sizeof(data_storage), &data_scan_offset);
+  cmux_active = 1;
+  umodem_hal_unlock();
+
+  static const uint8_t dlcs[] = {
+      0, UMODEM_CMUX_DLC_CONTROL, UMODEM_CMUX_DLC_DATA};
+  for (size_t i = 0; i < sizeof(dlcs); i++) {
+    umodem_result_t result =
+        dlc_transition(dlcs[i], CMUX_SABM, DLC_OPENING, DLC_OPEN);
+    if (result == UMODEM_OK && dlcs[i] != 0 && send_msc(dlcs[i]) != 0)
+      result = UMODEM_ERR;
+
+    if (result != UMODEM_OK) {
+      umodem_cmux_stop();
+      return result;
+    }
+  }
+
+  return UMODEM_OK;
+}
+
+umodem_result_t umodem_cmux_stop(void) {
+  if (!cmux_active) return UMODEM_OK;
+
+  static const uint8_t dlcs[] = {UMODEM_CMUX_DLC_DATA, UMODEM_CMUX_DLC_CONTROL};
+  for (size_t i = 0; i < sizeof(dlcs); i++) {
+    if (dlc_state[dlcs[i]] == DLC_OPEN)
+      dlc_transition(dlcs[i], CMUX_DISC, DLC_CLOSING, DLC_CLOSED);
+  }
+
+  // Close down the multiplexer, the modem answers in the old framing
+  umodem_result_t result = UMODEM_OK;
+  uint8_t cld[2] = {CMUX_MSG_CLD | CMUX_CR, CMUX_EA};
+  cld_pending = 1;
+  if (send_frame(0, CMUX_UIH, CMUX_CR, cld, sizeof(cld)) != 0)
+    result = UMODEM_ERR;
+  else
+    wait_while(&cld_pending, 1);
+  if (result == UMODEM_OK && cld_pending) result = UMODEM_TIMEOUT;
+
+  umodem_hal_lock();
+  cmux_active = 0;
+  memset((void*)dlc_state, DLC_CLOSED, sizeof(dlc_state));
+  umodem_ring_flush(&data_ring);
+  umodem_hal_unlock();
+  return result;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef uMODEM_CMUX_H_
+#define uMODEM_CMUX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "umodem_config.h"
+#include "umodem_core.h"
+#include "umodem_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * GSM 07.10 multiplexer (basic option), enabled with UMODEM_CMUX_ENABLE.
+ *
+ * umodem_cmux_start() switches the modem with AT+CMUX=0 and opens two
+ * virtual channels (DLCs) on top of the serial link:
+ *
+ *   DLC 1  control: AT commands, signal queries and URCs, backed by the
+ *          default RX ring (umodem_buffer_*)
+ *   DLC 2  data: socket and MQTT payload transfers, backed by its own ring
+ *
+ * umodem_at_send_on() / umodem_at_write_on() pick the channel; without an
+ * open session both channels map to the plain serial link. Each channel
+ * runs its own AT transaction, so a control command issued from one thread
+ * is answered while another thread waits on a bulk transfer. Each channel
+ * must be driven by one thread at a time, and umodem_hal_sendv() must not
+ * interleave concurrent calls.
+ *
+ * The RX stream must reach the library through umodem_buffer_push(): an
+ * external writer filling the ring storage directly cannot be demultiplexed.
+ */
+
+/** @brief DLC carrying AT control traffic and URCs. */
+#define UMODEM_CMUX_DLC_CONTROL 1
+
+/** @brief DLC carrying bulk data transfers. */
+#define UMODEM_CMUX_DLC_DATA 2
+
+#if UMODEM_CMUX_ENABLE
+
+/**
+   * @brief Switch the modem to multiplexer mode and open the channels.
+   *
+   * Must be called after umodem_init(), while no AT command is in flight.
+   *
+   * @return UMODEM_OK once every DLC is acknowledged; on failure the link is
+   *         back in plain AT mode if the modem never entered multiplexing.
+   */
+umodem_result_t umodem_cmux_start(void);
+
+/**
+   * @brief Close the channels and return the modem to plain AT mode.
+   */
+umodem_result_t umodem_cmux_stop(void);
+
+/**
+   * @brief Check whether a multiplexer session is open.
+   */
+int umodem_cmux_active(void);
+
+/* Library hooks. umodem_cmux_input() runs under the HAL lock, from
+ * umodem_buffer_push(); umodem_cmux_poll() sends replies the modem's
+ * control commands need, from umodem_poll(). */
+size_t umodem_cmux_input(const uint8_t* data, size_t len);
+int umodem_cmux_write(uint8_t dlci, const uint8_t* data, size_t len);
+umodem_ring_t* umodem_cmux_data_ring(void);
+void umodem_cmux_poll(void);
+
+#else
+
+#define umodem_cmux_active() 0
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,16 +22,167 @@
 // #define UMODEM_SIMCOM_SIM800
 #endif
 
-/* Size of the RX ring buffer (bytes). */
+/* Size of the RX ring buffer (bytes), a power of two. 0 leaves out the
+ * static storage: the application then provides it at runtime with
+ * umodem_buffer_set_storage().
+ */
 #ifndef UMODEM_RX_BUF_SIZE
 #define UMODEM_RX_BUF_SIZE 256
 #endif
 
+/* Bytes umodem_poll() reads from the HAL at once. */
+#ifndef UMODEM_RX_READ_SIZE
+#if UMODEM_RX_BUF_SIZE == 0
+#define UMODEM_RX_READ_SIZE 256
+#elif UMODEM_RX_BUF_SIZE > 4096
+#define UMODEM_RX_READ_SIZE 4096
+#else
+#define UMODEM_RX_READ_SIZE UMODEM_RX_BUF_SIZE
+#endif
+#endif
+
+/* UART rate the HAL opens the port at. umodem_set_baudrate() changes it at
+ * runtime and umodem_deinit() switches the modem back to it.
+ */
+#ifndef UMODEM_BAUDRATE
+#define UMODEM_BAUDRATE 115200
+#endif
+
+/* What the RX rings do with data that does not fit, one of the
+ * umodem_overflow_policy_t values (umodem_buffer.h). Change it at runtime
+ * with umodem_ring_set_overflow_policy().
+ */
+#ifndef UMODEM_RX_OVERFLOW_POLICY
+#define UMODEM_RX_OVERFLOW_POLICY UMODEM_OVERFLOW_DROP_OLDEST
+#endif
+
 /* Default command timeout in milliseconds for synchronous commands */
 #ifndef UMODEM_CMD_TIMEOUT_MS
 #define UMODEM_CMD_TIMEOUT_MS 5000
 #endif
 
+/* Interval in milliseconds at which umodem_poll() refreshes the signal
+ * quality and registration status of umodem_get_status(), using idle AT
+ * slots only. 0 disables the refresh.
+ */
+#ifndef UMODEM_STATUS_REFRESH_MS
+#define UMODEM_STATUS_REFRESH_MS 30000
+#endif
+
+/* Delay in milliseconds umodem_poll() asks for before retrying work it put
+ * off because an AT command was in flight (queued events, the status
+ * refresh, driver timers).
+ */
+#ifndef UMODEM_AT_BUSY_RETRY_MS
+#define UMODEM_AT_BUSY_RETRY_MS 10
+#endif
+
+/* Maximum number of concurrent event subscribers. */
+#ifndef UMODEM_MAX_EVENT_SUBSCRIBERS
+#define UMODEM_MAX_EVENT_SUBSCRIBERS 4
+#endif
+
+/* Number of slots in the URC lookup hash table.
+ * Must be a power of two and larger than the driver's URC table, otherwise
+ * umodem_init() fails with UMODEM_PARAM.
+ */
+#ifndef UMODEM_URC_HASH_SIZE
+#define UMODEM_URC_HASH_SIZE 32
+#endif
+
+/* Runtime metrics (umodem_metrics.h): per-command latency histograms and
+ * byte/drop counters. Set to 1 to enable; when 0 the hooks compile out.
+ */
+#ifndef UMODEM_METRICS_ENABLE
+#define UMODEM_METRICS_ENABLE 0
+#endif
+
+/* Number of distinct AT command prefixes tracked by the metrics. */
+#ifndef UMODEM_METRICS_MAX_COMMANDS
+#define UMODEM_METRICS_MAX_COMMANDS 16
+#endif
+
+/* Longest tracked command prefix, including the terminator. */
+#ifndef UMODEM_METRICS_PREFIX_LEN
+#define UMODEM_METRICS_PREFIX_LEN 16
+#endif
+
+/* Largest latency histogram range, 2^N ms (17 = about 131 s). */
+#ifndef UMODEM_METRICS_HIST_MAX_EXP
+#define UMODEM_METRICS_HIST_MAX_EXP 17
+#endif
+
+/* Binary serial trace (umodem_trace.h). Set to 1 to record every RX chunk
+ * and TX write into an in-memory ring; when 0 the hooks compile out.
+ */
+#ifndef UMODEM_TRACE_ENABLE
+#define UMODEM_TRACE_ENABLE 0
+#endif
+
+/* Size of the trace ring (bytes), must be a power of two. */
+#ifndef UMODEM_TRACE_BUF_SIZE
+#define UMODEM_TRACE_BUF_SIZE 4096
+#endif
+
+/* GSM 07.10 multiplexer (umodem_cmux.h): AT control and bulk data on
+ * separate virtual channels. Set to 1 to enable; when 0 it compiles out.
+ */
+#ifndef UMODEM_CMUX_ENABLE
+#define UMODEM_CMUX_ENABLE 0
+#endif
+
+/* Maximum information field length of a CMUX frame (N1), in bytes. */
+#ifndef UMODEM_CMUX_N1
+#define UMODEM_CMUX_N1 127
+#endif
+
+/* Size of the data channel ring (bytes), a power of two that holds a whole
+ * AT+QIRD reply.
+ */
+#ifndef UMODEM_CMUX_DATA_BUF_SIZE
+#define UMODEM_CMUX_DATA_BUF_SIZE 2048
+#endif
+
+/* Time to wait for the modem to acknowledge a CMUX frame, in ms (T1). */
+#ifndef UMODEM_CMUX_ACK_TIMEOUT_MS
+#define UMODEM_CMUX_ACK_TIMEOUT_MS 1000
+#endif
+
+/* PPP data mode (umodem_ppp.h): IPv4 packets through a netif hook instead
+ * of AT socket commands. Set to 1 to enable; when 0 it compiles out.
+ */
+#ifndef UMODEM_PPP_ENABLE
+#define UMODEM_PPP_ENABLE 0
+#endif
+
+/* Largest IPv4 packet accepted from the link (bytes), negotiated with LCP. */
+#ifndef UMODEM_PPP_MRU
+#define UMODEM_PPP_MRU 1500
+#endif
+
+/* HTTP body chunk size (bytes), see umodem_http.h. Must hold the response
+ * header block and stay within the driver's socket send limit.
+ */
+#ifndef UMODEM_HTTP_CHUNK_SIZE
+#define UMODEM_HTTP_CHUNK_SIZE 1024
+#endif
+
+/* DNS cache of the driver (entries, 0 disables caching). The modem does not
+ * report record TTLs, so answers are trusted for UMODEM_DNS_CACHE_TTL_MS.
+ */
+#ifndef UMODEM_DNS_CACHE_SIZE
+#define UMODEM_DNS_CACHE_SIZE 4
+#endif
+
+#ifndef UMODEM_DNS_CACHE_TTL_MS
+#define UMODEM_DNS_CACHE_TTL_MS 300000
+#endif
+
+/* Longest hostname the DNS cache stores, longer names are not cached */
+#ifndef UMODEM_DNS_HOST_MAX
+#define UMODEM_DNS_HOST_MAX 64
+#endif
+
 #define UMODEM_MQTT_CLIENT_ID_PREFIX 1
 
 #endif
\ No newline at end of file
@@ -7,37 +7,175 @@
 
 #include "umodem_at.h"
 #include "umodem_buffer.h"
+#include "umodem_cmux.h"
+#include "umodem_ppp.h"
 #include "umodem_driver.h"
+#include "umodem_metrics.h"
 
 #include "port/umodem_port.h"
 
+#if UMODEM_URC_HASH_SIZE < 2 || \
+    (UMODEM_URC_HASH_SIZE & (UMODEM_URC_HASH_SIZE - 1))
+#error "UMODEM_URC_HASH_SIZE must be a power of two"
+#endif
+
 #define MAX_QUEUED_EVENTS 10
 
-// User event callback
-static umodem_event_cb_t g_event_cb = NULL;
-static void* g_user_ctx = NULL;
+// Event subscribers
+typedef struct {
+  umodem_event_cb_t cb;
+  void* user_ctx;
+  uint32_t mask;
+} umodem_event_subscriber_t;
+
+static umodem_event_subscriber_t g_subscribers[UMODEM_MAX_EVENT_SUBSCRIBERS];
+static int g_legacy_subscriber = -1;
+
+// Per-flag dispatch table, rebuilt whenever the subscriber set changes
+static uint8_t g_flag_subs[UMODEM_EVENT_COUNT][UMODEM_MAX_EVENT_SUBSCRIBERS];
+static uint8_t g_flag_sub_count[UMODEM_EVENT_COUNT];
+
 static size_t urc_scan_offset = 0;
 
-// URC handler function
-typedef umodem_event_t (*umodem_urc_handler_t)(const char* line, size_t len);
+// URC lookup: open-addressed hash of driver URC keys, slot = table index + 1
+static uint8_t g_urc_slots[UMODEM_URC_HASH_SIZE];
+static const umodem_urc_entry_t* g_urc_indexed_table = NULL;
+static umodem_result_t urc_index_build(void);
+
+// UART settings in effect, reset whenever the HAL is initialized
+static uint32_t g_baudrate = UMODEM_BAUDRATE;
+static int g_flow_control = 0;
+
 static umodem_event_t g_event_queue[MAX_QUEUED_EVENTS];
 static size_t g_event_queue_len = 0;
 
+// Status cache, see umodem_get_status(). Readings keep the time they were
+// taken so the age is computed on read.
+static struct {
+  char imei[20];
+  char iccid[24];
+  int rssi;
+  int ber;
+  int reg_stat;
+  umodem_status_source_t signal_source;
+  umodem_status_source_t reg_source;
+  uint32_t signal_at;
+  uint32_t reg_at;
+  uint32_t next_refresh;
+  int refresh; // Set by umodem_init(), never for umodem_attach()
+} g_status;
+
+static void rebuild_dispatch_table(void) {
+  for (int flag = 0; flag < UMODEM_EVENT_COUNT; flag++) {
+    g_flag_sub_count[flag] = 0;
+    for (int i = 0; i < UMODEM_MAX_EVENT_SUBSCRIBERS; i++) {
+      if (g_subscribers[i].cb &&
+          (g_subscribers[i].mask & UMODEM_EVENT_MASK(flag)))
+        g_flag_subs[flag][g_flag_sub_count[flag]++] = (uint8_t)i;
+    }
+  }
+}
+
 static void queue_event(umodem_event_t event) {
-  if (g_event_queue_len < MAX_QUEUED_EVENTS &&
-      event.event_flag != UMODEM_NO_EVENT && event.event_flag > 0)
-    g_event_queue[g_event_queue_len++] = event;
+  if (event.event_flag <= UMODEM_NO_EVENT ||
+      event.event_flag >= UMODEM_EVENT_COUNT)
+    return;
+
+  // Nobody listens: release event data right away instead of queueing it
+  if (g_flag_sub_count[event.event_flag] == 0 ||
+      g_event_queue_len >= MAX_QUEUED_EVENTS) {
+    if (g_event_queue_len >= MAX_QUEUED_EVENTS) UMODEM_METRICS_EVENT_DROP();
+    if (event.dtor) event.dtor(&event);
+    return;
+  }
+
+  g_event_queue[g_event_queue_len++] = event;
 }
 
 static void dispatch_queued_events(void) {
   while (g_event_queue_len > 0) {
     umodem_event_t event = g_event_queue[g_event_queue_len - 1];
     g_event_queue_len--;
-    if (g_event_cb) g_event_cb(&event, g_user_ctx);
+
+    const uint8_t* subs = g_flag_subs[event.event_flag];
+    for (uint8_t i = 0; i < g_flag_sub_count[event.event_flag]; i++) {
+      umodem_event_subscriber_t* sub = &g_subscribers[subs[i]];
+      if (sub->cb) sub->cb(&event, sub->user_ctx);
+    }
     if (event.dtor) event.dtor(&event);
   }
 }
 
+// Status setters run under the HAL lock (URC handlers already hold it)
+static void status_set_signal(
+    int rssi, int ber, umodem_status_source_t source) {
+  g_status.rssi = rssi;
+  g_status.ber = ber;
+  g_status.signal_source = source;
+  g_status.signal_at = umodem_hal_millis();
+  g_status.next_refresh = g_status.signal_at + UMODEM_STATUS_REFRESH_MS;
+}
+
+static void status_set_registration(int stat, umodem_status_source_t source) {
+  g_status.reg_stat = stat;
+  g_status.reg_source = source;
+  g_status.reg_at = umodem_hal_millis();
+}
+
+void umodem_status_set_registration(int stat) {
+  status_set_registration(stat, UMODEM_STATUS_SRC_URC);
+}
+
+// Read an identity string once, trimming the line the driver returns
+static void status_read_identity(
+    umodem_result_t (*get)(char*, size_t), char* dst, size_t dst_size) {
+  char buf[32];
+  if (get(buf, sizeof(buf)) != UMODEM_OK) return;
+
+  size_t n = 0;
+  for (const char* p = buf; *p && n + 1 < dst_size; p++) {
+    if ((*p >= '0' && *p <= '9') || (*p >= 'A' && *p <= 'F')) dst[n++] = *p;
+  }
+  dst[n] = '\0';
+}
+
+// Refresh signal and registration once due, on an idle AT channel only.
+// Returns ms until the next refresh.
+static uint32_t status_poll(uint32_t now) {
+#if UMODEM_STATUS_REFRESH_MS > 0
+  if (!g_status.refresh) return UMODEM_POLL_INFINITE;
+
+  int32_t due = (int32_t)(g_status.next_refresh - now);
+  if (due > 0) return (uint32_t)due;
+  // Never queue behind another command, retry shortly
+  if (umodem_at_busy()) return UMODEM_AT_BUSY_RETRY_MS;
+
+  // A failed refresh waits for the next slot as well: commands on a channel
+  // in data mode fail without touching the link
+  g_status.next_refresh = now + UMODEM_STATUS_REFRESH_MS;
+
+  int rssi, ber;
+  if (g_umodem_driver->get_signal(&rssi, &ber) == UMODEM_OK) {
+    umodem_hal_lock();
+    status_set_signal(rssi, ber, UMODEM_STATUS_SRC_POLL);
+    umodem_hal_unlock();
+  }
+
+  int stat;
+  if (g_umodem_driver->get_registration &&
+      g_umodem_driver->get_registration(&stat) == UMODEM_OK) {
+    umodem_hal_lock();
+    status_set_registration(stat, UMODEM_STATUS_SRC_POLL);
+    umodem_hal_unlock();
+  }
+
+  return UMODEM_STATUS_REFRESH_MS;
+#else
+  (void)now;
+  return UMODEM_POLL_INFINITE;
+#endif
+}
+
 umodem_result_t umodem_init(umodem_apn_t* apn) {
   umodem_result_t result = UMODEM_OK;
 
@@ -48,30 +186,69 @@ umodem_result_t umodem_init(umodem_apn_t* apn) {
 
   if (g_umodem_driver->umodem_initialized == 1) return result;
 
+  // UMODEM_RX_BUF_SIZE 0 and no umodem_buffer_set_storage()
   umodem_buffer_init(&urc_scan_offset);
+  if (umodem_buffer_get_storage(NULL) == NULL) return UMODEM_PARAM;
+  // Too many URCs for UMODEM_URC_HASH_SIZE would all go unhandled
+  if (urc_index_build() != UMODEM_OK) return UMODEM_PARAM;
   umodem_at_init();
+  g_baudrate = UMODEM_BAUDRATE;
+  g_flow_control = 0;
 
-  umodem_hal_send((const uint8_t*)"\r\n\r\n", 4);
+  umodem_at_write((const uint8_t*)"\r\n\r\n", 4);
   umodem_hal_delay_ms(100);
 
+  memset(&g_status, 0, sizeof(g_status));
   result = g_umodem_driver->init();
-  if (result == UMODEM_OK)
+  if (result == UMODEM_OK) {
     g_umodem_driver->umodem_initialized = 1;
-  else
+
+    status_read_identity(
+        g_umodem_driver->get_imei, g_status.imei, sizeof(g_status.imei));
+    status_read_identity(
+        g_umodem_driver->get_iccid, g_status.iccid, sizeof(g_status.iccid));
+    // Nothing is stale yet, and the first poll may well run next to a
+    // command the application is already waiting for
+    g_status.next_refresh = umodem_hal_millis() + UMODEM_STATUS_REFRESH_MS;
+    g_status.refresh = 1;
+  } else
     umodem_at_deinit();
 
   g_umodem_driver->apn = apn;
   return result;
 }
 
+umodem_result_t umodem_attach(umodem_apn_t* apn) {
+  if (g_umodem_driver->umodem_initialized == 1) return UMODEM_OK;
+
+  umodem_buffer_init(&urc_scan_offset);
+  if (umodem_buffer_get_storage(NULL) == NULL) return UMODEM_PARAM;
+  if (urc_index_build() != UMODEM_OK) return UMODEM_PARAM;
+  umodem_at_init();
+  memset(&g_status, 0, sizeof(g_status));
+
+  g_umodem_driver->umodem_initialized = 1;
+  g_umodem_driver->apn = apn;
+  return UMODEM_OK;
+}
+
 umodem_result_t umodem_deinit(void) {
   umodem_result_t result = UMODEM_OK;
   if (!g_umodem_driver->umodem_initialized) return result;
 
+#if UMODEM_CMUX_ENABLE
+  umodem_cmux_stop();
+#endif
+
+  // The HAL reopens the port at the default rate
+  if (g_flow_control) umodem_set_flow_control(0);
+  if (g_baudrate != UMODEM_BAUDRATE) umodem_set_baudrate(UMODEM_BAUDRATE);
+
   result = g_umodem_driver->deinit();
   if (result != UMODEM_OK) return result;
 
   umodem_at_deinit();
+  g_status.refresh = 0;
   g_umodem_driver->umodem_initialized = 0;
   return result;
 }
@@ -80,80 +257,283 @@ umodem_result_t umodem_power_on(void) { return UMODEM_OK; }
 
 umodem_result_t umodem_power_off(void) { return UMODEM_OK; }
 
+// Serve an identity string from the cache, querying only if init missed it
+static umodem_result_t status_get_identity(const char* cached,
+    umodem_result_t (*get)(char*, size_t), char* buf, size_t buf_size) {
+  if (!cached[0]) return get(buf, buf_size);
+  if (!buf || buf_size <= strlen(cached)) return UMODEM_PARAM;
+
+  strcpy(buf, cached);
+  return UMODEM_OK;
+}
+
 umodem_result_t umodem_get_imei(char* buf, size_t buf_size) {
   if (!g_umodem_driver->umodem_initialized) return UMODEM_ERR;
 
-  return g_umodem_driver->get_imei(buf, buf_size);
+  return status_get_identity(
+      g_status.imei, g_umodem_driver->get_imei, buf, buf_size);
 }
 
 umodem_result_t umodem_get_iccid(char* buf, size_t buf_size) {
   if (!g_umodem_driver->umodem_initialized) return UMODEM_ERR;
 
-  return g_umodem_driver->get_iccid(buf, buf_size);
+  return status_get_identity(
+      g_status.iccid, g_umodem_driver->get_iccid, buf, buf_size);
 }
 
 umodem_result_t umodem_get_signal_quality(int* rssi, int* ber) {
   if (!g_umodem_driver->umodem_initialized) return UMODEM_ERR;
 
-  return g_umodem_driver->get_signal(rssi, ber);
+  umodem_result_t result = g_umodem_driver->get_signal(rssi, ber);
+  if (result == UMODEM_OK) {
+    umodem_hal_lock();
+    status_set_signal(*rssi, *ber, UMODEM_STATUS_SRC_QUERY);
+    umodem_hal_unlock();
+  }
+  return result;
+}
+
+static uint32_t status_age(umodem_status_source_t source, uint32_t at) {
+  return source == UMODEM_STATUS_SRC_NONE ? UINT32_MAX
+                                          : umodem_hal_millis() - at;
+}
+
+umodem_result_t umodem_get_status(umodem_status_t* status) {
+  if (!g_umodem_driver->umodem_initialized) return UMODEM_ERR;
+  if (!status) return UMODEM_PARAM;
+
+  umodem_hal_lock();
+  memcpy(status->imei, g_status.imei, sizeof(status->imei));
+  memcpy(status->iccid, g_status.iccid, sizeof(status->iccid));
+  status->rssi = g_status.rssi;
+  status->ber = g_status.ber;
+  status->reg_stat = g_status.reg_stat;
+  status->signal_source = g_status.signal_source;
+  status->reg_source = g_status.reg_source;
+  status->signal_age_ms =
+      status_age(g_status.signal_source, g_status.signal_at);
+  status->reg_age_ms = status_age(g_status.reg_source, g_status.reg_at);
+  umodem_hal_unlock();
+  return UMODEM_OK;
+}
+
+umodem_result_t umodem_set_baudrate(uint32_t baudrate) {
+  if (!g_umodem_driver->umodem_initialized) return UMODEM_ERR;
+  if (baudrate == 0) return UMODEM_PARAM;
+  if (g_umodem_driver->set_baudrate == NULL) return UMODEM_ERR;
+
+  // Framing and data modes cannot survive a rate change
+  if (umodem_cmux_active() || umodem_ppp_ring() || umodem_at_raw_ring())
+    return UMODEM_ERR;
+  if (baudrate == g_baudrate) return UMODEM_OK;
+
+  umodem_result_t result = g_umodem_driver->set_baudrate(g_baudrate, baudrate);
+  if (result == UMODEM_OK) g_baudrate = baudrate;
+  return result;
+}
+
+uint32_t umodem_get_baudrate(void) { return g_baudrate; }
+
+umodem_result_t umodem_set_flow_control(int enable) {
+  if (!g_umodem_driver->umodem_initialized) return UMODEM_ERR;
+  if (g_umodem_driver->set_flow_control == NULL) return UMODEM_ERR;
+
+  umodem_result_t result = g_umodem_driver->set_flow_control(enable != 0);
+  if (result == UMODEM_OK) g_flow_control = enable != 0;
+  return result;
 }
 
 void umodem_register_event_callback(umodem_event_cb_t cb, void* user_ctx) {
-  g_event_cb = cb;
-  g_user_ctx = user_ctx;
+  if (g_legacy_subscriber >= 0) {
+    umodem_event_unsubscribe(g_legacy_subscriber);
+    g_legacy_subscriber = -1;
+  }
+
+  if (cb)
+    g_legacy_subscriber =
+        umodem_event_subscribe(UMODEM_EVENT_MASK_ALL, cb, user_ctx);
+}
+
+int umodem_event_subscribe(
+    uint32_t mask, umodem_event_cb_t cb, void* user_ctx) {
+  if (!cb || (mask & UMODEM_EVENT_MASK_ALL) == 0) return -1;
+
+  for (int i = 0; i < UMODEM_MAX_EVENT_SUBSCRIBERS; i++) {
+    if (g_subscribers[i].cb == NULL) {
+      g_subscribers[i].cb = cb;
+      g_subscribers[i].user_ctx = user_ctx;
+      g_subscribers[i].mask = mask & UMODEM_EVENT_MASK_ALL;
+      rebuild_dispatch_table();
+      return i;
+    }
+  }
+
+  return -1; // Registry full
 }
 
-static int umodem_buffer_process_urcs(umodem_urc_handler_t handler) {
-  if (!handler) return -1;
+void umodem_event_unsubscribe(int handle) {
+  if (handle < 0 || handle >= UMODEM_MAX_EVENT_SUBSCRIBERS) return;
+
+  g_subscribers[handle].cb = NULL;
+  g_subscribers[handle].user_ctx = NULL;
+  g_subscribers[handle].mask = 0;
+  if (handle == g_legacy_subscriber) g_legacy_subscriber = -1;
+  rebuild_dispatch_table();
+}
+
+// FNV-1a over the URC key
+static uint32_t urc_hash(const char* key, size_t len) {
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (uint8_t)key[i];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+// Extract the lookup key of a line, see umodem_urc_entry_t
+static size_t urc_key(const char* line, size_t len, const char** key) {
+  size_t start = 0;
+  while (start < len && line[start] >= '0' && line[start] <= '9') start++;
+  if (start > 0 && start + 1 < len && line[start] == ',' &&
+      line[start + 1] == ' ')
+    start += 2;
+  else
+    start = 0;
+
+  size_t end = start;
+  while (end < len && line[end] != ':' && line[end] != '\r' &&
+      line[end] != '\n')
+    end++;
+  if (end < len && line[end] == ':') end++;
+
+  *key = line + start;
+  return end - start;
+}
+
+// Fails if the driver has more URCs than the table leaves free slots for
+static umodem_result_t urc_index_build(void) {
+  memset(g_urc_slots, 0, sizeof(g_urc_slots));
+  g_urc_indexed_table = g_umodem_driver->urc_table;
+
+  size_t count = g_umodem_driver->urc_count;
+  if (count >= UMODEM_URC_HASH_SIZE || count > UINT8_MAX - 1)
+    return UMODEM_PARAM;
+
+  for (size_t i = 0; i < count; i++) {
+    const umodem_urc_entry_t* entry = &g_urc_indexed_table[i];
+    uint32_t slot = urc_hash(entry->key, entry->key_len);
+    while (g_urc_slots[slot & (UMODEM_URC_HASH_SIZE - 1)] != 0) slot++;
+    g_urc_slots[slot & (UMODEM_URC_HASH_SIZE - 1)] = (uint8_t)(i + 1);
+  }
+  return UMODEM_OK;
+}
+
+umodem_event_t umodem_urc_dispatch(const char* line, size_t len) {
+  if (!g_umodem_driver->urc_table) return (umodem_event_t){0};
+  if (g_urc_indexed_table != g_umodem_driver->urc_table &&
+      urc_index_build() != UMODEM_OK)
+    return (umodem_event_t){0};
+
+  const char* key;
+  size_t key_len = urc_key(line, len, &key);
+  if (key_len == 0) return (umodem_event_t){0};
+
+  uint32_t slot = urc_hash(key, key_len);
+  uint8_t index;
+  while ((index = g_urc_slots[slot & (UMODEM_URC_HASH_SIZE - 1)]) != 0) {
+    const umodem_urc_entry_t* entry = &g_urc_indexed_table[index - 1];
+    if (entry->key_len == key_len && memcmp(entry->key, key, key_len) == 0)
+      return entry->handler(line, len);
+    slot++;
+  }
+
+  return (umodem_event_t){0};
+}
+
+static int umodem_buffer_process_urcs(umodem_ring_t* ring) {
+  if (!ring->urc_scan_offset) return 0; // Not initialized yet
 
   int lines_processed = 0;
-  size_t offset = urc_scan_offset;
+  size_t offset = *ring->urc_scan_offset;
 
-  while (offset < umodem_buffer_get_count()) {
-    int pos = umodem_buffer_find_from((uint8_t*)"\r\n", 2, offset);
-    if (pos < 0) break;
+  while (offset < umodem_ring_get_count(ring)) {
+    size_t pos = umodem_ring_find_from(ring, (uint8_t*)"\r\n", 2, offset);
+    if (pos == UMODEM_RING_NPOS) break;
 
-    size_t line_len = (size_t)(pos - offset) + 2;
+    size_t line_len = pos - offset + 2;
     char buf[line_len + 1];
 
-    if (umodem_buffer_peek_from((uint8_t*)buf, offset, line_len) !=
-        (int)line_len)
+    if (umodem_ring_peek_from(ring, (uint8_t*)buf, offset, line_len) !=
+        line_len)
       break;
 
     buf[line_len] = '\0';
 
-    // Call handler
-    umodem_event_t event_info = handler((uint8_t*)buf, line_len);
-    queue_event(event_info);
+    queue_event(umodem_urc_dispatch(buf, line_len));
 
     lines_processed++;
     offset = pos + 2;
-    umodem_hal_delay_ms(10);
   }
 
-  urc_scan_offset = offset;
+  *ring->urc_scan_offset = offset;
   return lines_processed;
 }
 
-void umodem_poll(void) {
-  umodem_hal_lock();
+// PPP frames and transparent socket data are not scanned for URCs
+static int carries_urcs(umodem_ring_t* ring) {
+  return ring != umodem_ppp_ring() && ring != umodem_at_raw_ring();
+}
 
+uint32_t umodem_poll(void) {
   // Read new data
-  static uint8_t read_buf[UMODEM_RX_BUF_SIZE] = {0};
-  memset(read_buf, 0, sizeof(read_buf));
+  static uint8_t read_buf[UMODEM_RX_READ_SIZE];
+  int len = umodem_hal_read(read_buf, sizeof(read_buf));
 
-  umodem_hal_unlock();
+  umodem_hal_lock();
 
-  size_t len = umodem_hal_read(read_buf, sizeof(read_buf));
-  if (len > 0) umodem_buffer_push(read_buf, len);
+  if (len > 0) umodem_buffer_push(read_buf, (size_t)len);
 
-  // Process all new URC lines
-  umodem_buffer_process_urcs(g_umodem_driver->handle_urc);
+  // Process all new URC lines, except on a channel in data mode
+  if (carries_urcs(umodem_buffer_ring()))
+    umodem_buffer_process_urcs(umodem_buffer_ring());
+#if UMODEM_CMUX_ENABLE
+  if (umodem_cmux_active() && carries_urcs(umodem_cmux_data_ring()))
+    umodem_buffer_process_urcs(umodem_cmux_data_ring());
+#endif
 
   umodem_hal_unlock();
 
-  if (g_umodem_driver->umodem_initialized == 0) return;
-  dispatch_queued_events();
+#if UMODEM_CMUX_ENABLE
+  umodem_cmux_poll();
+#endif
+
+  if (g_umodem_driver->umodem_initialized == 0) return UMODEM_POLL_INFINITE;
+
+  uint32_t next = UMODEM_POLL_INFINITE;
+#if UMODEM_PPP_ENABLE
+  next = umodem_ppp_poll(umodem_hal_millis());
+#endif
+
+  // Callbacks may issue AT commands: never dispatch from inside one, the
+  // queue is drained by a poll after the command completes. Waiting in
+  // between rather than spinning leaves the command's owner the CPU.
+  if (!umodem_at_busy())
+    dispatch_queued_events();
+  else if (g_event_queue_len > 0 && next > UMODEM_AT_BUSY_RETRY_MS)
+    next = UMODEM_AT_BUSY_RETRY_MS;
+
+  uint32_t status_next = status_poll(umodem_hal_millis());
+  if (status_next < next) next = status_next;
+
+  if (!g_umodem_driver->poll) return next;
+  uint32_t driver_next = g_umodem_driver->poll(umodem_hal_millis());
+  return driver_next < next ? driver_next : next;
+}
+
+void umodem_wait(uint32_t timeout_ms) {
+  if (timeout_ms == 0) return;
+  umodem_hal_wait_rx(timeout_ms);
 }
 
 umodem_event_flag_t umodem_event_get_flag(umodem_event_t* event) {
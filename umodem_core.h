@@ -18,6 +18,9 @@ extern "C" {
   umodem_strtoi((str), (min_val), (max_val), (out))
 #define UMODEM_RAND() umodem_rand()
 
+/** @brief Returned by umodem_poll() when no deadline is pending. */
+#define UMODEM_POLL_INFINITE UINT32_MAX
+
 static inline void* umodem_memmem(const void* haystack, size_t haystacklen,
     const void* needle, size_t needlelen) {
   if (needlelen == 0) return (void*)haystack;
@@ -101,6 +104,17 @@ typedef void (*umodem_event_cb_t)(umodem_event_t* event, void* user_ctx);
    */
 umodem_result_t umodem_init(umodem_apn_t* apn);
 
+/**
+   * @brief Start the library without the modem initialization sequence.
+   *
+   * Sets up the RX buffer, URC parsing and event dispatch only. Driver state
+   * (SIM, registration) is not probed, so this is meant for diagnostics
+   * such as replaying a recorded trace.
+   *
+   * @return UMODEM_OK on success.
+   */
+umodem_result_t umodem_attach(umodem_apn_t* apn);
+
 /**
    * @brief Deinitialize the modem library and power off modem.
    *
@@ -110,9 +124,24 @@ umodem_result_t umodem_deinit(void);
 
 /**
    * @brief Poll the modem state and process events.
-   * Must be called periodically (e.g., every 10–100 ms).
+   *
+   * Must be called whenever RX data arrives and no later than the deadline
+   * it returns. A typical loop is:
+   *
+   *   for (;;) umodem_wait(umodem_poll());
+   *
+   * @return Milliseconds until the next internal deadline (timeouts,
+   *         keepalives, retry timers), or UMODEM_POLL_INFINITE when idle.
+   */
+uint32_t umodem_poll(void);
+
+/**
+   * @brief Sleep until RX data arrives or the timeout elapses.
+   *
+   * @param timeout_ms  Maximum time to sleep, typically the value returned
+   *                    by umodem_poll().
    */
-void umodem_poll(void);
+void umodem_wait(uint32_t timeout_ms);
 
 /**
    * @brief Power on the modem hardware (if controllable).
@@ -134,14 +163,118 @@ umodem_result_t umodem_get_iccid(char* buf, size_t buf_size);
 
 umodem_result_t umodem_get_signal_quality(int* rssi, int* ber);
 
+/** @brief Where a cached status value came from. */
+typedef enum {
+  UMODEM_STATUS_SRC_NONE = 0, /**< Never read */
+  UMODEM_STATUS_SRC_INIT,     /**< Read by umodem_init() */
+  UMODEM_STATUS_SRC_POLL,     /**< Background refresh in umodem_poll() */
+  UMODEM_STATUS_SRC_QUERY,    /**< Explicit umodem_get_*() call */
+  UMODEM_STATUS_SRC_URC,      /**< Reported by the modem unprompted */
+} umodem_status_source_t;
+
+/** @brief Snapshot of the modem status cache. */
+typedef struct {
+  /** @brief IMEI, empty if unknown */
+  char imei[20];
+  /** @brief ICCID, empty if unknown */
+  char iccid[24];
+  /** @brief Last +CSQ values */
+  int rssi;
+  int ber;
+  /** @brief Last <stat> of +CREG (1 = home, 5 = roaming) */
+  int reg_stat;
+  umodem_status_source_t signal_source;
+  umodem_status_source_t reg_source;
+  /** @brief Milliseconds since each value was read, UINT32_MAX if never */
+  uint32_t signal_age_ms;
+  uint32_t reg_age_ms;
+} umodem_status_t;
+
+/**
+   * @brief Read the status cache without touching the AT channel.
+   *
+   * IMEI and ICCID are read once by umodem_init(). Signal quality and
+   * registration are refreshed by umodem_poll() every
+   * UMODEM_STATUS_REFRESH_MS while no command is in flight (the first
+   * time one period after umodem_init()), by umodem_get_signal_quality()
+   * and by registration URCs. Callers that need a fresher value than the
+   * age reported can still query it.
+   *
+   * @param status  Snapshot to fill.
+   *
+   * @return UMODEM_OK on success, UMODEM_ERR if the library is not
+   *         initialized.
+   */
+umodem_result_t umodem_get_status(umodem_status_t* status);
+
+/**
+   * @brief Change the UART rate of the modem and the HAL.
+   *
+   * Sends the new rate to the modem, switches the HAL with
+   * umodem_hal_set_baudrate() and checks the link with a few AT probes. If
+   * the probes fail, both sides go back to the previous rate.
+   *
+   * Not available while CMUX, PPP or a transparent connection is active.
+   *
+   * @param baudrate  New rate in bits per second.
+   *
+   * @return UMODEM_OK on success, UMODEM_ERR if the rate was refused or
+   *         failed verification (the previous rate is in effect again),
+   *         UMODEM_TIMEOUT if the modem answers at neither rate.
+   */
+umodem_result_t umodem_set_baudrate(uint32_t baudrate);
+
+/**
+   * @brief Get the UART rate currently in effect.
+   */
+uint32_t umodem_get_baudrate(void);
+
+/**
+   * @brief Enable or disable RTS/CTS hardware flow control on both sides.
+   *
+   * Requires umodem_hal_set_flow_control(). If the HAL cannot enable it, the
+   * modem setting is reverted.
+   *
+   * @param enable  Non-zero to enable, 0 to disable.
+   *
+   * @return UMODEM_OK on success.
+   */
+umodem_result_t umodem_set_flow_control(int enable);
+
 /**
    * @brief Register an event callback.
    *
+   * Shorthand for a single subscriber receiving every event. Calling it again
+   * replaces the previous callback.
+   *
    * @param cb        Callback function (set to NULL to unregister).
    * @param user_ctx  User-defined pointer passed to callback.
    */
 void umodem_register_event_callback(umodem_event_cb_t cb, void* user_ctx);
 
+/**
+   * @brief Subscribe a listener to a subset of events.
+   *
+   * Events are only delivered to subscribers whose mask contains the event
+   * flag, so unrelated listeners are never invoked.
+   *
+   * @param mask      Bitwise OR of UMODEM_EVENT_MASK() values.
+   * @param cb        Callback function.
+   * @param user_ctx  User-defined pointer passed to callback.
+   *
+   * @return Subscriber handle (>= 0) on success, -1 if the registry is full
+   *         or the arguments are invalid.
+   */
+int umodem_event_subscribe(
+    uint32_t mask, umodem_event_cb_t cb, void* user_ctx);
+
+/**
+   * @brief Remove a subscriber registered with umodem_event_subscribe().
+   *
+   * @param handle  Subscriber handle.
+   */
+void umodem_event_unsubscribe(int handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,610 @@
+#ifndef uMODEM_CORO_HPP_
+#define uMODEM_CORO_HPP_
+
+/*
+ * C++20 coroutines over umodem.hpp.
+ *
+ * A single-threaded Executor drives umodem_poll() and resumes coroutines
+ * when what they wait for arrives: the final result code of an AT command,
+ * an event (URC) or a deadline. Many logical operations are interleaved on
+ * one thread, without a callback state machine per operation:
+ *
+ *   umodem::co::Task<> report(umodem::co::Modem& modem) {
+ *     char csq[32];
+ *     if (co_await modem.at("AT+CSQ", csq) == UMODEM_OK) puts(csq);
+ *   }
+ *
+ *   umodem::co::Executor exec;
+ *   umodem::co::Modem modem(exec);
+ *   exec.spawn(report(modem));
+ *   exec.run();
+ *
+ * Commands share the AT channel and are issued one at a time, in the order
+ * they were awaited. Socket connects and MQTT publishes suspend until their
+ * completion URC; the command exchange that starts them still runs in the
+ * driver, with the channel held. The library drives one modem, so there is
+ * one Executor per process.
+ *
+ * While tasks run, issue AT commands only through the awaitables here: not
+ * with blocking calls outside the executor's lock, nor from event callbacks.
+ * Coroutine frames are allocated with operator new; exceptions terminate.
+ */
+
+#if __cplusplus < 202002L
+#error "umodem_coro.hpp requires C++20"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "umodem.hpp"
+#include "umodem_at.h"
+#include "umodem_config.h"
+
+#include "port/umodem_port.h"
+
+namespace umodem::co {
+
+template <class T>
+class Task;
+
+namespace detail {
+
+// Resumes whoever awaited the finished task
+struct FinalAwaiter {
+  bool await_ready() const noexcept { return false; }
+  template <class P>
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<P> h) const noexcept {
+    auto next = h.promise().continuation;
+    return next ? next : std::noop_coroutine();
+  }
+  void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+  std::coroutine_handle<> continuation;
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+template <class T>
+struct Promise : PromiseBase {
+  T value{};
+
+  Task<T> get_return_object() noexcept;
+  void return_value(T v) noexcept { value = std::move(v); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+  Task<void> get_return_object() noexcept;
+  void return_void() const noexcept {}
+};
+
+// Self-destroying frame running a spawned task
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() const noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+};
+
+} // namespace detail
+
+/**
+ * @brief Lazily started coroutine, run by co_await or Executor::spawn().
+ *
+ * T must be default-constructible.
+ */
+template <class T = void>
+class Task {
+ public:
+  using promise_type = detail::Promise<T>;
+
+  Task(Task&& other) noexcept : h_(std::exchange(other.h_, {})) {}
+  Task& operator=(Task&&) = delete;
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() {
+    if (h_) h_.destroy();
+  }
+
+  bool await_ready() const noexcept { return !h_ || h_.done(); }
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<> caller) noexcept {
+    h_.promise().continuation = caller;
+    return h_;
+  }
+  T await_resume() noexcept {
+    if constexpr (!std::is_void_v<T>) return std::move(h_.promise().value);
+  }
+
+ private:
+  friend promise_type;
+  explicit Task(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+
+  std::coroutine_handle<promise_type> h_;
+};
+
+template <class T>
+Task<T> detail::Promise<T>::get_return_object() noexcept {
+  return Task<T>(
+      std::coroutine_handle<detail::Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> detail::Promise<void>::get_return_object() noexcept {
+  return Task<void>(
+      std::coroutine_handle<detail::Promise<void>>::from_promise(*this));
+}
+
+class Executor;
+
+/**
+ * @brief Something a coroutine waits for, linked into the executor.
+ *
+ * check() is called after every umodem_poll() and on_event() for every
+ * event; either returning true completes the wait. A wait with a deadline
+ * completes with timed_out set once it passes.
+ */
+struct Waiter {
+  Waiter* next = nullptr;
+  std::coroutine_handle<> handle;
+  bool (*check)(Waiter* self) = nullptr;
+  bool (*on_event)(Waiter* self, const Event& event) = nullptr;
+  uint32_t deadline = 0;
+  bool timed = false;
+  bool linked = false;
+  bool done = false;
+  bool timed_out = false;
+
+  void expire_in(uint32_t ms) noexcept {
+    deadline = umodem_hal_millis() + ms;
+    timed = true;
+  }
+};
+
+/** @brief Exclusive use of the AT channel, released on destruction. */
+class AtLock {
+ public:
+  explicit AtLock(Executor* exec) noexcept : exec_(exec) {}
+  AtLock(AtLock&& other) noexcept : exec_(std::exchange(other.exec_, {})) {}
+  AtLock& operator=(AtLock&&) = delete;
+  AtLock(const AtLock&) = delete;
+  ~AtLock() { unlock(); }
+
+  void unlock() noexcept;
+
+ private:
+  Executor* exec_;
+};
+
+template <class Match>
+class EventWait;
+
+class Executor {
+ public:
+  Executor() noexcept : events_(UMODEM_EVENT_MASK_ALL, dispatch_) {}
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  /** @brief Start a task; it runs up to its first suspension right away. */
+  void spawn(Task<> task) {
+    live_++;
+    launch(this, std::move(task));
+  }
+
+  /** @brief Number of spawned tasks that have not finished. */
+  size_t tasks() const noexcept { return live_; }
+
+  /** @brief Run until every spawned task has finished. */
+  void run() {
+    while (live_ > 0) run_once();
+  }
+
+  /**
+   * @brief Poll the modem once and resume the coroutines whose wait
+   * completed, or sleep until RX data or the nearest deadline if none did.
+   */
+  void run_once(uint32_t max_wait_ms = UMODEM_POLL_INFINITE) {
+    uint32_t wait = umodem_poll();
+    if (wait > max_wait_ms) wait = max_wait_ms;
+    uint32_t now = umodem_hal_millis();
+
+    // Completed waits leave the list; those not awaited yet find done set
+    Waiter* ready = nullptr;
+    Waiter** ready_tail = &ready;
+    Waiter** link = &head_;
+    while (*link) {
+      Waiter* w = *link;
+      if (!w->done && w->check && w->check(w)) w->done = true;
+      if (!w->done && w->timed && (int32_t)(now - w->deadline) >= 0) {
+        w->timed_out = true;
+        w->done = true;
+      }
+      if (!w->done) {
+        if (w->timed && w->deadline - now < wait) wait = w->deadline - now;
+        link = &w->next;
+        continue;
+      }
+      *link = w->next;
+      w->linked = false;
+      w->next = nullptr;
+      if (w->handle) {
+        *ready_tail = w;
+        ready_tail = &w->next;
+      }
+    }
+    tail_ = link;
+
+    if (!ready) {
+      umodem_wait(wait);
+      return;
+    }
+    while (ready) {
+      Waiter* w = ready;
+      ready = w->next; // w may not outlive its resumption
+      w->next = nullptr;
+      std::exchange(w->handle, {}).resume();
+    }
+  }
+
+  /** @brief Suspend for @p ms milliseconds. */
+  auto sleep(uint32_t ms) noexcept {
+    struct Sleep : Waiter {
+      Executor* exec;
+      Sleep(Executor* e, uint32_t ms) noexcept : exec(e) { expire_in(ms); }
+      ~Sleep() { exec->unlink(this); }
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> h) noexcept {
+        handle = h;
+        exec->link(this);
+      }
+      void await_resume() const noexcept {}
+    };
+    return Sleep(this, ms);
+  }
+
+  /**
+   * @brief Wait for an event in @p mask for which @p match(const Event&)
+   * returns true.
+   *
+   * The wait is armed when created, so create it before starting the
+   * operation the event completes, then co_await it. Each event completes
+   * the oldest matching wait only. Awaiting yields UMODEM_OK, or
+   * UMODEM_TIMEOUT after @p timeout_ms.
+   */
+  template <class Match>
+  EventWait<Match> event(uint32_t mask, Match match, uint32_t timeout_ms);
+
+  /** @brief Acquire the AT channel, see AtLock. */
+  auto lock() noexcept {
+    struct Acquire : Waiter {
+      Executor* exec;
+      explicit Acquire(Executor* e) noexcept : exec(e) {
+        check = [](Waiter* self) {
+          Executor* exec = static_cast<Acquire*>(self)->exec;
+          if (!exec->try_lock()) return false;
+          exec->lock_queue_--;
+          return true;
+        };
+      }
+      ~Acquire() {
+        if (linked) exec->lock_queue_--;
+        exec->unlink(this);
+      }
+      // Queued lockers go first
+      bool await_ready() noexcept {
+        return exec->lock_queue_ == 0 && exec->try_lock();
+      }
+      void await_suspend(std::coroutine_handle<> h) noexcept {
+        handle = h;
+        exec->lock_queue_++;
+        exec->link(this);
+      }
+      AtLock await_resume() const noexcept { return AtLock(exec); }
+    };
+    return Acquire(this);
+  }
+
+  void link(Waiter* w) noexcept {
+    w->next = nullptr;
+    w->linked = true;
+    *tail_ = w;
+    tail_ = &w->next;
+  }
+
+  void unlink(Waiter* w) noexcept {
+    if (!w->linked) return;
+    for (Waiter** link = &head_; *link; link = &(*link)->next) {
+      if (*link != w) continue;
+      *link = w->next;
+      if (tail_ == &w->next) tail_ = link;
+      break;
+    }
+    w->linked = false;
+    w->next = nullptr;
+  }
+
+ private:
+  friend class AtLock;
+
+  static detail::Detached launch(Executor* exec, Task<> task) {
+    co_await task;
+    exec->live_--;
+  }
+
+  bool try_lock() noexcept {
+    if (at_locked_) return false;
+    at_locked_ = true;
+    return true;
+  }
+
+  // Event data is only valid during the callback: mark, resume later
+  struct Dispatch {
+    Executor* exec;
+    void operator()(const Event& event) const {
+      for (Waiter* w = exec->head_; w; w = w->next) {
+        if (w->done || !w->on_event || !w->on_event(w, event)) continue;
+        w->done = true;
+        break;
+      }
+    }
+  };
+
+  Waiter* head_ = nullptr;
+  Waiter** tail_ = &head_;
+  size_t live_ = 0;
+  size_t lock_queue_ = 0;
+  bool at_locked_ = false;
+  Dispatch dispatch_{this};
+  Subscription events_;
+};
+
+inline void AtLock::unlock() noexcept {
+  if (exec_) std::exchange(exec_, {})->at_locked_ = false;
+}
+
+template <class Match>
+class EventWait : Waiter {
+ public:
+  EventWait(Executor& exec, uint32_t mask, Match match, uint32_t timeout_ms)
+      : exec_(exec), mask_(mask), match_(std::move(match)) {
+    on_event = [](Waiter* self, const Event& event) {
+      auto* wait = static_cast<EventWait*>(self);
+      return (wait->mask_ & UMODEM_EVENT_MASK(event.flag())) != 0 &&
+             wait->match_(event);
+    };
+    expire_in(timeout_ms);
+    exec_.link(this);
+  }
+  EventWait(const EventWait&) = delete;
+  EventWait& operator=(const EventWait&) = delete;
+  ~EventWait() { exec_.unlink(this); }
+
+  bool await_ready() const noexcept { return done; }
+  void await_suspend(std::coroutine_handle<> h) noexcept { handle = h; }
+  Result await_resume() const noexcept {
+    return timed_out ? UMODEM_TIMEOUT : UMODEM_OK;
+  }
+
+ private:
+  Executor& exec_;
+  uint32_t mask_;
+  Match match_;
+};
+
+template <class Match>
+EventWait<Match> Executor::event(
+    uint32_t mask, Match match, uint32_t timeout_ms) {
+  return EventWait<Match>(*this, mask, std::move(match), timeout_ms);
+}
+
+/** @brief AT commands issued from coroutines. */
+class Modem {
+ public:
+  explicit Modem(Executor& exec) noexcept : exec_(exec) {}
+
+  /**
+   * @brief Send @p cmd, with or without its trailing "\r", and suspend
+   * until its final result code.
+   *
+   * @param response  Receives the response as umodem_at_send() fills it,
+   *                  may be empty.
+   * @return UMODEM_OK, UMODEM_ERR, or UMODEM_TIMEOUT after @p timeout_ms.
+   */
+  Task<Result> at(std::string_view cmd, span<char> response = {},
+      uint32_t timeout_ms = UMODEM_CMD_TIMEOUT_MS,
+      umodem_at_channel_t channel = UMODEM_AT_CH_CONTROL) {
+    AtLock lock = co_await exec_.lock();
+    // In flight until its result: umodem_poll() must neither send its own
+    // commands nor dispatch events meanwhile
+    InFlight in_flight;
+
+    const auto* data = reinterpret_cast<const uint8_t*>(cmd.data());
+    if (umodem_at_write_on(channel, data, cmd.size()) < 0 ||
+        ((cmd.empty() || cmd.back() != '\r') &&
+            umodem_at_write_on(channel, (const uint8_t*)"\r", 1) < 0))
+      co_return UMODEM_ERR;
+
+    ResultWait wait(exec_, channel, response, timeout_ms);
+    co_return co_await wait;
+  }
+
+ private:
+  struct InFlight {
+    InFlight() noexcept { umodem_at_hold(); }
+    ~InFlight() { umodem_at_release(); }
+    InFlight(const InFlight&) = delete;
+    InFlight& operator=(const InFlight&) = delete;
+  };
+
+  // Final result code of the command written last on a channel
+  struct ResultWait : Waiter {
+    Executor& exec;
+    umodem_at_channel_t channel;
+    span<char> response;
+    Result result = UMODEM_TIMEOUT;
+
+    ResultWait(Executor& e, umodem_at_channel_t ch, span<char> resp,
+        uint32_t timeout_ms) noexcept
+        : exec(e), channel(ch), response(resp) {
+      check = [](Waiter* self) {
+        auto* wait = static_cast<ResultWait*>(self);
+        wait->result = umodem_at_poll_result(wait->channel,
+            wait->response.data(), wait->response.size());
+        return wait->result != UMODEM_TIMEOUT;
+      };
+      expire_in(timeout_ms);
+    }
+    ~ResultWait() { exec.unlink(this); }
+
+    bool await_ready() noexcept { return check(this); }
+    void await_suspend(std::coroutine_handle<> h) noexcept {
+      handle = h;
+      exec.link(this);
+    }
+    Result await_resume() const noexcept { return result; }
+  };
+
+  Executor& exec_;
+};
+
+/** @brief Socket whose connect and receive suspend instead of polling. */
+class Socket {
+ public:
+  Socket(Executor& exec, umodem::Socket&& sock) noexcept
+      : exec_(exec), sock_(std::move(sock)) {}
+
+  explicit operator bool() const noexcept { return bool(sock_); }
+  int fd() const noexcept { return sock_.fd(); }
+
+  /** @return UMODEM_OK once connected, UMODEM_ERR as soon as it is refused. */
+  Task<Result> connect(
+      std::string_view host, uint16_t port, uint32_t timeout_ms) {
+    int fd = sock_.fd();
+    bool refused = false;
+    auto connected =
+        exec_.event(UMODEM_EVENT_MASK(UMODEM_EVENT_SOCK_CONNECTED) |
+                        UMODEM_EVENT_MASK(UMODEM_EVENT_SOCK_CLOSED),
+            [fd, &refused](const Event& event) {
+              if (event.socket() != fd) return false;
+              refused = event.flag() == UMODEM_EVENT_SOCK_CLOSED;
+              return true;
+            },
+            timeout_ms);
+
+    AtLock lock = co_await exec_.lock();
+    Result result = sock_.connect(host, port, 0);
+    lock.unlock();
+    if (result != UMODEM_OK) co_return result;
+
+    result = co_await connected;
+    co_return result == UMODEM_OK && refused ? UMODEM_ERR : result;
+  }
+
+  /** @return Bytes sent, or -1 on failure. */
+  Task<int> send(span<const uint8_t> data) {
+    AtLock lock = co_await exec_.lock();
+    co_return sock_.send(data);
+  }
+
+  /**
+   * @brief Receive into @p buf, suspending until data arrives.
+   *
+   * @return Bytes received, 0 after @p timeout_ms, or -1 on failure.
+   */
+  Task<int> recv(span<uint8_t> buf, uint32_t timeout_ms) {
+    int fd = sock_.fd();
+    auto arrived =
+        exec_.event(UMODEM_EVENT_MASK(UMODEM_EVENT_SOCK_DATA_RECEIVED),
+            [fd](const Event& event) { return event.socket() == fd; },
+            timeout_ms);
+
+    int len;
+    {
+      AtLock lock = co_await exec_.lock();
+      len = sock_.recv(buf);
+    }
+    if (len != 0 || co_await arrived != UMODEM_OK) co_return len;
+
+    AtLock lock = co_await exec_.lock();
+    co_return sock_.recv(buf);
+  }
+
+  Task<Result> close() {
+    AtLock lock = co_await exec_.lock();
+    co_return sock_.close();
+  }
+
+ private:
+  Executor& exec_;
+  umodem::Socket sock_;
+};
+
+/** @brief MQTT session whose publishes suspend until acknowledged. */
+class MqttSession {
+ public:
+  MqttSession(Executor& exec, umodem::MqttSession&& session) noexcept
+      : exec_(exec), session_(std::move(session)) {}
+
+  explicit operator bool() const noexcept { return bool(session_); }
+  int id() const noexcept { return session_.id(); }
+
+  /**
+   * @brief Publish and suspend until the modem reports the message sent
+   * (+QMTPUB). @p topic must stay valid until then.
+   *
+   * @return UMODEM_OK, an error code, or UMODEM_TIMEOUT after
+   *         @p timeout_ms, including when delivery failed.
+   */
+  Task<Result> publish(std::string_view topic, span<const uint8_t> payload,
+      umodem_mqtt_qos_t qos = UMODEM_MQTT_QOS_0, bool retain = false,
+      uint32_t timeout_ms = UMODEM_CMD_TIMEOUT_MS) {
+    // The driver reports the topic pointer it was given
+    int id = session_.id();
+    auto published =
+        exec_.event(UMODEM_EVENT_MASK(UMODEM_EVENT_MQTT_DATA_PUBLISHED),
+            [id, topic](const Event& event) {
+              MqttMessage msg;
+              return event.mqtt(msg) && msg.session == id &&
+                     msg.topic.data() == topic.data();
+            },
+            timeout_ms);
+
+    AtLock lock = co_await exec_.lock();
+    Result result = session_.publish(topic, payload, qos, retain);
+    lock.unlock();
+    if (result != UMODEM_OK) co_return result;
+
+    co_return co_await published;
+  }
+
+  /** @brief The driver keeps referring to @p topic while subscribed. */
+  Task<Result> subscribe(
+      std::string_view topic, umodem_mqtt_qos_t qos = UMODEM_MQTT_QOS_0) {
+    AtLock lock = co_await exec_.lock();
+    co_return session_.subscribe(topic, qos);
+  }
+
+  Task<Result> disconnect() {
+    AtLock lock = co_await exec_.lock();
+    co_return session_.disconnect();
+  }
+
+ private:
+  Executor& exec_;
+  umodem::MqttSession session_;
+};
+
+} // namespace umodem::co
+
+#endif
@@ -70,6 +70,148 @@ int umodem_sock_recv(int sockfd, void* buf, size_t len) {
   return g_umodem_driver->sock_driver->sock_recv(sockfd, buf, len);
 }
 
+int umodem_sock_sendto(int sockfd, const void* data, size_t len,
+    const char* host, size_t host_len, uint16_t port) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_sendto)
+    return -1;
+  return g_umodem_driver->sock_driver->sock_sendto(
+      sockfd, data, len, host, host_len, port);
+}
+
+int umodem_sock_recvfrom(
+    int sockfd, void* buf, size_t len, umodem_sock_addr_t* from) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_recvfrom)
+    return -1;
+  return g_umodem_driver->sock_driver->sock_recvfrom(sockfd, buf, len, from);
+}
+
+umodem_result_t umodem_sock_listen(
+    umodem_sock_type_t type, uint16_t port, int max_conns) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_listen)
+    return UMODEM_ERR;
+  return g_umodem_driver->sock_driver->sock_listen(type, port, max_conns);
+}
+
+int umodem_sock_accept(void) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_accept)
+    return -1;
+  return g_umodem_driver->sock_driver->sock_accept();
+}
+
+umodem_result_t umodem_sock_unlisten(void) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_unlisten)
+    return UMODEM_ERR;
+  return g_umodem_driver->sock_driver->sock_unlisten();
+}
+
+umodem_result_t umodem_sock_set_coalesce(
+    int sockfd, size_t threshold, uint32_t delay_ms) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_set_coalesce)
+    return UMODEM_ERR;
+  return g_umodem_driver->sock_driver->sock_set_coalesce(
+      sockfd, threshold, delay_ms);
+}
+
+umodem_result_t umodem_sock_set_nodelay(int sockfd, int enable) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_set_nodelay)
+    return UMODEM_ERR;
+  return g_umodem_driver->sock_driver->sock_set_nodelay(sockfd, enable);
+}
+
+umodem_result_t umodem_sock_flush(int sockfd) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_flush)
+    return UMODEM_ERR;
+  return g_umodem_driver->sock_driver->sock_flush(sockfd);
+}
+
+umodem_result_t umodem_sock_resolve(const char* host, size_t host_len,
+    char* ip, size_t ip_size, uint32_t timeout_ms) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->sock_resolve)
+    return UMODEM_ERR;
+  return g_umodem_driver->sock_driver->sock_resolve(
+      host, host_len, ip, ip_size, timeout_ms);
+}
+
+umodem_result_t umodem_sock_get_dns_stats(umodem_dns_stats_t* stats) {
+  if (!stats) return UMODEM_PARAM;
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->sock_driver->dns_get_stats)
+    return UMODEM_ERR;
+  g_umodem_driver->sock_driver->dns_get_stats(stats);
+  return UMODEM_OK;
+}
+
+void umodem_sock_dns_flush(void) {
+  if (g_umodem_driver && g_umodem_driver->sock_driver &&
+      g_umodem_driver->sock_driver->dns_flush)
+    g_umodem_driver->sock_driver->dns_flush();
+}
+
+umodem_result_t umodem_sock_transparent_open(const char* host,
+    size_t host_len, uint16_t port, uint32_t timeout_ms) {
+  if (!g_umodem_driver || !g_umodem_driver->sock_driver ||
+      !g_umodem_driver->umodem_initialized ||
+      !g_umodem_driver->sock_driver->transparent_open ||
+      umodem_at_raw_ring())
+    return UMODEM_ERR;
+
+  umodem_result_t result = g_umodem_driver->sock_driver->transparent_open(
+      host, host_len, port, timeout_ms);
+  if (result == UMODEM_OK) umodem_at_set_raw(UMODEM_AT_CH_DATA, 1);
+  return result;
+}
+
+int umodem_sock_transparent_send(const void* data, size_t len) {
+  if (!umodem_at_raw_ring() || !data) return -1;
+  if (len == 0) return 0;
+  return umodem_at_write_on(UMODEM_AT_CH_DATA, data, len);
+}
+
+int umodem_sock_transparent_recv(void* buf, size_t len) {
+  if (!umodem_at_raw_ring() || !buf) return -1;
+
+  umodem_poll();
+
+  umodem_hal_lock();
+  umodem_ring_t* ring = umodem_at_raw_ring();
+  size_t n = ring ? umodem_ring_get_count(ring) : 0;
+  if (n > len) n = len;
+  if (n > 0) umodem_ring_pop(ring, buf, n);
+  umodem_hal_unlock();
+  return (int)n;
+}
+
+umodem_result_t umodem_sock_transparent_close(void) {
+  if (!umodem_at_raw_ring()) return UMODEM_OK;
+
+  // Whatever is left would read as garbage in command mode
+  umodem_hal_lock();
+  umodem_ring_flush(umodem_at_raw_ring());
+  umodem_hal_unlock();
+  umodem_at_set_raw(UMODEM_AT_CH_DATA, 0);
+
+  if (!g_umodem_driver->sock_driver->transparent_close) return UMODEM_OK;
+  return g_umodem_driver->sock_driver->transparent_close();
+}
+
 umodem_result_t umodem_mqtt_init(void) {
   if (g_umodem_driver == NULL || g_umodem_driver->mqtt_driver == NULL ||
       g_umodem_driver->umodem_initialized == 0)
@@ -99,11 +241,12 @@ int umodem_mqtt_connect(
   uint32_t rand_num = umodem_rand() % 10000; // 0–9999
 
   // Format: "<user_client_id>_<rand>"
-  int len = snprintf(final_client_id, sizeof(final_client_id), "%s_%lu",
-      opts->client_id, (unsigned long)rand_num);
-
-  if (len <= 0 || (size_t)len >= sizeof(final_client_id))
-    return UMODEM_ERR; // buffer overflow
+  umodem_at_cmd_t id;
+  umodem_at_cmd_init(&id, final_client_id, sizeof(final_client_id));
+  umodem_at_cmd_str(&id, opts->client_id);
+  umodem_at_cmd_str(&id, "_");
+  umodem_at_cmd_uint(&id, rand_num);
+  if (!umodem_at_cmd_end(&id)) return UMODEM_ERR; // buffer overflow
 
   umodem_mqtt_connect_opts_t modified_opts = *opts;
   modified_opts.client_id = final_client_id;
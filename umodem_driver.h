@@ -3,6 +3,7 @@
 
 #include "umodem.h"
 
+#include "umodem_http.h"
 #include "umodem_mqtt.h"
 #include "umodem_sock.h"
 #include "umodem_event.h"
@@ -21,6 +22,34 @@ struct umodem_event {
   void* data;
 };
 
+/** @brief URC handler function signature.
+ *
+ * @param buf Pointer to the complete URC line (including trailing CR LF)
+ * @param len Length of the URC line
+ *
+ * @return umodem_event_t structure with event information
+ */
+typedef umodem_event_t (*umodem_urc_handler_t)(const char* buf, size_t len);
+
+/** @brief URC dispatch table entry.
+ *
+ * A line is matched on its key: the text following an optional "<n>, "
+ * connection index, up to and including the first ':' (or up to the end of
+ * the line when there is no ':'). For example "0, CONNECT OK" has the key
+ * "CONNECT OK" and "+QIRDI: 0,1,0" has the key "+QIRDI:".
+ */
+typedef struct {
+  /** @brief Key the line must match exactly */
+  const char* key;
+  /** @brief Length of the key */
+  uint8_t key_len;
+  /** @brief Handler invoked with the full line */
+  umodem_urc_handler_t handler;
+} umodem_urc_entry_t;
+
+/** @brief Declare a URC table entry from a string literal key. */
+#define UMODEM_URC(key, handler) {(key), sizeof(key) - 1, (handler)}
+
 /** @brief Socket driver interface for modem.
  *
  * Provides function pointers for socket operations.
@@ -85,9 +114,148 @@ typedef struct {
    * @return Number of bytes received on success, -1 on failure
    */
   int (*sock_recv)(int sockfd, uint8_t* buf, size_t len);
+
+  /** @brief Send one datagram on a UDP socket (optional, may be NULL).
+   *
+   * @param sockfd Socket file descriptor
+   * @param data Pointer to the datagram
+   * @param len Length of the datagram
+   * @param host Destination (IP address or hostname)
+   * @param host_len Length of the host string
+   * @param port Destination port
+   *
+   * @return Number of bytes sent on success, -1 on failure
+   */
+  int (*sock_sendto)(int sockfd, const uint8_t* data, size_t len,
+      const char* host, size_t host_len, uint16_t port);
+
+  /** @brief Receive one datagram and its sender (optional, may be NULL).
+   *
+   * @param sockfd Socket file descriptor
+   * @param buf Buffer to store the datagram
+   * @param len Length of the buffer, the rest of a longer datagram is lost
+   * @param from Sender address, may be NULL
+   *
+   * @return Number of bytes received, 0 if none are pending, -1 on failure
+   */
+  int (*sock_recvfrom)(
+      int sockfd, uint8_t* buf, size_t len, umodem_sock_addr_t* from);
+
+  /** @brief Start accepting inbound connections (optional, may be NULL).
+   *
+   * Accepted connections are reported with UMODEM_EVENT_SOCK_ACCEPTED.
+   *
+   * @param type Socket type
+   * @param port Local port
+   * @param max_conns Connections accepted at the same time
+   *
+   * @return UMODEM_OK once listening, error code otherwise
+   */
+  umodem_result_t (*sock_listen)(
+      umodem_sock_type_t type, uint16_t port, int max_conns);
+
+  /** @brief Take the next inbound connection not returned yet.
+   *
+   * @return Socket file descriptor, 0 if none is waiting, -1 if not
+   *         listening
+   */
+  int (*sock_accept)(void);
+
+  /** @brief Stop listening and close every inbound connection.
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*sock_unlisten)(void);
+
+  /** @brief Coalesce small sends (optional, may be NULL).
+   *
+   * @param sockfd Socket file descriptor
+   * @param threshold Bytes buffered before they are sent, 0 disables
+   * @param delay_ms Time the first buffered byte waits at most
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*sock_set_coalesce)(
+      int sockfd, size_t threshold, uint32_t delay_ms);
+
+  /** @brief Bypass the coalescing buffer (optional, may be NULL).
+   *
+   * @param sockfd Socket file descriptor
+   * @param enable Non-zero to send every write at once
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*sock_set_nodelay)(int sockfd, int enable);
+
+  /** @brief Send the coalesced bytes now (optional, may be NULL).
+   *
+   * @param sockfd Socket file descriptor
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*sock_flush)(int sockfd);
+
+  /** @brief Resolve a hostname, through the driver's DNS cache.
+   *
+   * @param host Hostname
+   * @param host_len Length of the hostname
+   * @param ip Buffer for the dotted address
+   * @param ip_size Size of the buffer
+   * @param timeout_ms Query timeout in milliseconds
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*sock_resolve)(const char* host, size_t host_len, char* ip,
+      size_t ip_size, uint32_t timeout_ms);
+
+  /** @brief Get the DNS cache counters.
+   *
+   * @param stats Counters to fill
+   */
+  void (*dns_get_stats)(umodem_dns_stats_t* stats);
+
+  /** @brief Drop every DNS cache entry. */
+  void (*dns_flush)(void);
+
+  /** @brief Open a TCP connection and switch the data channel to
+   * transparent mode. The core marks the channel raw once this succeeds.
+   *
+   * @param host Remote host (IP address or hostname)
+   * @param host_len Length of the host string
+   * @param port Remote port
+   * @param timeout_ms Connection timeout in milliseconds
+   *
+   * @return UMODEM_OK once the modem answered CONNECT, error code otherwise
+   */
+  umodem_result_t (*transparent_open)(const char* host, size_t host_len,
+      uint16_t port, uint32_t timeout_ms);
+
+  /** @brief Return the data channel to command mode and close the
+   * transparent connection. Called after the core released the channel.
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*transparent_close)(void);
 } umodem_sock_driver_t;
 
+/** @brief HTTP driver interface for modem.
+ *
+ * Runs requests on the modem's own HTTP stack. Range requests and modems
+ * without one go through the generic socket client in umodem_http.c.
+ */
 typedef struct {
+  /** @brief Run a request without a range.
+   *
+   * @param req Request, streamed to and from its callbacks
+   * @param resp Status and byte counts to fill
+   * @param unsent Set to 1 if the request failed before any of it reached
+   *               the server, 0 otherwise
+   *
+   * @return UMODEM_OK once the whole body was delivered, error code
+   *         otherwise
+   */
+  umodem_result_t (*http_request)(const umodem_http_request_t* req,
+      umodem_http_response_t* resp, int* unsent);
 } umodem_http_driver_t;
 
 typedef struct {
@@ -167,7 +335,26 @@ typedef struct {
       int sockfd, const char* topic, size_t topic_len);
 } umodem_mqtt_driver_t;
 
+/** @brief PPP driver interface for modem.
+ *
+ * Provides function pointers to switch the data channel between command
+ * mode and PPP data mode. Framing and negotiation live in umodem_ppp.c.
+ */
 typedef struct {
+  /** @brief Define the packet data context and dial it.
+   *
+   * Must return once the modem answered CONNECT, leaving the first frames
+   * it sends in the data channel's ring.
+   *
+   * @return UMODEM_OK on CONNECT, error code otherwise
+   */
+  umodem_result_t (*ppp_dial)(void);
+
+  /** @brief Leave data mode and hang up the call.
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*ppp_hangup)(void);
 } umodem_ppp_driver_t;
 
 /** @brief uModem driver structure.
@@ -217,14 +404,55 @@ typedef struct {
    */
   umodem_result_t (*get_signal)(int* rssi, int* ber);
 
-  /** @brief URC handler function pointer.
+  /** @brief Query the network registration status (optional, may be NULL).
+   *
+   * @param stat Pointer to store the <stat> value of +CREG
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*get_registration)(int* stat);
+
+  /** @brief Switch the modem and the HAL to a new UART rate (optional, may
+   * be NULL).
+   *
+   * Verifies the link at the new rate and restores the current one when
+   * that fails.
+   *
+   * @param current Rate currently in effect
+   * @param baudrate New rate
+   *
+   * @return UMODEM_OK on success, UMODEM_ERR if the current rate is in
+   *         effect again, UMODEM_TIMEOUT if the link is lost
+   */
+  umodem_result_t (*set_baudrate)(uint32_t current, uint32_t baudrate);
+
+  /** @brief Set RTS/CTS flow control on the modem and the HAL (optional,
+   * may be NULL).
+   *
+   * @param enable Non-zero to enable, 0 to disable
+   *
+   * @return UMODEM_OK on success, error code otherwise
+   */
+  umodem_result_t (*set_flow_control)(int enable);
+
+  /** @brief Periodic driver work (optional, may be NULL).
    *
-   * @param buf Pointer to URC string buffer
-   * @param len Length of the URC string
+   * Called from umodem_poll() once the modem is initialized.
    *
-   * @return umodem_event_t structure with event information
+   * @param now_ms Current time from umodem_hal_millis()
+   *
+   * @return Milliseconds until the driver's next deadline, or
+   *         UMODEM_POLL_INFINITE if it has none
    */
-  umodem_event_t (*handle_urc)(const char* buf, size_t len);
+  uint32_t (*poll)(uint32_t now_ms);
+
+  /** @brief URC dispatch table, looked up by the core with one hash probe
+   * per received line.
+   */
+  const umodem_urc_entry_t* urc_table;
+
+  /** @brief Number of entries in urc_table */
+  size_t urc_count;
 
   /** @brief Socket driver interface */
   const umodem_sock_driver_t* sock_driver;
@@ -244,6 +472,25 @@ typedef struct {
 
 extern umodem_driver_t* g_umodem_driver;
 
+/** @brief Dispatch one received line through the active driver's URC table.
+ *
+ * @param line Pointer to the line (including trailing CR LF)
+ * @param len Length of the line
+ *
+ * @return Event produced by the matching handler, or zeroed struct if the
+ *         line is not a known URC
+ */
+umodem_event_t umodem_urc_dispatch(const char* line, size_t len);
+
+/** @brief Record a registration status reported by the modem unprompted.
+ *
+ * Called by drivers from their registration URC handler, updates the status
+ * cache read by umodem_get_status().
+ *
+ * @param stat <stat> value of +CREG
+ */
+void umodem_status_set_registration(int stat);
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,12 +13,20 @@ typedef enum {
   UMODEM_EVENT_DATA_DOWN = 1,    // Data connection deactivated
   UMODEM_EVENT_SMS_RECEIVED = 2, // New SMS received (if SMS monitoring enabled)
   UMODEM_EVENT_SOCK_CONNECTED = 3,      // Socket successfully connected
-  UMODEM_EVENT_SOCK_CLOSED = 4,         // Socket closed
+  UMODEM_EVENT_SOCK_CLOSED = 4,         // Socket closed or connect failed
   UMODEM_EVENT_SOCK_DATA_RECEIVED = 5,  // Data available to read on socket
   UMODEM_EVENT_MQTT_DATA_PUBLISHED = 6, // Data available to read on socket
   UMODEM_EVENT_MQTT_DATA_RECEIVED = 7,  // Data available to read on socket
+  UMODEM_EVENT_SOCK_ACCEPTED = 8,       // Inbound connection on a listener
+  UMODEM_EVENT_COUNT                    // Number of event flags (not an event)
 } umodem_event_flag_t;
 
+/** @brief Subscription mask bit for a single event flag. */
+#define UMODEM_EVENT_MASK(flag) (1UL << (flag))
+
+/** @brief Subscription mask matching every event flag. */
+#define UMODEM_EVENT_MASK_ALL ((1UL << UMODEM_EVENT_COUNT) - 1UL)
+
 typedef struct umodem_event umodem_event_t;
 
 typedef struct {
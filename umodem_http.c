@@ -0,0 +1,343 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "umodem_http.h"
+#include "umodem_at.h"
+#include "umodem_driver.h"
+#include "umodem_sock.h"
+
+#include "port/umodem_port.h"
+
+#define HTTP_DEFAULT_PORT 80
+#define HTTP_IDLE_WAIT_MS 20
+
+typedef enum {
+  CHUNK_SIZE,
+  CHUNK_DATA,
+  CHUNK_DATA_END,
+  CHUNK_TRAILER,
+} http_chunk_state_t;
+
+// Response body decoder of the socket path
+typedef struct {
+  const umodem_http_request_t* req;
+  umodem_http_response_t* resp;
+  uint8_t has_length;
+  uint8_t chunked;
+  uint8_t done;
+  uint8_t aborted;
+  uint32_t remaining; // Body bytes left with a Content-Length
+  http_chunk_state_t chunk_state;
+  uint32_t chunk_left;
+  char line[24];
+  size_t line_len;
+} http_body_t;
+
+// Request header, then receive window; the header block must fit
+static uint8_t http_buf[UMODEM_HTTP_CHUNK_SIZE];
+
+static int prefix_ci(const char* s, size_t len, const char* prefix) {
+  size_t n = strlen(prefix);
+  if (len < n) return 0;
+  for (size_t i = 0; i < n; i++) {
+    char c = s[i];
+    if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    if (c != prefix[i]) return 0;
+  }
+  return 1;
+}
+
+static umodem_result_t parse_url(const char* url, char* host, size_t host_size,
+    uint16_t* port, const char** path) {
+  static const char scheme[] = "http://";
+  if (strncmp(url, scheme, sizeof(scheme) - 1) != 0) return UMODEM_PARAM;
+
+  const char* p = url + sizeof(scheme) - 1;
+  size_t host_len = strcspn(p, ":/");
+  if (host_len == 0 || host_len >= host_size) return UMODEM_PARAM;
+  memcpy(host, p, host_len);
+  host[host_len] = '\0';
+  p += host_len;
+
+  *port = HTTP_DEFAULT_PORT;
+  if (*p == ':') {
+    char* end;
+    unsigned long value = strtoul(p + 1, &end, 10);
+    if (end == p + 1 || value == 0 || value > 65535) return UMODEM_PARAM;
+    *port = (uint16_t)value;
+    p = end;
+  }
+
+  *path = *p ? p : "/";
+  return **path == '/' ? UMODEM_OK : UMODEM_PARAM;
+}
+
+static void body_deliver(http_body_t* b, const uint8_t* data, size_t len) {
+  if (len == 0 || b->aborted) return;
+  b->resp->body_bytes += (uint32_t)len;
+  if (b->req->on_body && b->req->on_body(data, len, b->req->ctx) != 0)
+    b->aborted = 1;
+}
+
+// Collect one line of chunked framing, returns 1 once it is complete
+static int body_line(http_body_t* b, uint8_t c) {
+  if (c == '\n') return 1;
+  if (c != '\r' && b->line_len < sizeof(b->line) - 1)
+    b->line[b->line_len++] = (char)c;
+  return 0;
+}
+
+static void body_feed(http_body_t* b, const uint8_t* data, size_t len) {
+  if (!b->chunked) {
+    if (b->has_length) {
+      if (len > b->remaining) len = b->remaining;
+      b->remaining -= (uint32_t)len;
+      if (b->remaining == 0) b->done = 1;
+    }
+    body_deliver(b, data, len);
+    return;
+  }
+
+  for (size_t i = 0; i < len && !b->done && !b->aborted; i++) {
+    switch (b->chunk_state) {
+    case CHUNK_SIZE:
+      if (!body_line(b, data[i])) break;
+      b->line[b->line_len] = '\0';
+      b->chunk_left = (uint32_t)strtoul(b->line, NULL, 16);
+      b->line_len = 0;
+      b->chunk_state = b->chunk_left ? CHUNK_DATA : CHUNK_TRAILER;
+      break;
+
+    case CHUNK_DATA: {
+      size_t n = len - i;
+      if (n > b->chunk_left) n = b->chunk_left;
+      body_deliver(b, &data[i], n);
+      b->chunk_left -= (uint32_t)n;
+      i += n - 1;
+      if (b->chunk_left == 0) b->chunk_state = CHUNK_DATA_END;
+      break;
+    }
+
+    case CHUNK_DATA_END:
+      if (body_line(b, data[i])) {
+        b->line_len = 0;
+        b->chunk_state = CHUNK_SIZE;
+      }
+      break;
+
+    case CHUNK_TRAILER:
+      // Trailer fields are skipped up to the empty line
+      if (!body_line(b, data[i])) break;
+      if (b->line_len == 0) b->done = 1;
+      b->line_len = 0;
+      break;
+    }
+  }
+}
+
+static umodem_result_t parse_header(
+    http_body_t* b, const char* block, size_t len) {
+  const char* end = block + len;
+  const char* line = block;
+
+  // Status line: HTTP/1.x NNN reason
+  if (!prefix_ci(line, len, "http/1.") || len < 12) return UMODEM_ERR;
+  b->resp->status = atoi(line + 9);
+
+  while (line < end) {
+    const char* eol = memchr(line, '\n', (size_t)(end - line));
+    if (!eol) eol = end;
+    size_t line_len = (size_t)(eol - line);
+
+    if (prefix_ci(line, line_len, "content-length:")) {
+      b->has_length = 1;
+      b->remaining = (uint32_t)strtoul(line + 15, NULL, 10);
+      b->resp->content_length = b->remaining;
+    } else if (prefix_ci(line, line_len, "transfer-encoding:")) {
+      b->chunked = UMODEM_MEMMEM(line, line_len, "chunked", 7) != NULL;
+    } else if (prefix_ci(line, line_len, "content-range:")) {
+      const char* slash = memchr(line, '/', line_len);
+      if (slash) b->resp->total_length = (uint32_t)strtoul(slash + 1, NULL, 10);
+    }
+    line = eol + 1;
+  }
+
+  // A chunked body overrides any Content-Length
+  if (b->chunked) b->has_length = 0;
+  if (b->has_length && b->remaining == 0) b->done = 1;
+  return UMODEM_OK;
+}
+
+static umodem_result_t send_all(int sockfd, const uint8_t* data, size_t len) {
+  while (len > 0) {
+    size_t n = len < UMODEM_HTTP_CHUNK_SIZE ? len : UMODEM_HTTP_CHUNK_SIZE;
+    int sent = umodem_sock_send(sockfd, data, n);
+    if (sent <= 0) return UMODEM_ERR;
+    data += sent;
+    len -= (size_t)sent;
+  }
+  return UMODEM_OK;
+}
+
+static umodem_result_t send_request(
+    int sockfd, const umodem_http_request_t* req, const char* host,
+    const char* path) {
+  int post = req->method == UMODEM_HTTP_POST;
+
+  // Same bounded builder as the AT commands
+  umodem_at_cmd_t b;
+  umodem_at_cmd_init(&b, (char*)http_buf, sizeof(http_buf));
+  umodem_at_cmd_str(&b, post ? "POST " : "GET ");
+  umodem_at_cmd_str(&b, path);
+  umodem_at_cmd_str(&b, " HTTP/1.1\r\nHost: ");
+  umodem_at_cmd_str(&b, host);
+  umodem_at_cmd_str(&b,
+      "\r\nUser-Agent: uModem\r\nAccept-Encoding: identity\r\n"
+      "Connection: close\r\n");
+  if (req->range_start || req->range_end) {
+    umodem_at_cmd_str(&b, "Range: bytes=");
+    umodem_at_cmd_uint(&b, req->range_start);
+    umodem_at_cmd_str(&b, "-");
+    if (req->range_end) umodem_at_cmd_uint(&b, req->range_end);
+    umodem_at_cmd_str(&b, "\r\n");
+  }
+  if (post) {
+    umodem_at_cmd_str(&b, "Content-Type: ");
+    umodem_at_cmd_str(&b,
+        req->content_type ? req->content_type : "application/octet-stream");
+    umodem_at_cmd_str(&b, "\r\nContent-Length: ");
+    umodem_at_cmd_uint(&b, (unsigned long)req->body_len);
+    umodem_at_cmd_str(&b, "\r\n");
+  }
+  umodem_at_cmd_str(&b, "\r\n");
+  const char* hdr = umodem_at_cmd_end(&b);
+  if (!hdr) return UMODEM_PARAM;
+
+  if (send_all(sockfd, http_buf, strlen(hdr)) != UMODEM_OK) return UMODEM_ERR;
+  if (!post) return UMODEM_OK;
+
+  // Body, straight from the caller's buffer or pulled from the source
+  if (!req->body_source)
+    return send_all(sockfd, req->body, req->body_len);
+
+  for (size_t left = req->body_len; left > 0;) {
+    size_t want = left < sizeof(http_buf) ? left : sizeof(http_buf);
+    int got = req->body_source(http_buf, want, req->ctx);
+    if (got <= 0 || (size_t)got > want) return UMODEM_ERR;
+    if (send_all(sockfd, http_buf, (size_t)got) != UMODEM_OK)
+      return UMODEM_ERR;
+    left -= (size_t)got;
+  }
+  return UMODEM_OK;
+}
+
+static umodem_result_t receive_response(int sockfd,
+    const umodem_http_request_t* req, umodem_http_response_t* resp,
+    uint32_t start) {
+  http_body_t body = {.req = req, .resp = resp};
+  int header_done = 0;
+  size_t have = 0;
+
+  while (!body.done) {
+    if (body.aborted) return UMODEM_ERR;
+    if (umodem_hal_millis() - start > req->timeout_ms) return UMODEM_TIMEOUT;
+
+    int n = umodem_sock_recv(sockfd, http_buf + have, sizeof(http_buf) - have);
+    if (n < 0) {
+      // Without a length or chunks the body ends with the connection
+      if (header_done && !body.has_length && !body.chunked) break;
+      return UMODEM_ERR;
+    }
+    if (n == 0) {
+      umodem_poll();
+      umodem_hal_wait_rx(HTTP_IDLE_WAIT_MS);
+      continue;
+    }
+    have += (size_t)n;
+
+    if (header_done) {
+      body_feed(&body, http_buf, have);
+      have = 0;
+      continue;
+    }
+
+    const char* end = UMODEM_MEMMEM(http_buf, have, "\r\n\r\n", 4);
+    if (!end) {
+      if (have == sizeof(http_buf)) return UMODEM_ERR; // Header too large
+      continue;
+    }
+
+    size_t header_len = (size_t)((const uint8_t*)end - http_buf) + 4;
+    if (parse_header(&body, (const char*)http_buf, header_len) != UMODEM_OK)
+      return UMODEM_ERR;
+    header_done = 1;
+    body_feed(&body, http_buf + header_len, have - header_len);
+    have = 0;
+  }
+
+  if (body.aborted) return UMODEM_ERR;
+  if (!body.has_length) resp->content_length = resp->body_bytes;
+  return UMODEM_OK;
+}
+
+static umodem_result_t http_socket_request(const umodem_http_request_t* req,
+    umodem_http_response_t* resp, uint32_t start) {
+  char host[64];
+  uint16_t port;
+  const char* path;
+  umodem_result_t result =
+      parse_url(req->url, host, sizeof(host), &port, &path);
+  if (result != UMODEM_OK) return result;
+
+  resp->via_socket = 1;
+
+  int sockfd = umodem_sock_create(UMODEM_SOCK_TCP);
+  if (sockfd < 0) return UMODEM_ERR;
+
+  result = umodem_sock_connect(
+      sockfd, host, strlen(host), port, req->timeout_ms);
+  if (result == UMODEM_OK) result = send_request(sockfd, req, host, path);
+  if (result == UMODEM_OK)
+    result = receive_response(sockfd, req, resp, start);
+
+  umodem_sock_close(sockfd);
+  return result;
+}
+
+umodem_result_t umodem_http_request(
+    const umodem_http_request_t* req, umodem_http_response_t* resp) {
+  if (!req || !req->url || !resp || req->timeout_ms == 0) return UMODEM_PARAM;
+  if (req->method == UMODEM_HTTP_POST && req->body_len > 0 && !req->body &&
+      !req->body_source)
+    return UMODEM_PARAM;
+
+  memset(resp, 0, sizeof(*resp));
+  if (!g_umodem_driver || !g_umodem_driver->umodem_initialized)
+    return UMODEM_ERR;
+
+  const umodem_http_driver_t* drv = g_umodem_driver->http_driver;
+  int ranged = req->range_start != 0 || req->range_end != 0;
+  uint32_t start = umodem_hal_millis();
+  umodem_result_t result;
+
+  if (drv && drv->http_request && !ranged) {
+    int unsent = 0;
+    result = drv->http_request(req, resp, &unsent);
+
+    // Retry over a socket only what the server cannot have seen: a GET
+    // the modem refused up front. A POST is never sent twice.
+    if (result == UMODEM_ERR && unsent && req->method == UMODEM_HTTP_GET &&
+        strncmp(req->url, "http://", 7) == 0) {
+      memset(resp, 0, sizeof(*resp));
+      result = http_socket_request(req, resp, start);
+    }
+  } else {
+    result = http_socket_request(req, resp, start);
+  }
+
+  resp->elapsed_ms = umodem_hal_millis() - start;
+  if (resp->elapsed_ms > 0)
+    resp->bytes_per_s =
+        (uint32_t)((uint64_t)resp->body_bytes * 1000 / resp->elapsed_ms);
+  return result;
+}
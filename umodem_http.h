@@ -0,0 +1,103 @@
+#ifndef uMODEM_HTTP_H_
+#define uMODEM_HTTP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "umodem_config.h"
+#include "umodem_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * HTTP client.
+ *
+ * umodem_http_request() runs a request with the modem's HTTP stack when the
+ * driver provides one, and otherwise over a TCP socket (umodem_sock.h). The
+ * socket path is also used for range requests, which the modem's HTTP AT
+ * commands cannot express, and for a GET the modem's stack refused before
+ * sending it.
+ * The socket path speaks plain http:// only.
+ *
+ * Bodies are never buffered whole: the response body is handed to the
+ * on_body callback in chunks of up to UMODEM_HTTP_CHUNK_SIZE bytes as it
+ * arrives, and a POST body can be pulled from a source callback.
+ *
+ * The data context must be up first (umodem_sock_init()). One request runs
+ * at a time.
+ */
+
+typedef enum {
+  UMODEM_HTTP_GET,
+  UMODEM_HTTP_POST,
+} umodem_http_method_t;
+
+/**
+   * @brief Response body chunk callback.
+   *
+   * @return 0 to continue, non-zero to abort the transfer.
+   */
+typedef int (*umodem_http_body_cb_t)(
+    const uint8_t* data, size_t len, void* ctx);
+
+/**
+   * @brief Request body source callback.
+   *
+   * Fills up to @p len bytes of the body.
+   *
+   * @return Number of bytes written to @p buf, or a negative value to abort.
+   */
+typedef int (*umodem_http_source_cb_t)(uint8_t* buf, size_t len, void* ctx);
+
+typedef struct {
+  umodem_http_method_t method;
+  const char* url; // "http://host[:port]/path", or https:// on the modem
+
+  // POST body: body_len bytes from body, or from body_source when set
+  const char* content_type; // Defaults to application/octet-stream
+  const uint8_t* body;
+  size_t body_len;
+  umodem_http_source_cb_t body_source;
+
+  // Range request "bytes=range_start-range_end" when either is non-zero,
+  // range_end inclusive, 0 for the end of the resource
+  uint32_t range_start;
+  uint32_t range_end;
+
+  umodem_http_body_cb_t on_body; // Optional, the body is discarded if NULL
+  void* ctx;
+
+  uint32_t timeout_ms; // For the whole request, must not be 0
+} umodem_http_request_t;
+
+typedef struct {
+  int status;              // HTTP status code, 200 from the modem's stack
+  uint32_t content_length; // Body length announced, or received if unknown
+  uint32_t total_length;   // Resource size from Content-Range, 0 if unknown
+  uint32_t body_bytes;     // Bytes handed to on_body
+  uint32_t elapsed_ms;     // Request start to the last body byte
+  uint32_t bytes_per_s;    // Body throughput
+  uint8_t via_socket;      // Served by the socket path
+} umodem_http_response_t;
+
+/**
+   * @brief Run an HTTP request.
+   *
+   * @param req   Request description.
+   * @param resp  Filled with the status and transfer statistics, also on
+   *              failure.
+   *
+   * @return UMODEM_OK once the whole body was received (any status code),
+   *         UMODEM_ERR if the transfer failed or was aborted by a callback,
+   *         UMODEM_TIMEOUT if it did not complete in time.
+   */
+umodem_result_t umodem_http_request(
+    const umodem_http_request_t* req, umodem_http_response_t* resp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,130 @@
+#include <string.h>
+
+#include "umodem_metrics.h"
+
+#if UMODEM_METRICS_ENABLE
+
+#include "port/umodem_port.h"
+
+static umodem_metrics_t metrics;
+
+// Histogram bucket of a latency: linear below UMODEM_METRICS_HIST_SUB ms,
+// then UMODEM_METRICS_HIST_SUB sub-buckets per power of two
+static size_t bucket_of(uint32_t ms) {
+  if (ms < UMODEM_METRICS_HIST_SUB) return ms;
+
+  unsigned exp = 31;
+  while (!(ms & (1UL << exp))) exp--;
+
+  size_t bucket = UMODEM_METRICS_HIST_SUB +
+                  (exp - UMODEM_METRICS_HIST_SUB_BITS) * UMODEM_METRICS_HIST_SUB +
+                  ((ms >> (exp - UMODEM_METRICS_HIST_SUB_BITS)) &
+                      (UMODEM_METRICS_HIST_SUB - 1));
+  return bucket < UMODEM_METRICS_HIST_BUCKETS ? bucket
+                                              : UMODEM_METRICS_HIST_BUCKETS - 1;
+}
+
+uint32_t umodem_metrics_bucket_floor_ms(size_t bucket) {
+  if (bucket < UMODEM_METRICS_HIST_SUB) return (uint32_t)bucket;
+
+  size_t k = bucket - UMODEM_METRICS_HIST_SUB;
+  unsigned exp = (unsigned)(k / UMODEM_METRICS_HIST_SUB);
+  return (uint32_t)((UMODEM_METRICS_HIST_SUB + k % UMODEM_METRICS_HIST_SUB)
+                    << exp);
+}
+
+uint32_t umodem_metrics_percentile_ms(
+    const umodem_metrics_cmd_t* cmd, unsigned percent) {
+  if (!cmd || cmd->count == 0) return 0;
+  if (percent > 100) percent = 100;
+
+  uint64_t rank = ((uint64_t)cmd->count * percent + 99) / 100;
+  if (rank == 0) rank = 1;
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < UMODEM_METRICS_HIST_BUCKETS; i++) {
+    seen += cmd->hist[i];
+    if (seen >= rank) return umodem_metrics_bucket_floor_ms(i);
+  }
+  return cmd->latency_max_ms;
+}
+
+// Group key of a command: "AT+QISEND=0,5\r" -> "AT+QISEND"
+static void command_prefix(const char* cmd, char* prefix) {
+  if (!cmd || (cmd[0] != 'A' && cmd[0] != 'a') ||
+      (cmd[1] != 'T' && cmd[1] != 't')) {
+    strcpy(prefix, "DATA");
+    return;
+  }
+
+  size_t len = 0;
+  while (len < UMODEM_METRICS_PREFIX_LEN - 1 && cmd[len] &&
+         !strchr("=?;\r\n", cmd[len]))
+    len++;
+  memcpy(prefix, cmd, len);
+  prefix[len] = '\0';
+}
+
+void umodem_metrics_record_at(
+    const char* cmd, uint32_t latency_ms, umodem_result_t result) {
+  char prefix[UMODEM_METRICS_PREFIX_LEN];
+  command_prefix(cmd, prefix);
+
+  umodem_hal_lock();
+
+  umodem_metrics_cmd_t* entry = NULL;
+  for (size_t i = 0; i < metrics.cmd_count; i++) {
+    if (strcmp(metrics.cmds[i].prefix, prefix) == 0) {
+      entry = &metrics.cmds[i];
+      break;
+    }
+  }
+  if (!entry && metrics.cmd_count < UMODEM_METRICS_MAX_COMMANDS) {
+    entry = &metrics.cmds[metrics.cmd_count++];
+    memcpy(entry->prefix, prefix, sizeof(prefix));
+  }
+
+  if (!entry) {
+    metrics.cmd_untracked++;
+  } else {
+    entry->count++;
+    if (result == UMODEM_TIMEOUT)
+      entry->timeouts++;
+    else if (result != UMODEM_OK)
+      entry->errors++;
+
+    entry->latency_sum_ms += latency_ms;
+    if (latency_ms > entry->latency_max_ms) entry->latency_max_ms = latency_ms;
+    entry->hist[bucket_of(latency_ms)]++;
+  }
+
+  umodem_hal_unlock();
+}
+
+// RX hooks run inside umodem_buffer_push(), already under the HAL lock
+void umodem_metrics_record_rx(size_t len) { metrics.rx_bytes += len; }
+
+void umodem_metrics_record_ring_drop(size_t len) { metrics.ring_drops += len; }
+
+void umodem_metrics_record_event_drop(void) { metrics.event_drops++; }
+
+void umodem_metrics_record_tx(size_t len) {
+  umodem_hal_lock();
+  metrics.tx_bytes += len;
+  umodem_hal_unlock();
+}
+
+void umodem_metrics_snapshot(umodem_metrics_t* out) {
+  if (!out) return;
+  umodem_hal_lock();
+  memcpy(out, &metrics, sizeof(metrics));
+  umodem_hal_unlock();
+}
+
+void umodem_metrics_reset(void) {
+  umodem_hal_lock();
+  memset(&metrics, 0, sizeof(metrics));
+  umodem_hal_unlock();
+}
+
+#endif
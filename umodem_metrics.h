@@ -0,0 +1,124 @@
+#ifndef uMODEM_METRICS_H_
+#define uMODEM_METRICS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "umodem_config.h"
+#include "umodem_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Optional runtime metrics, enabled with UMODEM_METRICS_ENABLE.
+ *
+ * AT commands are grouped by prefix (the command up to '=', '?' or CR, e.g.
+ * "AT+QISEND"); each group keeps outcome counters and a log-linear latency
+ * histogram. Raw writes that are not AT commands (payloads, Ctrl-Z) are
+ * grouped under "DATA".
+ *
+ * When disabled, the recording macros expand to nothing and the snapshot
+ * API is not compiled.
+ */
+
+/** @brief Linear buckets below 2^UMODEM_METRICS_HIST_SUB_BITS ms, then
+ *  2^UMODEM_METRICS_HIST_SUB_BITS sub-buckets per power of two. */
+#define UMODEM_METRICS_HIST_SUB_BITS 2
+#define UMODEM_METRICS_HIST_SUB (1u << UMODEM_METRICS_HIST_SUB_BITS)
+
+/** @brief Number of histogram buckets, the last one also counts every
+ *  latency above 2^UMODEM_METRICS_HIST_MAX_EXP ms. */
+#define UMODEM_METRICS_HIST_BUCKETS                                            \
+  (UMODEM_METRICS_HIST_SUB +                                                   \
+      (UMODEM_METRICS_HIST_MAX_EXP - UMODEM_METRICS_HIST_SUB_BITS + 1) *       \
+          UMODEM_METRICS_HIST_SUB)
+
+#if UMODEM_METRICS_ENABLE
+
+/**
+   * @brief Counters of one AT command prefix.
+   */
+typedef struct {
+  char prefix[UMODEM_METRICS_PREFIX_LEN]; // e.g. "AT+QMTPUB"
+  uint32_t count;                         // Commands completed
+  uint32_t errors;                        // ERROR / +CME ERROR / send failure
+  uint32_t timeouts;                      // No final result in time
+  uint32_t latency_max_ms;
+  uint64_t latency_sum_ms;
+  uint32_t hist[UMODEM_METRICS_HIST_BUCKETS];
+} umodem_metrics_cmd_t;
+
+/**
+   * @brief Snapshot of all metrics.
+   */
+typedef struct {
+  umodem_metrics_cmd_t cmds[UMODEM_METRICS_MAX_COMMANDS];
+  size_t cmd_count;
+  uint32_t cmd_untracked; // Commands not recorded because the table is full
+
+  uint64_t rx_bytes;    // Bytes received into the RX buffer
+  uint64_t tx_bytes;    // Bytes written to the modem
+  uint64_t ring_drops;  // Unread RX bytes overwritten by newer data
+  uint32_t event_drops; // Events discarded because the queue was full
+} umodem_metrics_t;
+
+/**
+   * @brief Copy the current metrics.
+   *
+   * @param out Destination, filled atomically with respect to the library.
+   */
+void umodem_metrics_snapshot(umodem_metrics_t* out);
+
+/**
+   * @brief Clear all counters and command groups.
+   */
+void umodem_metrics_reset(void);
+
+/**
+   * @brief Lower bound of a histogram bucket in milliseconds.
+   */
+uint32_t umodem_metrics_bucket_floor_ms(size_t bucket);
+
+/**
+   * @brief Estimate a latency percentile from a command's histogram.
+   *
+   * @param cmd      Command group from a snapshot.
+   * @param percent  Percentile, 0..100.
+   *
+   * @return Lower bound in ms of the bucket holding the percentile.
+   */
+uint32_t umodem_metrics_percentile_ms(
+    const umodem_metrics_cmd_t* cmd, unsigned percent);
+
+/* Recording hooks, use the UMODEM_METRICS_* macros below. */
+void umodem_metrics_record_at(
+    const char* cmd, uint32_t latency_ms, umodem_result_t result);
+void umodem_metrics_record_rx(size_t len);
+void umodem_metrics_record_tx(size_t len);
+void umodem_metrics_record_ring_drop(size_t len);
+void umodem_metrics_record_event_drop(void);
+
+#define UMODEM_METRICS_AT(cmd, latency_ms, result)                             \
+  umodem_metrics_record_at((cmd), (latency_ms), (result))
+#define UMODEM_METRICS_RX(len) umodem_metrics_record_rx(len)
+#define UMODEM_METRICS_TX(len) umodem_metrics_record_tx(len)
+#define UMODEM_METRICS_RING_DROP(len) umodem_metrics_record_ring_drop(len)
+#define UMODEM_METRICS_EVENT_DROP() umodem_metrics_record_event_drop()
+
+#else
+
+#define UMODEM_METRICS_AT(cmd, latency_ms, result) ((void)0)
+#define UMODEM_METRICS_RX(len) ((void)0)
+#define UMODEM_METRICS_TX(len) ((void)0)
+#define UMODEM_METRICS_RING_DROP(len) ((void)0)
+#define UMODEM_METRICS_EVENT_DROP() ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,758 @@
+#include <string.h>
+
+#include "umodem_ppp.h"
+
+#if UMODEM_PPP_ENABLE
+
+#include "umodem_at.h"
+#include "umodem_driver.h"
+
+#include "port/umodem_port.h"
+
+#define PPP_FLAG 0x7E
+#define PPP_ESCAPE 0x7D
+#define PPP_TRANS 0x20
+#define PPP_ALLSTATIONS 0xFF
+#define PPP_UI 0x03
+
+#define PPP_FCS_INIT 0xFFFF
+#define PPP_FCS_GOOD 0xF0B8
+
+// Protocol numbers
+#define PPP_IP 0x0021
+#define PPP_IPCP 0x8021
+#define PPP_LCP 0xC021
+#define PPP_PAP 0xC023
+
+// Control protocol codes
+#define CP_CONF_REQ 1
+#define CP_CONF_ACK 2
+#define CP_CONF_NAK 3
+#define CP_CONF_REJ 4
+#define CP_TERM_REQ 5
+#define CP_TERM_ACK 6
+#define CP_CODE_REJ 7
+#define LCP_PROTO_REJ 8
+#define LCP_ECHO_REQ 9
+#define LCP_ECHO_REP 10
+#define LCP_DISCARD_REQ 11
+
+#define PAP_AUTH_REQ 1
+#define PAP_AUTH_ACK 2
+#define PAP_AUTH_NAK 3
+
+#define LCP_OPT_MRU 1
+#define LCP_OPT_ACCM 2
+#define LCP_OPT_AUTH 3
+#define LCP_OPT_MAGIC 5
+
+#define IPCP_OPT_ADDR 3
+#define IPCP_OPT_DNS1 129
+#define IPCP_OPT_DNS2 131
+
+#define PPP_DEFAULT_MRU 1500
+#define PPP_RESTART_MS 3000
+#define PPP_MAX_CONFIGURE 10
+#define PPP_TERMINATE_MS 3000
+
+// Address, control and protocol before the information field
+#define PPP_HDR_LEN 4
+#define PPP_FCS_LEN 2
+#define PPP_CP_HDR_LEN 4
+
+typedef enum {
+  PHASE_DEAD,
+  PHASE_ESTABLISH, // LCP
+  PHASE_AUTH,      // PAP
+  PHASE_NETWORK,   // IPCP
+  PHASE_RUNNING,
+  PHASE_TERMINATE,
+} ppp_phase_t;
+
+// Negotiation state of one control protocol
+typedef struct {
+  uint8_t id;         // Identifier of our last request
+  uint8_t req_acked;  // The peer accepted our request
+  uint8_t peer_acked; // We accepted the peer's request
+  uint8_t tries;
+  uint32_t sent_ms;
+} ppp_cp_t;
+
+static volatile int ppp_active = 0;
+static umodem_ring_t* ppp_ring_ptr = NULL;
+static umodem_ppp_netif_t ppp_netif;
+static volatile ppp_phase_t phase = PHASE_DEAD;
+
+static ppp_cp_t lcp, pap, ipcp;
+static uint8_t next_id;
+static uint32_t magic;
+static uint32_t tx_accm;
+static uint16_t peer_mru;
+static uint8_t use_pap;
+static uint8_t lcp_want_mru, lcp_want_accm, lcp_want_magic;
+static uint8_t ipcp_want_dns[2];
+
+static umodem_ppp_addr_t ppp_addr;
+static umodem_ppp_stats_t ppp_stats;
+
+static uint16_t fcs_table[256];
+
+// Frame decoder, fed from umodem_ppp_poll()
+static struct {
+  uint8_t buf[PPP_HDR_LEN + UMODEM_PPP_MRU + PPP_FCS_LEN];
+  size_t len;
+  uint16_t fcs;
+  uint8_t escape;
+  uint8_t overflow;
+} rx;
+
+// Frame encoder, flushed to the data channel in chunks
+typedef struct {
+  uint8_t buf[128];
+  size_t len;
+  uint16_t fcs;
+  uint32_t accm;
+  int error;
+} ppp_tx_t;
+
+static uint16_t get_be16(const uint8_t* p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t get_be32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | p[3];
+}
+
+static size_t put_opt32(uint8_t* p, uint8_t type, uint32_t value) {
+  p[0] = type;
+  p[1] = 6;
+  p[2] = (uint8_t)(value >> 24);
+  p[3] = (uint8_t)(value >> 16);
+  p[4] = (uint8_t)(value >> 8);
+  p[5] = (uint8_t)value;
+  return 6;
+}
+
+// CRC-16/X.25, RFC 1662 appendix C
+static void fcs_init(void) {
+  for (unsigned i = 0; i < 256; i++) {
+    uint16_t v = (uint16_t)i;
+    for (int bit = 0; bit < 8; bit++)
+      v = (v & 1) ? (uint16_t)((v >> 1) ^ 0x8408) : (uint16_t)(v >> 1);
+    fcs_table[i] = v;
+  }
+}
+
+static uint16_t fcs_update(uint16_t fcs, uint8_t b) {
+  return (uint16_t)((fcs >> 8) ^ fcs_table[(fcs ^ b) & 0xFF]);
+}
+
+static void tx_flush(ppp_tx_t* tx) {
+  if (tx->len > 0 &&
+      umodem_at_write_on(UMODEM_AT_CH_DATA, tx->buf, tx->len) < 0)
+    tx->error = 1;
+  tx->len = 0;
+}
+
+static void tx_raw(ppp_tx_t* tx, uint8_t b) {
+  if (tx->len == sizeof(tx->buf)) tx_flush(tx);
+  tx->buf[tx->len++] = b;
+}
+
+static void tx_escaped(ppp_tx_t* tx, uint8_t b) {
+  if (b == PPP_FLAG || b == PPP_ESCAPE ||
+      (b < 0x20 && (tx->accm & (1UL << b)))) {
+    tx_raw(tx, PPP_ESCAPE);
+    b ^= PPP_TRANS;
+  }
+  tx_raw(tx, b);
+}
+
+static void tx_bytes(ppp_tx_t* tx, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    tx->fcs = fcs_update(tx->fcs, data[i]);
+    tx_escaped(tx, data[i]);
+  }
+}
+
+static int send_frame(uint16_t proto, const uint8_t* hdr, size_t hdr_len,
+    const uint8_t* data, size_t len) {
+  ppp_tx_t tx;
+  tx.len = 0;
+  tx.fcs = PPP_FCS_INIT;
+  tx.error = 0;
+  // LCP always goes out with the default ACCM (RFC 1662 section 7.1)
+  tx.accm = proto == PPP_LCP ? 0xFFFFFFFFUL : tx_accm;
+
+  uint8_t head[PPP_HDR_LEN] = {
+      PPP_ALLSTATIONS, PPP_UI, (uint8_t)(proto >> 8), (uint8_t)proto};
+  tx_raw(&tx, PPP_FLAG);
+  tx_bytes(&tx, head, sizeof(head));
+  if (hdr_len > 0) tx_bytes(&tx, hdr, hdr_len);
+  if (len > 0) tx_bytes(&tx, data, len);
+
+  uint16_t fcs = tx.fcs ^ 0xFFFF;
+  tx_escaped(&tx, (uint8_t)fcs);
+  tx_escaped(&tx, (uint8_t)(fcs >> 8));
+  tx_raw(&tx, PPP_FLAG);
+  tx_flush(&tx);
+  return tx.error ? -1 : 0;
+}
+
+static int send_cp(uint16_t proto, uint8_t code, uint8_t id,
+    const uint8_t* data, size_t len) {
+  uint8_t hdr[PPP_CP_HDR_LEN] = {code, id,
+      (uint8_t)((len + PPP_CP_HDR_LEN) >> 8),
+      (uint8_t)(len + PPP_CP_HDR_LEN)};
+  return send_frame(proto, hdr, sizeof(hdr), data, len);
+}
+
+static void cp_sent(ppp_cp_t* cp) {
+  cp->tries++;
+  cp->sent_ms = umodem_hal_millis();
+}
+
+static void lcp_send_request(void) {
+  uint8_t opts[16];
+  size_t len = 0;
+
+  if (lcp_want_mru) {
+    opts[len++] = LCP_OPT_MRU;
+    opts[len++] = 4;
+    opts[len++] = (uint8_t)(UMODEM_PPP_MRU >> 8);
+    opts[len++] = (uint8_t)UMODEM_PPP_MRU;
+  }
+  // No control characters need escaping on the way in
+  if (lcp_want_accm) len += put_opt32(&opts[len], LCP_OPT_ACCM, 0);
+  if (lcp_want_magic) len += put_opt32(&opts[len], LCP_OPT_MAGIC, magic);
+
+  lcp.id = ++next_id;
+  cp_sent(&lcp);
+  send_cp(PPP_LCP, CP_CONF_REQ, lcp.id, opts, len);
+}
+
+static void pap_send_request(void) {
+  const umodem_apn_t* apn = g_umodem_driver->apn;
+  const char* user = apn ? apn->user : "";
+  const char* pass = apn ? apn->pass : "";
+  size_t user_len = strnlen(user, sizeof(apn->user));
+  size_t pass_len = strnlen(pass, sizeof(apn->pass));
+
+  uint8_t data[2 + sizeof(apn->user) + sizeof(apn->pass)];
+  size_t len = 0;
+  data[len++] = (uint8_t)user_len;
+  memcpy(&data[len], user, user_len);
+  len += user_len;
+  data[len++] = (uint8_t)pass_len;
+  memcpy(&data[len], pass, pass_len);
+  len += pass_len;
+
+  pap.id = ++next_id;
+  cp_sent(&pap);
+  send_cp(PPP_PAP, PAP_AUTH_REQ, pap.id, data, len);
+}
+
+static void ipcp_send_request(void) {
+  uint8_t opts[18];
+  size_t len = 0;
+
+  len += put_opt32(
+      &opts[len], IPCP_OPT_ADDR, get_be32(ppp_addr.local_ip));
+  if (ipcp_want_dns[0])
+    len += put_opt32(&opts[len], IPCP_OPT_DNS1, get_be32(ppp_addr.dns[0]));
+  if (ipcp_want_dns[1])
+    len += put_opt32(&opts[len], IPCP_OPT_DNS2, get_be32(ppp_addr.dns[1]));
+
+  ipcp.id = ++next_id;
+  cp_sent(&ipcp);
+  send_cp(PPP_IPCP, CP_CONF_REQ, ipcp.id, opts, len);
+}
+
+static void link_down(void) {
+  int was_up = phase == PHASE_RUNNING;
+  phase = PHASE_DEAD;
+  if (was_up && ppp_netif.link) ppp_netif.link(0, ppp_netif.ctx);
+}
+
+static void enter_phase(ppp_phase_t next) {
+  phase = next;
+  if (next == PHASE_AUTH) {
+    memset(&pap, 0, sizeof(pap));
+    pap_send_request();
+  } else if (next == PHASE_NETWORK) {
+    memset(&ipcp, 0, sizeof(ipcp));
+    ipcp_send_request();
+  } else if (next == PHASE_RUNNING && ppp_netif.link) {
+    ppp_netif.link(1, ppp_netif.ctx);
+  }
+}
+
+// Walk the options of a configure packet, returns 0 if one is malformed
+typedef void (*opt_visitor_t)(
+    uint8_t type, const uint8_t* opt, uint8_t len, void* ctx);
+
+static int walk_options(
+    const uint8_t* opts, size_t len, opt_visitor_t visit, void* ctx) {
+  for (size_t pos = 0; pos < len;) {
+    if (len - pos < 2 || opts[pos + 1] < 2 || opts[pos + 1] > len - pos)
+      return 0;
+    visit(opts[pos], &opts[pos], opts[pos + 1], ctx);
+    pos += opts[pos + 1];
+  }
+  return 1;
+}
+
+// Reply being built for a peer's Configure-Request
+typedef struct {
+  uint8_t rej[64];
+  size_t rej_len;
+  uint8_t nak[16];
+  size_t nak_len;
+  uint16_t mru;
+  uint32_t accm;
+  uint8_t pap;
+  uint8_t peer_ip[4];
+} conf_reply_t;
+
+static void reply_append(
+    uint8_t* buf, size_t* buf_len, size_t cap, const uint8_t* opt, size_t len) {
+  if (*buf_len + len > cap) return;
+  memcpy(&buf[*buf_len], opt, len);
+  *buf_len += len;
+}
+
+static void lcp_check_option(
+    uint8_t type, const uint8_t* opt, uint8_t len, void* ctx) {
+  conf_reply_t* r = ctx;
+  if (type == LCP_OPT_MRU && len == 4) {
+    r->mru = get_be16(opt + 2);
+  } else if (type == LCP_OPT_ACCM && len == 6) {
+    r->accm = get_be32(opt + 2);
+  } else if (type == LCP_OPT_MAGIC && len == 6) {
+    // Accepted as is
+  } else if (type == LCP_OPT_AUTH && len == 4 && get_be16(opt + 2) == PPP_PAP) {
+    r->pap = 1;
+  } else if (type == LCP_OPT_AUTH) {
+    // Only PAP is implemented, suggest it instead
+    static const uint8_t want_pap[] = {LCP_OPT_AUTH, 4, 0xC0, 0x23};
+    reply_append(r->nak, &r->nak_len, sizeof(r->nak), want_pap, 4);
+  } else {
+    // Includes PFC / ACFC: frames keep their full header
+    reply_append(r->rej, &r->rej_len, sizeof(r->rej), opt, len);
+  }
+}
+
+static void ipcp_check_option(
+    uint8_t type, const uint8_t* opt, uint8_t len, void* ctx) {
+  conf_reply_t* r = ctx;
+  if (type == IPCP_OPT_ADDR && len == 6)
+    memcpy(r->peer_ip, opt + 2, 4);
+  else
+    reply_append(r->rej, &r->rej_len, sizeof(r->rej), opt, len);
+}
+
+// Answer a Configure-Request: reject unknown options first, then nak
+// unacceptable values, otherwise ack the request as is
+static int answer_conf_req(uint16_t proto, uint8_t id, const uint8_t* opts,
+    size_t len, opt_visitor_t check, conf_reply_t* r) {
+  if (!walk_options(opts, len, check, r)) return 0;
+
+  if (r->rej_len > 0)
+    send_cp(proto, CP_CONF_REJ, id, r->rej, r->rej_len);
+  else if (r->nak_len > 0)
+    send_cp(proto, CP_CONF_NAK, id, r->nak, r->nak_len);
+  else
+    send_cp(proto, CP_CONF_ACK, id, opts, len);
+  return r->rej_len == 0 && r->nak_len == 0;
+}
+
+static void lcp_apply_nak(
+    uint8_t type, const uint8_t* opt, uint8_t len, void* ctx) {
+  if (type == LCP_OPT_MAGIC && len == 6) magic = get_be32(opt + 2);
+}
+
+static void lcp_apply_rej(
+    uint8_t type, const uint8_t* opt, uint8_t len, void* ctx) {
+  if (type == LCP_OPT_MRU) lcp_want_mru = 0;
+  if (type == LCP_OPT_ACCM) lcp_want_accm = 0;
+  if (type == LCP_OPT_MAGIC) lcp_want_magic = 0;
+}
+
+static void ipcp_apply_nak(
+    uint8_t type, const uint8_t* opt, uint8_t len, void* ctx) {
+  if (len != 6) return;
+  if (type == IPCP_OPT_ADDR) memcpy(ppp_addr.local_ip, opt + 2, 4);
+  if (type == IPCP_OPT_DNS1) memcpy(ppp_addr.dns[0], opt + 2, 4);
+  if (type == IPCP_OPT_DNS2) memcpy(ppp_addr.dns[1], opt + 2, 4);
+}
+
+static void ipcp_apply_rej(
+    uint8_t type, const uint8_t* opt, uint8_t len, void* ctx) {
+  int* fatal = ctx;
+  if (type == IPCP_OPT_ADDR) *fatal = 1;
+  if (type == IPCP_OPT_DNS1) ipcp_want_dns[0] = 0;
+  if (type == IPCP_OPT_DNS2) ipcp_want_dns[1] = 0;
+}
+
+static void lcp_input(uint8_t code, uint8_t id, const uint8_t* data,
+    size_t len, const uint8_t* packet) {
+  switch (code) {
+  case CP_CONF_REQ: {
+    // The peer restarted the negotiation: the network layer goes down
+    if (phase != PHASE_ESTABLISH) {
+      link_down();
+      phase = PHASE_ESTABLISH;
+      memset(&lcp, 0, sizeof(lcp));
+      lcp_send_request();
+    }
+    conf_reply_t r = {.mru = PPP_DEFAULT_MRU, .accm = 0xFFFFFFFFUL};
+    if (answer_conf_req(PPP_LCP, id, data, len, lcp_check_option, &r)) {
+      lcp.peer_acked = 1;
+      peer_mru = r.mru;
+      tx_accm = r.accm;
+      use_pap = r.pap;
+    }
+    break;
+  }
+
+  case CP_CONF_ACK:
+    if (id == lcp.id) lcp.req_acked = 1;
+    break;
+
+  case CP_CONF_NAK:
+  case CP_CONF_REJ:
+    if (id != lcp.id || phase != PHASE_ESTABLISH) break;
+    walk_options(
+        data, len, code == CP_CONF_NAK ? lcp_apply_nak : lcp_apply_rej, NULL);
+    lcp_send_request();
+    break;
+
+  case CP_TERM_REQ:
+    send_cp(PPP_LCP, CP_TERM_ACK, id, NULL, 0);
+    link_down();
+    break;
+
+  case CP_TERM_ACK:
+    if (phase == PHASE_TERMINATE) phase = PHASE_DEAD;
+    break;
+
+  case LCP_PROTO_REJ:
+    // Without IPCP there is nothing to carry
+    if (len >= 2 && get_be16(data) == PPP_IPCP) link_down();
+    break;
+
+  case LCP_ECHO_REQ:
+    if (phase >= PHASE_AUTH && len >= 4) {
+      uint8_t reply[4] = {(uint8_t)(magic >> 24), (uint8_t)(magic >> 16),
+          (uint8_t)(magic >> 8), (uint8_t)magic};
+      send_cp(PPP_LCP, LCP_ECHO_REP, id, reply, sizeof(reply));
+    }
+    break;
+
+  case CP_CODE_REJ:
+  case LCP_ECHO_REP:
+  case LCP_DISCARD_REQ:
+    break;
+
+  default:
+    send_cp(PPP_LCP, CP_CODE_REJ, ++next_id, packet, len + PPP_CP_HDR_LEN);
+    break;
+  }
+
+  if (phase == PHASE_ESTABLISH && lcp.req_acked && lcp.peer_acked)
+    enter_phase(use_pap ? PHASE_AUTH : PHASE_NETWORK);
+}
+
+static void pap_input(uint8_t code, uint8_t id) {
+  if (phase != PHASE_AUTH || id != pap.id) return;
+  if (code == PAP_AUTH_ACK)
+    enter_phase(PHASE_NETWORK);
+  else if (code == PAP_AUTH_NAK)
+    link_down();
+}
+
+static void ipcp_input(
+    uint8_t code, uint8_t id, const uint8_t* data, size_t len) {
+  if (phase < PHASE_NETWORK || phase == PHASE_TERMINATE) return;
+
+  switch (code) {
+  case CP_CONF_REQ: {
+    conf_reply_t r = {0};
+    if (answer_conf_req(PPP_IPCP, id, data, len, ipcp_check_option, &r)) {
+      ipcp.peer_acked = 1;
+      memcpy(ppp_addr.peer_ip, r.peer_ip, 4);
+    }
+    break;
+  }
+
+  case CP_CONF_ACK:
+    if (id == ipcp.id) ipcp.req_acked = 1;
+    break;
+
+  case CP_CONF_NAK:
+    if (id != ipcp.id) break;
+    walk_options(data, len, ipcp_apply_nak, NULL);
+    ipcp_send_request();
+    break;
+
+  case CP_CONF_REJ: {
+    if (id != ipcp.id) break;
+    int fatal = 0;
+    walk_options(data, len, ipcp_apply_rej, &fatal);
+    if (fatal)
+      link_down();
+    else
+      ipcp_send_request();
+    break;
+  }
+
+  case CP_TERM_REQ:
+    send_cp(PPP_IPCP, CP_TERM_ACK, id, NULL, 0);
+    link_down();
+    break;
+
+  default:
+    break;
+  }
+
+  if (phase == PHASE_NETWORK && ipcp.req_acked && ipcp.peer_acked)
+    enter_phase(PHASE_RUNNING);
+}
+
+static void rx_frame(const uint8_t* frame, size_t len) {
+  size_t pos = 0;
+  if (len >= 2 && frame[0] == PPP_ALLSTATIONS && frame[1] == PPP_UI) pos = 2;
+  if (pos >= len) return;
+
+  // Protocol field, possibly compressed to one byte
+  uint16_t proto = frame[pos++];
+  if (!(proto & 1)) {
+    if (pos >= len) return;
+    proto = (uint16_t)((proto << 8) | frame[pos++]);
+  }
+  const uint8_t* info = frame + pos;
+  size_t info_len = len - pos;
+
+  if (proto == PPP_IP) {
+    if (phase != PHASE_RUNNING) {
+      ppp_stats.rx_dropped++;
+      return;
+    }
+    ppp_stats.rx_packets++;
+    ppp_stats.rx_bytes += info_len;
+    ppp_netif.input(info, info_len, ppp_netif.ctx);
+    return;
+  }
+
+  if (proto != PPP_LCP && proto != PPP_PAP && proto != PPP_IPCP) {
+    // Protocol-Reject: rejected protocol followed by the start of the packet
+    if (phase < PHASE_NETWORK) return;
+    uint8_t reject[2 + 32] = {(uint8_t)(proto >> 8), (uint8_t)proto};
+    size_t copy = info_len < 32 ? info_len : 32;
+    memcpy(&reject[2], info, copy);
+    send_cp(PPP_LCP, LCP_PROTO_REJ, ++next_id, reject, 2 + copy);
+    return;
+  }
+
+  if (info_len < PPP_CP_HDR_LEN) return;
+  uint16_t cp_len = get_be16(info + 2);
+  if (cp_len < PPP_CP_HDR_LEN || cp_len > info_len) return;
+
+  uint8_t code = info[0], id = info[1];
+  const uint8_t* data = info + PPP_CP_HDR_LEN;
+  size_t data_len = cp_len - PPP_CP_HDR_LEN;
+
+  if (proto == PPP_LCP)
+    lcp_input(code, id, data, data_len, info);
+  else if (proto == PPP_PAP)
+    pap_input(code, id);
+  else
+    ipcp_input(code, id, data, data_len);
+}
+
+static void rx_byte(uint8_t b) {
+  if (b == PPP_FLAG) {
+    if (rx.overflow)
+      ppp_stats.rx_dropped++;
+    else if (rx.len >= PPP_HDR_LEN + PPP_FCS_LEN && rx.fcs == PPP_FCS_GOOD)
+      rx_frame(rx.buf, rx.len - PPP_FCS_LEN);
+    else if (rx.len > 0)
+      ppp_stats.fcs_errors++;
+
+    rx.len = 0;
+    rx.fcs = PPP_FCS_INIT;
+    rx.escape = 0;
+    rx.overflow = 0;
+    return;
+  }
+
+  if (b == PPP_ESCAPE) {
+    rx.escape = 1;
+    return;
+  }
+  if (rx.escape) {
+    b ^= PPP_TRANS;
+    rx.escape = 0;
+  }
+
+  rx.fcs = fcs_update(rx.fcs, b);
+  if (rx.len < sizeof(rx.buf))
+    rx.buf[rx.len++] = b;
+  else
+    rx.overflow = 1;
+}
+
+umodem_ring_t* umodem_ppp_ring(void) {
+  return ppp_active ? ppp_ring_ptr : NULL;
+}
+
+uint32_t umodem_ppp_poll(uint32_t now_ms) {
+  if (!ppp_active) return UMODEM_POLL_INFINITE;
+
+  // Decode everything received so far
+  uint8_t chunk[64];
+  for (;;) {
+    umodem_hal_lock();
+    size_t n = umodem_ring_get_count(ppp_ring_ptr);
+    if (n > sizeof(chunk)) n = sizeof(chunk);
+    if (n > 0) umodem_ring_pop(ppp_ring_ptr, chunk, n);
+    umodem_hal_unlock();
+
+    if (n == 0) break;
+    for (size_t i = 0; i < n; i++) rx_byte(chunk[i]);
+  }
+
+  // Restart timer of the request in progress
+  ppp_cp_t* cp = NULL;
+  if (phase == PHASE_ESTABLISH)
+    cp = &lcp;
+  else if (phase == PHASE_AUTH)
+    cp = &pap;
+  else if (phase == PHASE_NETWORK)
+    cp = &ipcp;
+  if (!cp || cp->req_acked) return UMODEM_POLL_INFINITE;
+
+  uint32_t elapsed = now_ms - cp->sent_ms;
+  if (elapsed < PPP_RESTART_MS) return PPP_RESTART_MS - elapsed;
+
+  if (cp->tries >= PPP_MAX_CONFIGURE) {
+    link_down();
+    return UMODEM_POLL_INFINITE;
+  }
+
+  if (cp == &lcp)
+    lcp_send_request();
+  else if (cp == &pap)
+    pap_send_request();
+  else
+    ipcp_send_request();
+  return PPP_RESTART_MS;
+}
+
+// Process input until the phase is no longer the given one
+static void wait_phase(ppp_phase_t waiting, uint32_t timeout_ms) {
+  uint32_t start = umodem_hal_millis();
+  while (phase == waiting && umodem_hal_millis() - start <= timeout_ms) {
+    umodem_poll();
+    if (phase == waiting) umodem_hal_wait_rx(10);
+  }
+}
+
+umodem_result_t umodem_ppp_open(
+    const umodem_ppp_netif_t* netif, uint32_t timeout_ms) {
+  const umodem_ppp_driver_t* drv = g_umodem_driver->ppp_driver;
+  if (!netif || !netif->input) return UMODEM_PARAM;
+  if (!g_umodem_driver->umodem_initialized || !drv || !drv->ppp_dial ||
+      ppp_active)
+    return UMODEM_ERR;
+
+  fcs_init();
+  if (drv->ppp_dial() != UMODEM_OK) return UMODEM_ERR;
+
+  ppp_netif = *netif;
+  memset(&rx, 0, sizeof(rx));
+  rx.fcs = PPP_FCS_INIT;
+  memset(&lcp, 0, sizeof(lcp));
+  memset(&ppp_addr, 0, sizeof(ppp_addr));
+  memset(&ppp_stats, 0, sizeof(ppp_stats));
+  magic = umodem_rand();
+  tx_accm = 0xFFFFFFFFUL;
+  peer_mru = PPP_DEFAULT_MRU;
+  use_pap = 0;
+  lcp_want_mru = UMODEM_PPP_MRU != PPP_DEFAULT_MRU;
+  lcp_want_accm = 1;
+  lcp_want_magic = 1;
+  ipcp_want_dns[0] = ipcp_want_dns[1] = 1;
+
+  // The channel now carries PPP: stop scanning it for URCs
+  umodem_hal_lock();
+  ppp_ring_ptr = umodem_at_ring(UMODEM_AT_CH_DATA);
+  ppp_active = 1;
+  umodem_hal_unlock();
+
+  phase = PHASE_ESTABLISH;
+  lcp_send_request();
+
+  uint32_t start = umodem_hal_millis();
+  while (phase != PHASE_RUNNING && phase != PHASE_DEAD &&
+         umodem_hal_millis() - start <= timeout_ms) {
+    umodem_poll();
+    if (phase != PHASE_RUNNING) umodem_hal_wait_rx(10);
+  }
+
+  if (phase == PHASE_RUNNING) return UMODEM_OK;
+
+  umodem_result_t result =
+      phase == PHASE_DEAD ? UMODEM_ERR : UMODEM_TIMEOUT;
+  umodem_ppp_close();
+  return result;
+}
+
+umodem_result_t umodem_ppp_close(void) {
+  if (!ppp_active) return UMODEM_OK;
+
+  if (phase != PHASE_DEAD) {
+    int was_up = phase == PHASE_RUNNING;
+    phase = PHASE_TERMINATE;
+    lcp.id = ++next_id;
+    send_cp(PPP_LCP, CP_TERM_REQ, lcp.id, NULL, 0);
+    wait_phase(PHASE_TERMINATE, PPP_TERMINATE_MS);
+    phase = PHASE_DEAD;
+    if (was_up && ppp_netif.link) ppp_netif.link(0, ppp_netif.ctx);
+  }
+
+  // Leftover frames would read as garbage in command mode
+  umodem_hal_lock();
+  umodem_ring_flush(ppp_ring_ptr);
+  ppp_active = 0;
+  ppp_ring_ptr = NULL;
+  umodem_hal_unlock();
+
+  const umodem_ppp_driver_t* drv = g_umodem_driver->ppp_driver;
+  return drv->ppp_hangup ? drv->ppp_hangup() : UMODEM_OK;
+}
+
+int umodem_ppp_output(const uint8_t* packet, size_t len) {
+  if (phase != PHASE_RUNNING || !packet || len == 0 || len > peer_mru)
+    return -1;
+  if (send_frame(PPP_IP, NULL, 0, packet, len) != 0) return -1;
+
+  ppp_stats.tx_packets++;
+  ppp_stats.tx_bytes += len;
+  return (int)len;
+}
+
+int umodem_ppp_is_up(void) { return phase == PHASE_RUNNING; }
+
+umodem_result_t umodem_ppp_get_addr(umodem_ppp_addr_t* addr) {
+  if (!addr || phase != PHASE_RUNNING) return UMODEM_ERR;
+  *addr = ppp_addr;
+  return UMODEM_OK;
+}
+
+void umodem_ppp_get_stats(umodem_ppp_stats_t* stats) {
+  if (stats) *stats = ppp_stats;
+}
+
+#endif
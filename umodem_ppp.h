@@ -0,0 +1,123 @@
+#ifndef uMODEM_PPP_H_
+#define uMODEM_PPP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "umodem_config.h"
+#include "umodem_core.h"
+#include "umodem_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * PPP data mode, enabled with UMODEM_PPP_ENABLE.
+ *
+ * umodem_ppp_open() dials the packet data context through the driver
+ * (ATD*99# on the data channel, see umodem_at_channel_t), then negotiates
+ * LCP, optional PAP and IPCP over HDLC-like framing (RFC 1661/1662/1332).
+ * Once the link is up, IPv4 packets are exchanged with a TCP/IP stack
+ * through a netif hook: received packets are handed to the input callback,
+ * packets to send are passed to umodem_ppp_output(). Payload bytes then
+ * only pay the 8 bytes of PPP framing instead of an AT round trip.
+ *
+ * Received bytes stay in the channel's RX ring until umodem_poll() decodes
+ * them, so the netif callbacks run in the context calling umodem_poll().
+ * Size UMODEM_RX_BUF_SIZE (or UMODEM_CMUX_DATA_BUF_SIZE with CMUX) for the
+ * data arriving between two polls. With a CMUX session open the AT control
+ * channel stays usable while the link is up.
+ */
+
+/**
+   * @brief Network interface hooks.
+   */
+typedef struct {
+  /** @brief Received IPv4 packet, valid for the duration of the call. */
+  void (*input)(const uint8_t* packet, size_t len, void* ctx);
+  /** @brief Link came up (1) or went down (0). Optional. */
+  void (*link)(int up, void* ctx);
+  void* ctx;
+} umodem_ppp_netif_t;
+
+/**
+   * @brief Addresses negotiated with IPCP, in network byte order.
+   */
+typedef struct {
+  uint8_t local_ip[4];
+  uint8_t peer_ip[4];
+  uint8_t dns[2][4]; // 0.0.0.0 when the peer did not provide one
+} umodem_ppp_addr_t;
+
+/**
+   * @brief Link counters.
+   */
+typedef struct {
+  uint64_t rx_bytes;   // IPv4 bytes delivered to the netif
+  uint64_t tx_bytes;   // IPv4 bytes sent
+  uint32_t rx_packets;
+  uint32_t tx_packets;
+  uint32_t fcs_errors; // Frames dropped on a bad checksum
+  uint32_t rx_dropped; // Frames too long or received while the link is down
+} umodem_ppp_stats_t;
+
+#if UMODEM_PPP_ENABLE
+
+/**
+   * @brief Dial and bring the link up.
+   *
+   * @param netif       Hooks of the TCP/IP stack, copied.
+   * @param timeout_ms  Time allowed for the negotiation after CONNECT.
+   *
+   * @return UMODEM_OK once IPCP is open.
+   */
+umodem_result_t umodem_ppp_open(
+    const umodem_ppp_netif_t* netif, uint32_t timeout_ms);
+
+/**
+   * @brief Terminate the link and return the modem to command mode.
+   */
+umodem_result_t umodem_ppp_close(void);
+
+/**
+   * @brief Send one IPv4 packet.
+   *
+   * @return Number of bytes sent, or -1 if the link is down or the packet
+   *         exceeds the peer's MRU.
+   */
+int umodem_ppp_output(const uint8_t* packet, size_t len);
+
+/**
+   * @brief Check whether IPCP is open and packets can flow.
+   */
+int umodem_ppp_is_up(void);
+
+/**
+   * @brief Get the negotiated addresses.
+   *
+   * @return UMODEM_ERR while the link is down.
+   */
+umodem_result_t umodem_ppp_get_addr(umodem_ppp_addr_t* addr);
+
+/**
+   * @brief Copy the link counters.
+   */
+void umodem_ppp_get_stats(umodem_ppp_stats_t* stats);
+
+/* Library hooks: the RX ring owned by an active link (no URC scanning on
+ * it), and the decoder / timer work run from umodem_poll(). */
+umodem_ring_t* umodem_ppp_ring(void);
+uint32_t umodem_ppp_poll(uint32_t now_ms);
+
+#else
+
+#define umodem_ppp_ring() ((umodem_ring_t*)NULL)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
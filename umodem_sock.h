@@ -14,6 +14,26 @@ extern "C"
     UMODEM_SOCK_UDP,
   } umodem_sock_type_t;
 
+  /**
+   * @brief DNS cache counters, see umodem_sock_resolve().
+   */
+  typedef struct
+  {
+    uint32_t hits;      // Lookups answered from the cache
+    uint32_t misses;    // Lookups that had to query the modem
+    uint32_t refreshes; // Entries re-resolved after a failed connect
+    uint32_t failures;  // Queries the modem could not resolve
+  } umodem_dns_stats_t;
+
+  /**
+   * @brief Peer of a datagram, see umodem_sock_recvfrom().
+   */
+  typedef struct
+  {
+    char addr[16]; // Dotted IPv4 address
+    uint16_t port;
+  } umodem_sock_addr_t;
+
   umodem_result_t umodem_sock_init(void);
   umodem_result_t umodem_sock_deinit(void);
   int umodem_sock_create(umodem_sock_type_t type);
@@ -22,6 +42,134 @@ extern "C"
   int umodem_sock_send(int sockfd, const void *data, size_t len);
   int umodem_sock_recv(int sockfd, void *buf, size_t len);
 
+  /**
+   * @brief Send one datagram on a UDP socket, no connect needed.
+   *
+   * Hostnames go through the DNS cache. The modem binds a UDP socket to a
+   * single peer, so sending to another one re-targets the socket first:
+   * datagrams from the previous peer that were not read yet are lost.
+   *
+   * @return Bytes sent, or -1 on failure.
+   */
+  int umodem_sock_sendto(int sockfd, const void *data, size_t len, const char *host, size_t host_len, uint16_t port);
+
+  /**
+   * @brief Receive one datagram and the address it came from.
+   *
+   * Message boundaries are kept: every call returns at most one datagram,
+   * and the part of a datagram that does not fit in @p buf is dropped.
+   *
+   * @param from Receives the sender, may be NULL
+   *
+   * @return Bytes received, 0 if none are pending, or -1 on failure.
+   */
+  int umodem_sock_recvfrom(int sockfd, void *buf, size_t len, umodem_sock_addr_t *from);
+
+  /**
+   * @brief Resolve a hostname to a dotted IPv4 address.
+   *
+   * Answers come from the driver's DNS cache while younger than
+   * UMODEM_DNS_CACHE_TTL_MS, otherwise the modem is queried. Socket and MQTT
+   * connects go through the same cache, and re-resolve a cached address
+   * once if connecting to it fails.
+   *
+   * @param ip Receives the address, at least 16 bytes
+   */
+  umodem_result_t umodem_sock_resolve(const char *host, size_t host_len, char *ip, size_t ip_size, uint32_t timeout_ms);
+  umodem_result_t umodem_sock_get_dns_stats(umodem_dns_stats_t *stats);
+  void umodem_sock_dns_flush(void);
+
+  /**
+   * @brief Accept inbound TCP connections on @p port.
+   *
+   * Each connection gets a socket of its own, reported with
+   * UMODEM_EVENT_SOCK_ACCEPTED (event data: the sockfd) and by
+   * umodem_sock_accept(). It is then used like a connected client socket:
+   * UMODEM_EVENT_SOCK_DATA_RECEIVED, umodem_sock_recv(), umodem_sock_send()
+   * and umodem_sock_close(). Inbound connections are numbered after the
+   * client sockets. One that arrives while not listening, or on a modem
+   * index an unclosed inbound socket still holds, is closed again.
+   *
+   * @param max_conns Connections accepted at the same time
+   */
+  umodem_result_t umodem_sock_listen(umodem_sock_type_t type, uint16_t port, int max_conns);
+
+  /**
+   * @brief Take the next inbound connection not returned yet.
+   *
+   * Connections are picked up by umodem_poll(); event subscribers can use
+   * the sockfd from UMODEM_EVENT_SOCK_ACCEPTED instead.
+   *
+   * @return The sockfd, 0 if none is waiting, or -1 if not listening.
+   */
+  int umodem_sock_accept(void);
+
+  /**
+   * @brief Stop listening and close every inbound connection.
+   */
+  umodem_result_t umodem_sock_unlisten(void);
+
+  /**
+   * @brief Coalesce small umodem_sock_send() calls on a TCP socket.
+   *
+   * Sends are buffered until @p threshold bytes are waiting or the first of
+   * them has waited @p delay_ms, then go out in one AT+QISEND. The deadline
+   * is kept by umodem_poll(). Sends of @p threshold bytes or more skip the
+   * buffer. A failed deferred send is reported by the next
+   * umodem_sock_send() or umodem_sock_flush(); umodem_sock_close() sends
+   * what is still buffered first.
+   *
+   * @param threshold Buffer size, capped at the modem's largest AT+QISEND;
+   *                  0 disables coalescing
+   */
+  umodem_result_t umodem_sock_set_coalesce(int sockfd, size_t threshold, uint32_t delay_ms);
+
+  /**
+   * @brief Send every write at once while @p enable is set, like
+   * TCP_NODELAY. Enabling it flushes the buffer; the coalescing settings
+   * are kept for when it is cleared again.
+   */
+  umodem_result_t umodem_sock_set_nodelay(int sockfd, int enable);
+
+  /**
+   * @brief Send the bytes coalesced on a socket now.
+   */
+  umodem_result_t umodem_sock_flush(int sockfd);
+
+  /**
+   * @brief Open a TCP connection in transparent mode.
+   *
+   * The data channel becomes a raw byte pipe to the peer: payloads go out
+   * without AT+QISEND framing and come back without AT+QIRD round trips,
+   * and the channel is no longer scanned for URCs. It takes the modem's
+   * single connection, so no other socket may be open. Without a CMUX
+   * session the control channel is blocked too until the pipe is closed.
+   *
+   * Received bytes wait in the channel's RX ring: read them often enough
+   * for UMODEM_RX_BUF_SIZE (or UMODEM_CMUX_DATA_BUF_SIZE with CMUX). The
+   * peer closing shows up as "CLOSED" in the data stream.
+   */
+  umodem_result_t umodem_sock_transparent_open(const char *host, size_t host_len, uint16_t port, uint32_t timeout_ms);
+
+  /**
+   * @return Bytes written, or -1 if no transparent connection is open.
+   */
+  int umodem_sock_transparent_send(const void *data, size_t len);
+
+  /**
+   * @brief Polls the modem and copies the bytes received so far.
+   *
+   * @return Bytes copied, 0 if none arrived, or -1 if no transparent
+   *         connection is open.
+   */
+  int umodem_sock_transparent_recv(void *buf, size_t len);
+
+  /**
+   * @brief Escape to command mode with "+++", close the connection and
+   * restore multi-connection mode. Unread bytes are dropped.
+   */
+  umodem_result_t umodem_sock_transparent_close(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,138 @@
+#include <string.h>
+
+#include "umodem_trace.h"
+
+static const uint8_t trace_magic[4] = {'U', 'M', 'T', 'R'};
+
+static uint16_t get_le16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+size_t umodem_trace_parse_header(const uint8_t* buf, size_t len) {
+  if (!buf || len < UMODEM_TRACE_HEADER_LEN) return 0;
+  if (memcmp(buf, trace_magic, sizeof(trace_magic)) != 0) return 0;
+  if (buf[4] != UMODEM_TRACE_VERSION) return 0;
+  return UMODEM_TRACE_HEADER_LEN;
+}
+
+size_t umodem_trace_parse_record(
+    const uint8_t* buf, size_t len, umodem_trace_record_t* rec) {
+  if (!buf || !rec || len < UMODEM_TRACE_RECORD_HEADER_LEN) return 0;
+  if (buf[0] != UMODEM_TRACE_RX && buf[0] != UMODEM_TRACE_TX) return 0;
+
+  uint16_t data_len = get_le16(buf + 1);
+  if (len - UMODEM_TRACE_RECORD_HEADER_LEN < data_len) return 0;
+
+  rec->dir = (umodem_trace_dir_t)buf[0];
+  rec->len = data_len;
+  rec->time_ms = get_le32(buf + 3);
+  rec->data = buf + UMODEM_TRACE_RECORD_HEADER_LEN;
+  return UMODEM_TRACE_RECORD_HEADER_LEN + data_len;
+}
+
+#if UMODEM_TRACE_ENABLE
+
+#include <stdatomic.h>
+
+#include "port/umodem_port.h"
+
+#if (UMODEM_TRACE_BUF_SIZE & (UMODEM_TRACE_BUF_SIZE - 1)) != 0
+#error "UMODEM_TRACE_BUF_SIZE must be a power of two"
+#endif
+
+#define TRACE_MASK (UMODEM_TRACE_BUF_SIZE - 1)
+
+// Free-running positions: the producer owns head, the consumer owns tail
+static uint8_t trace_buf[UMODEM_TRACE_BUF_SIZE];
+static atomic_size_t trace_head;
+static atomic_size_t trace_tail;
+static atomic_uint_least32_t trace_drops;
+
+static void ring_write(size_t pos, const uint8_t* data, size_t len) {
+  size_t idx = pos & TRACE_MASK;
+  size_t first = UMODEM_TRACE_BUF_SIZE - idx;
+  if (first > len) first = len;
+  memcpy(&trace_buf[idx], data, first);
+  memcpy(trace_buf, data + first, len - first);
+}
+
+static void record(umodem_trace_dir_t dir, const uint8_t* data, size_t len) {
+  uint32_t now = umodem_hal_millis();
+
+  while (len > 0) {
+    uint16_t chunk = len > UINT16_MAX ? UINT16_MAX : (uint16_t)len;
+    size_t total = UMODEM_TRACE_RECORD_HEADER_LEN + chunk;
+
+    size_t head = atomic_load_explicit(&trace_head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&trace_tail, memory_order_acquire);
+    if (total > UMODEM_TRACE_BUF_SIZE - (head - tail)) {
+      atomic_fetch_add_explicit(&trace_drops, 1, memory_order_relaxed);
+      return;
+    }
+
+    uint8_t hdr[UMODEM_TRACE_RECORD_HEADER_LEN] = {(uint8_t)dir,
+        (uint8_t)chunk, (uint8_t)(chunk >> 8), (uint8_t)now,
+        (uint8_t)(now >> 8), (uint8_t)(now >> 16), (uint8_t)(now >> 24)};
+    ring_write(head, hdr, sizeof(hdr));
+    ring_write(head + sizeof(hdr), data, chunk);
+
+    // Publish the whole record at once
+    atomic_store_explicit(&trace_head, head + total, memory_order_release);
+
+    data += chunk;
+    len -= chunk;
+  }
+}
+
+void umodem_trace_record_rx(const uint8_t* data, size_t len) {
+  record(UMODEM_TRACE_RX, data, len);
+}
+
+void umodem_trace_record_tx(const uint8_t* data, size_t len) {
+  // RX records are written under the HAL lock, keep a single producer
+  umodem_hal_lock();
+  record(UMODEM_TRACE_TX, data, len);
+  umodem_hal_unlock();
+}
+
+int umodem_trace_drain(umodem_trace_writer_t writer, void* ctx) {
+  if (!writer) return -1;
+
+  size_t tail = atomic_load_explicit(&trace_tail, memory_order_relaxed);
+  size_t head = atomic_load_explicit(&trace_head, memory_order_acquire);
+  size_t len = head - tail;
+  if (len == 0) return 0;
+
+  // [tail, head) only ever holds complete records
+  size_t idx = tail & TRACE_MASK;
+  size_t first = UMODEM_TRACE_BUF_SIZE - idx;
+  if (first > len) first = len;
+
+  if (writer(&trace_buf[idx], first, ctx) != 0) return -1;
+  if (len > first && writer(trace_buf, len - first, ctx) != 0) return -1;
+
+  atomic_store_explicit(&trace_tail, head, memory_order_release);
+  return (int)len;
+}
+
+int umodem_trace_dump(umodem_trace_writer_t writer, void* ctx) {
+  if (!writer) return -1;
+
+  uint8_t hdr[UMODEM_TRACE_HEADER_LEN] = {0};
+  memcpy(hdr, trace_magic, sizeof(trace_magic));
+  hdr[4] = UMODEM_TRACE_VERSION;
+  if (writer(hdr, sizeof(hdr), ctx) != 0) return -1;
+
+  return umodem_trace_drain(writer, ctx);
+}
+
+uint32_t umodem_trace_dropped(void) {
+  return (uint32_t)atomic_load_explicit(&trace_drops, memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef uMODEM_TRACE_H_
+#define uMODEM_TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "umodem_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary serial trace, enabled with UMODEM_TRACE_ENABLE.
+ *
+ * Every chunk pushed into the RX buffer and every write to the modem is
+ * recorded with a umodem_hal_millis() timestamp into a lock-free
+ * single-producer / single-consumer ring of UMODEM_TRACE_BUF_SIZE bytes.
+ * Records that do not fit are dropped and counted. The ring is drained
+ * through a writer callback, e.g. to a file or a flash region.
+ *
+ * Dump layout (little endian):
+ *
+ *   header  "UMTR" | version (1) | reserved (3)
+ *   record  dir (1) | len (2) | time_ms (4) | data[len]
+ *
+ * The parser below is always available so tools can read dumps regardless
+ * of UMODEM_TRACE_ENABLE.
+ */
+
+#define UMODEM_TRACE_VERSION 1
+#define UMODEM_TRACE_HEADER_LEN 8
+#define UMODEM_TRACE_RECORD_HEADER_LEN 7
+
+typedef enum {
+  UMODEM_TRACE_RX = 0, // Modem to host
+  UMODEM_TRACE_TX = 1, // Host to modem
+} umodem_trace_dir_t;
+
+typedef struct {
+  umodem_trace_dir_t dir;
+  uint32_t time_ms;
+  const uint8_t* data; // Points into the parsed buffer
+  uint16_t len;
+} umodem_trace_record_t;
+
+/**
+   * @brief Writer used to drain the trace.
+   *
+   * @return 0 on success, negative to abort the drain.
+   */
+typedef int (*umodem_trace_writer_t)(
+    const uint8_t* data, size_t len, void* ctx);
+
+/**
+   * @brief Check a dump header.
+   *
+   * @return Length of the header on success, 0 if it is not a trace dump.
+   */
+size_t umodem_trace_parse_header(const uint8_t* buf, size_t len);
+
+/**
+   * @brief Parse the record at the start of a buffer.
+   *
+   * @return Number of bytes consumed, 0 if the buffer holds no complete
+   *         record.
+   */
+size_t umodem_trace_parse_record(
+    const uint8_t* buf, size_t len, umodem_trace_record_t* rec);
+
+#if UMODEM_TRACE_ENABLE
+
+/**
+   * @brief Write a dump header followed by every pending record.
+   *
+   * @return Number of record bytes written, or -1 if the writer failed.
+   */
+int umodem_trace_dump(umodem_trace_writer_t writer, void* ctx);
+
+/**
+   * @brief Write pending records only, to stream into an existing dump.
+   *
+   * Must only be called from one context at a time (the single consumer);
+   * recording may continue concurrently.
+   *
+   * @return Number of record bytes written, or -1 if the writer failed.
+   */
+int umodem_trace_drain(umodem_trace_writer_t writer, void* ctx);
+
+/**
+   * @brief Number of records dropped because the ring was full.
+   */
+uint32_t umodem_trace_dropped(void);
+
+/* Recording hooks, use the UMODEM_TRACE_* macros below. The RX hook runs
+ * under the HAL lock (from umodem_buffer_push()), the TX hook takes it. */
+void umodem_trace_record_rx(const uint8_t* data, size_t len);
+void umodem_trace_record_tx(const uint8_t* data, size_t len);
+
+#define UMODEM_TRACE_RX(data, len) umodem_trace_record_rx((data), (len))
+#define UMODEM_TRACE_TX(data, len) umodem_trace_record_tx((data), (len))
+
+#else
+
+#define UMODEM_TRACE_RX(data, len) ((void)0)
+#define UMODEM_TRACE_TX(data, len) ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif